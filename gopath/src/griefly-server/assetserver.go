@@ -14,9 +14,10 @@ import (
 )
 
 const (
-	PipeQueueLength    = 4
-	DefalutContentType = "application/octet-stream"
-	QZippedContentType = "application/zip"
+	PipeQueueLength      = 4
+	DefalutContentType   = "application/octet-stream"
+	QZippedContentType   = "application/zip"
+	MapChunksContentType = "application/x-kv-map-chunks"
 )
 
 type AssetServer struct {
@@ -1,6 +1,7 @@
 package main
 
 import (
+	"encoding/json"
 	"fmt"
 	"log"
 	"math/rand"
@@ -21,6 +22,10 @@ var (
 	StartHashCheckEvery = 1
 	HashCheckTimeout    = 500 * time.Millisecond
 	SendConnCountEvery  = 5
+
+	// the whole desync search, not a single request of it
+	DesyncSearchTimeout     = 3 * time.Second
+	DesyncSearchMaxRequests = 64
 )
 
 type newPlayerReply struct {
@@ -62,6 +67,59 @@ func (hc *hashCheck) add(id int, msg *MessageHash) {
 	hc.waitingClientCount--
 }
 
+// desyncSearch narrows an unsync down to the diverged objects by descending
+// into the mismatching nodes of the world hash trees of the master and
+// of the unsynced clients, one node per round trip
+type desyncSearch struct {
+	tick     int
+	master   int
+	unsynced []int
+	// the search is finished with what is found until then
+	deadline time.Time
+
+	node     json.RawMessage
+	nodeTick int
+	replies  map[int]*MessageHashTree
+
+	queue    []string
+	queued   map[string]bool
+	requests int
+}
+
+func (ds *desyncSearch) participants() []int {
+	return append([]int{ds.master}, ds.unsynced...)
+}
+
+func (ds *desyncSearch) isParticipant(id int) bool {
+	for _, participant := range ds.participants() {
+		if participant == id {
+			return true
+		}
+	}
+	return false
+}
+
+func (ds *desyncSearch) enqueue(node string) {
+	if ds.queued[node] {
+		return
+	}
+	ds.queued[node] = true
+	ds.queue = append(ds.queue, node)
+}
+
+// canonicalNode allows to compare nodes regardless of their formatting
+func canonicalNode(node json.RawMessage) string {
+	var value interface{}
+	if err := json.Unmarshal(node, &value); err != nil {
+		return string(node)
+	}
+	canonical, err := json.Marshal(value)
+	if err != nil {
+		return string(node)
+	}
+	return string(canonical)
+}
+
 type playerDrop struct {
 	id     int
 	reason *Envelope
@@ -85,6 +143,7 @@ type Registry struct {
 	droppedPlayers chan playerDrop
 
 	hashes            map[int]*hashCheck
+	desync            *desyncSearch
 	currentTick       int
 	nextTickCallbacks []func(*Registry)
 
@@ -101,7 +160,7 @@ type Registry struct {
 func newRegistry(as *AssetServer, config *RegistryConfig, db DB, collector *StatsCollector) *Registry {
 	return &Registry{1, make(map[int]chan *Envelope), make(map[string]PlayerInfo),
 		-1, "", make(chan PlayerEnvelope), make(chan versionCheck), make(chan playerDrop),
-		make(map[int]*hashCheck), 0, nil, make(chan *Envelope, RegistryQueueLength), nil, as, nil,
+		make(map[int]*hashCheck), nil, 0, nil, make(chan *Envelope, RegistryQueueLength), nil, as, nil,
 		db, collector, config}
 }
 
@@ -188,6 +247,10 @@ func (r *Registry) Run() {
 				continue
 			}
 
+			if r.handleHashTree(m) {
+				continue
+			}
+
 			if r.handleRestart(m) {
 				continue
 			}
@@ -428,6 +491,37 @@ func (r *Registry) handleHash(m *Envelope) bool {
 	return true
 }
 
+func (r *Registry) handleHashTree(m *Envelope) bool {
+	tree, ok := m.Message.(*MessageHashTree)
+	if !ok {
+		return false
+	}
+
+	search := r.desync
+	// too late reply
+	if search == nil || canonicalNode(tree.Node) != canonicalNode(search.node) {
+		return true
+	}
+	// reply to an earlier request of the same node, the hashes are
+	// of another world state
+	if tree.Tick != search.nodeTick {
+		log.Printf("hash-check: client %d sent hash tree node %s of tick %d instead of %d",
+			m.From, string(tree.Node), tree.Tick, search.nodeTick)
+		return true
+	}
+
+	search.replies[m.From] = tree
+	for _, id := range search.participants() {
+		if _, ok := search.replies[id]; !ok {
+			return true
+		}
+	}
+
+	// all clients replied
+	r.compareHashTrees(time.Now())
+	return true
+}
+
 func (r *Registry) handleRestart(m *Envelope) bool {
 	if m.Kind != MsgidRestart {
 		return false
@@ -522,6 +616,7 @@ func (r *Registry) handleNewTick(now time.Time) {
 	r.sendNewTick()
 	r.checkForHashStart(now)
 	r.checkHashes(now)
+	r.checkDesyncSearch(now)
 	r.maybeSendConnCounter()
 	r.invokeNextTickCallbacks()
 }
@@ -558,17 +653,17 @@ func (r *Registry) checkHashes(now time.Time) {
 			// deadline expired for this hash check, force check
 			// we shall use the tick when hash was computed but due to #201 we will
 			// request current map
-			r.checkHashesOne(r.currentTick, checker)
+			r.checkHashesOne(r.currentTick, checker, now)
 			delete(r.hashes, tick)
 		} else if checker.waitingClientCount <= 0 {
 			// we collected hashes from all clients, start check
-			r.checkHashesOne(r.currentTick, checker)
+			r.checkHashesOne(r.currentTick, checker, now)
 			delete(r.hashes, tick)
 		}
 	}
 }
 
-func (r *Registry) checkHashesOne(tick int, checker *hashCheck) {
+func (r *Registry) checkHashesOne(tick int, checker *hashCheck, now time.Time) {
 	master := r.masterID
 	if master == -1 {
 		// all of sudden we have no players, so nothing to do
@@ -595,14 +690,127 @@ func (r *Registry) checkHashesOne(tick int, checker *hashCheck) {
 		return
 	}
 
-	unsyncedStrs := []string{}
-	for _, id := range unsynced {
-		unsyncedStrs = append(unsyncedStrs, strconv.Itoa(id))
+	if r.desync != nil {
+		// only one unsync is investigated at a time, the clients unsynced
+		// meanwhile are dropped right away, the investigated ones are dropped
+		// when the search is finished
+		dropped := []int{}
+		for _, id := range unsynced {
+			if !r.desync.isParticipant(id) {
+				dropped = append(dropped, id)
+			}
+		}
+		if len(dropped) != 0 {
+			log.Printf("hash-check: unsync detected on tick %d during the search from tick %d, dropping clients: %s",
+				tick, r.desync.tick, joinIDs(dropped))
+			r.dropUnsynced(master, dropped, tick)
+		}
+		return
+	}
+
+	log.Printf("hash-check: unsync detected on tick %d, searching for diverged objects of those clients: %s",
+		tick, joinIDs(unsynced))
+
+	r.desync = &desyncSearch{
+		tick:     tick,
+		master:   master,
+		unsynced: unsynced,
+		deadline: now.Add(DesyncSearchTimeout),
+		queued:   make(map[string]bool),
+	}
+	// empty node is the root of the tree
+	r.requestHashTreeNode(json.RawMessage("{}"), now)
+}
+
+func (r *Registry) requestHashTreeNode(node json.RawMessage, now time.Time) {
+	search := r.desync
+	search.node = node
+	search.nodeTick = r.currentTick
+	search.replies = make(map[int]*MessageHashTree)
+	search.requests++
+
+	// requests are sent between the same ticks, so all clients reply with
+	// the hashes of the same world state and with the current tick
+	e := NewEnvelope(&MessageRequestHashTree{node}, MsgidRequestHashTree, 0)
+	for _, id := range search.participants() {
+		r.sendOne(id, e)
+	}
+}
+
+func (r *Registry) checkDesyncSearch(now time.Time) {
+	if r.desync == nil || !r.desync.deadline.Before(now) {
+		return
+	}
+	// deadline expired, compare what we have
+	r.compareHashTrees(now)
+}
+
+func (r *Registry) compareHashTrees(now time.Time) {
+	search := r.desync
+	masterTree, ok := search.replies[search.master]
+	if !ok {
+		log.Printf("hash-check: master %d did not sent hash tree node %s", search.master, string(search.node))
+		r.finishDesyncSearch()
+		return
+	}
+
+	for _, id := range search.unsynced {
+		tree, ok := search.replies[id]
+		if !ok {
+			log.Printf("hash-check: client %d did not sent hash tree node %s", id, string(search.node))
+			continue
+		}
+
+		children := make(map[string]HashTreeChild)
+		for _, child := range tree.Children {
+			children[canonicalNode(child.Node)] = child
+		}
+
+		for _, masterChild := range masterTree.Children {
+			key := canonicalNode(masterChild.Node)
+			child, ok := children[key]
+			delete(children, key)
+			if !ok {
+				log.Printf("hash-check: client %d does not have node %s", id, key)
+				continue
+			}
+			if child.Hash == masterChild.Hash {
+				continue
+			}
+			if masterChild.Leaf {
+				log.Printf("hash-check: client %d diverged at %s: master %d %s, client %d %s",
+					id, key, masterChild.Hash, string(masterChild.Info), child.Hash, string(child.Info))
+				continue
+			}
+			search.enqueue(key)
+		}
+
+		for key := range children {
+			log.Printf("hash-check: client %d has extra node %s", id, key)
+		}
 	}
 
-	log.Printf("hash-check: unsync detected on tick %d, fetching maps and dropping those clients: %s",
-		tick, strings.Join(unsyncedStrs, ", "))
+	if len(search.queue) == 0 || search.requests >= DesyncSearchMaxRequests || !now.Before(search.deadline) {
+		r.finishDesyncSearch()
+		return
+	}
+
+	node := search.queue[0]
+	search.queue = search.queue[1:]
+	r.requestHashTreeNode(json.RawMessage(node), now)
+}
+
+func (r *Registry) finishDesyncSearch() {
+	search := r.desync
+	r.desync = nil
+
+	log.Printf("hash-check: unsync search from tick %d is finished after %d requests, fetching maps and dropping unsynced clients",
+		search.tick, search.requests)
 
+	r.dropUnsynced(search.master, search.unsynced, search.tick)
+}
+
+func (r *Registry) dropUnsynced(master int, unsynced []int, tick int) {
 	// request and dump map from master and all of those faulty clients
 	r.dumpPlayerMap(master, tick, nil)
 	for _, id := range unsynced {
@@ -611,6 +819,14 @@ func (r *Registry) checkHashesOne(tick int, checker *hashCheck) {
 	}
 }
 
+func joinIDs(ids []int) string {
+	strs := []string{}
+	for _, id := range ids {
+		strs = append(strs, strconv.Itoa(id))
+	}
+	return strings.Join(strs, ", ")
+}
+
 func (r *Registry) dumpPlayerMap(id, tick int, callback func()) {
 	pipe, uploadURL, _ := r.assetServer.MakePipe()
 	mapreq := &MessageMapUpload{&tick, uploadURL}
@@ -0,0 +1,250 @@
+package main
+
+import (
+	"bytes"
+	"encoding/json"
+	"fmt"
+	"io/ioutil"
+	"log"
+	"os"
+	"strings"
+	"testing"
+	"time"
+
+	"github.com/stretchr/testify/assert"
+)
+
+// fakeClient replies with the hash tree of a world which consists
+// of the objects only
+type fakeClient struct {
+	id      int
+	objects map[int]int
+}
+
+func (fc *fakeClient) hash() int {
+	sum := 0
+	for _, hash := range fc.objects {
+		sum += hash
+	}
+	return sum
+}
+
+func (fc *fakeClient) reply(request *Envelope, tick int) *Envelope {
+	node := request.Message.(*MessageRequestHashTree).Node
+	var kind struct {
+		Kind string `json:"kind"`
+	}
+	json.Unmarshal(node, &kind)
+
+	children := []HashTreeChild{}
+	switch kind.Kind {
+	case "":
+		children = append(children,
+			HashTreeChild{Node: json.RawMessage(`{"kind": "objects"}`), Hash: fc.hash()})
+	case "objects":
+		for id, hash := range fc.objects {
+			children = append(children, HashTreeChild{
+				Node: json.RawMessage(fmt.Sprintf(`{"kind": "object", "id": %d}`, id)),
+				Hash: hash,
+				Leaf: true,
+				Info: json.RawMessage(`{"type": "TestObject"}`),
+			})
+		}
+	}
+	tree := &MessageHashTree{Node: node, Children: children, Tick: tick}
+	return NewEnvelope(tree, MsgidHashTree, fc.id)
+}
+
+func receiveAll(inbox chan *Envelope) []*Envelope {
+	envelopes := []*Envelope{}
+	for {
+		select {
+		case e, ok := <-inbox:
+			if !ok {
+				return envelopes
+			}
+			envelopes = append(envelopes, e)
+		default:
+			return envelopes
+		}
+	}
+}
+
+// the metrics are registered globally, so only once
+var testCollector = NewStatsCollector()
+
+// newTestRegistry returns a registry with the given fake clients connected,
+// the first one is the master
+func newTestRegistry(t *testing.T, dumpRoot string, clients ...*fakeClient) *Registry {
+	collector := testCollector
+	assetServer, err := NewAssetServer("http://localhost:1111", collector)
+	if !assert.NoError(t, err) {
+		return nil
+	}
+	r := newRegistry(assetServer, &RegistryConfig{DumpRoot: dumpRoot}, nil, collector)
+	r.dumper = NewDumpWriter(dumpRoot, "test")
+	r.currentTick = 10
+
+	for _, fc := range clients {
+		r.clients[fc.id] = make(chan *Envelope, 16)
+	}
+	r.masterID = clients[0].id
+	return r
+}
+
+func TestDesyncSearchFindsDivergedObject(t *testing.T) {
+	var logs bytes.Buffer
+	log.SetOutput(&logs)
+	defer log.SetOutput(os.Stderr)
+
+	dumpRoot, err := ioutil.TempDir("", "griefly-server-test")
+	if !assert.NoError(t, err) {
+		return
+	}
+	defer os.RemoveAll(dumpRoot)
+
+	master := &fakeClient{1, map[int]int{3: 30, 7: 70, 12: 120}}
+	client := &fakeClient{2, map[int]int{3: 30, 7: 71, 12: 120}}
+	r := newTestRegistry(t, dumpRoot, master, client)
+	if r == nil {
+		return
+	}
+	clientInbox := r.clients[client.id]
+
+	checker := &hashCheck{hashes: map[int]int{master.id: master.hash(), client.id: client.hash()}}
+	r.checkHashesOne(r.currentTick, checker, time.Now())
+
+	requests := 0
+	for r.desync != nil && requests < 10 {
+		requests++
+		search := r.desync
+		// the request is sent on the current tick
+		requestTick := r.currentTick
+
+		masterRequests := receiveAll(r.clients[master.id])
+		clientRequests := receiveAll(clientInbox)
+		if !assert.Len(t, masterRequests, 1) || !assert.Len(t, clientRequests, 1) {
+			return
+		}
+		assert.Equal(t, uint32(MsgidRequestHashTree), clientRequests[0].Kind)
+
+		// the replies may arrive after the next tick
+		r.currentTick++
+
+		r.handleHashTree(master.reply(masterRequests[0], requestTick))
+		// reply to the same node, but of another tick
+		r.handleHashTree(client.reply(clientRequests[0], requestTick-1))
+		assert.True(t, r.desync == search)
+		assert.NotContains(t, search.replies, client.id)
+
+		r.handleHashTree(client.reply(clientRequests[0], requestTick))
+	}
+	assert.Equal(t, 2, requests)
+	assert.Nil(t, r.desync)
+
+	assert.Equal(t, 1, strings.Count(logs.String(), "diverged at"), logs.String())
+	assert.Contains(t, logs.String(),
+		`client 2 diverged at {"id":7,"kind":"object"}: master 70 {"type": "TestObject"}, client 71`)
+	assert.Contains(t, logs.String(), "of tick 9 instead of 10")
+
+	// the maps are requested and the unsynced client is dropped
+	masterMessages := receiveAll(r.clients[master.id])
+	if assert.Len(t, masterMessages, 1) {
+		assert.Equal(t, uint32(MsgidMapUpload), masterMessages[0].Kind)
+	}
+	clientMessages := receiveAll(clientInbox)
+	if assert.Len(t, clientMessages, 2) {
+		assert.Equal(t, uint32(MsgidMapUpload), clientMessages[0].Kind)
+		assert.Equal(t, uint32(MsgidOutOfSync), clientMessages[1].Kind)
+	}
+	_, ok := r.clients[client.id]
+	assert.False(t, ok)
+}
+
+func TestDesyncSearchIsBoundedByOneDeadline(t *testing.T) {
+	log.SetOutput(ioutil.Discard)
+	defer log.SetOutput(os.Stderr)
+
+	dumpRoot, err := ioutil.TempDir("", "griefly-server-test")
+	if !assert.NoError(t, err) {
+		return
+	}
+	defer os.RemoveAll(dumpRoot)
+
+	master := &fakeClient{1, map[int]int{3: 30, 7: 70}}
+	client := &fakeClient{2, map[int]int{3: 30, 7: 71}}
+	r := newTestRegistry(t, dumpRoot, master, client)
+	if r == nil {
+		return
+	}
+	clientInbox := r.clients[client.id]
+
+	// the search has been started long ago
+	checker := &hashCheck{hashes: map[int]int{master.id: master.hash(), client.id: client.hash()}}
+	r.checkHashesOne(r.currentTick, checker, time.Now().Add(-DesyncSearchTimeout))
+	if !assert.NotNil(t, r.desync) {
+		return
+	}
+
+	// the clients reply in time to the root request, but the diverged
+	// objects are not requested anymore
+	r.handleHashTree(master.reply(receiveAll(r.clients[master.id])[0], r.currentTick))
+	r.handleHashTree(client.reply(receiveAll(clientInbox)[0], r.currentTick))
+	assert.Nil(t, r.desync)
+
+	clientMessages := receiveAll(clientInbox)
+	if assert.Len(t, clientMessages, 2) {
+		assert.Equal(t, uint32(MsgidMapUpload), clientMessages[0].Kind)
+		assert.Equal(t, uint32(MsgidOutOfSync), clientMessages[1].Kind)
+	}
+}
+
+func TestHashCheckDuringDesyncSearch(t *testing.T) {
+	log.SetOutput(ioutil.Discard)
+	defer log.SetOutput(os.Stderr)
+
+	dumpRoot, err := ioutil.TempDir("", "griefly-server-test")
+	if !assert.NoError(t, err) {
+		return
+	}
+	defer os.RemoveAll(dumpRoot)
+
+	master := &fakeClient{1, map[int]int{3: 30, 7: 70}}
+	searched := &fakeClient{2, map[int]int{3: 30, 7: 71}}
+	other := &fakeClient{3, map[int]int{3: 30, 7: 70}}
+	r := newTestRegistry(t, dumpRoot, master, searched, other)
+	if r == nil {
+		return
+	}
+	otherInbox := r.clients[other.id]
+
+	checker := &hashCheck{hashes: map[int]int{
+		master.id: master.hash(), searched.id: searched.hash(), other.id: other.hash()}}
+	r.checkHashesOne(r.currentTick, checker, time.Now())
+	search := r.desync
+	if !assert.NotNil(t, search) {
+		return
+	}
+	assert.Equal(t, []int{searched.id}, search.unsynced)
+	receiveAll(r.clients[master.id])
+	receiveAll(r.clients[searched.id])
+
+	// the hashes are still checked, the newly unsynced client is dropped
+	// without waiting for the search
+	r.currentTick++
+	other.objects[3] = 31
+	checker = &hashCheck{hashes: map[int]int{
+		master.id: master.hash(), searched.id: searched.hash(), other.id: other.hash()}}
+	r.checkHashesOne(r.currentTick, checker, time.Now())
+
+	assert.True(t, r.desync == search)
+	otherMessages := receiveAll(otherInbox)
+	if assert.Len(t, otherMessages, 2) {
+		assert.Equal(t, uint32(MsgidMapUpload), otherMessages[0].Kind)
+		assert.Equal(t, uint32(MsgidOutOfSync), otherMessages[1].Kind)
+	}
+	_, ok := r.clients[other.id]
+	assert.False(t, ok)
+	// the searched one is dropped after the search
+	assert.Empty(t, receiveAll(r.clients[searched.id]))
+}
@@ -12,12 +12,14 @@ const (
 	MsgidHash               = 3
 	MsgidRestart            = 4
 	MsgidNextTick           = 5
+	MsgidHashTree           = 6
 	MsgidSuccessfulConnect  = 201
 	MsgidMapUpload          = 202
 	MsgidNewTick            = 203
 	MsgidNewClient          = 204
 	MsgidCurrentConnections = 205
 	MsgidRequestHash        = 206
+	MsgidRequestHashTree    = 207
 
 	MsgidWrongGameVersion    = 401
 	MsgidWrongAuth           = 402
@@ -88,6 +90,8 @@ func getConcreteMessage(id uint32) Message {
 		return &MessageRestart{}
 	case id == MsgidNextTick:
 		return &MessageNextTick{}
+	case id == MsgidHashTree:
+		return &MessageHashTree{}
 
 	case id == MsgidSuccessfulConnect:
 		return &MessageSuccessfulConnect{}
@@ -101,6 +105,8 @@ func getConcreteMessage(id uint32) Message {
 		return &MessageCurrentConnections{}
 	case id == MsgidRequestHash:
 		return &MessageRequestHash{}
+	case id == MsgidRequestHashTree:
+		return &MessageRequestHashTree{}
 
 		// errors
 	case id == MsgidWrongGameVersion:
@@ -215,6 +221,33 @@ func (m *MessageRequestHash) TypeName() string {
 	return "MessageRequestHash"
 }
 
+// HashTreeChild is a child of a world hash tree node, Node is opaque
+// for the server and is sent back as is to descend into the child
+type HashTreeChild struct {
+	Node json.RawMessage `json:"node"`
+	Hash int             `json:"hash"`
+	Leaf bool            `json:"leaf"`
+	Info json.RawMessage `json:"info,omitempty"`
+}
+
+type MessageHashTree struct {
+	Node     json.RawMessage `json:"node"`
+	Children []HashTreeChild `json:"children"`
+	Tick     int             `json:"tick"`
+}
+
+func (m *MessageHashTree) TypeName() string {
+	return "MessageHashTree"
+}
+
+type MessageRequestHashTree struct {
+	Node json.RawMessage `json:"node"`
+}
+
+func (m *MessageRequestHashTree) TypeName() string {
+	return "MessageRequestHashTree"
+}
+
 type MessageSuccessfulConnect struct {
 	ID     *int   `json:"your_id" validate:"nonzero"`
 	MapURL string `json:"map" validate:"nonzero"`
@@ -20,6 +20,17 @@ func NewDumpWriter(root, sessionID string) *DumpWriter {
 	return &DumpWriter{root, sessionID}
 }
 
+// Unpacker picks the decompression by the suffix
+func dumpSuffix(contentType string) string {
+	switch contentType {
+	case QZippedContentType:
+		return ".qz"
+	case MapChunksContentType:
+		return ".chunks"
+	}
+	return ""
+}
+
 func (dw *DumpWriter) DumpMap(tag string, source *Pipe, callback func()) {
 	defer func() {
 		if err := recover(); err != nil {
@@ -30,7 +41,7 @@ func (dw *DumpWriter) DumpMap(tag string, source *Pipe, callback func()) {
 	// TODO: timeouts
 	info := <-source.info
 	if info.Err != nil {
-		log.Printf("dump-writer: client failed to upload map", info.Err)
+		log.Printf("dump-writer: client failed to upload map: %v", info.Err)
 	}
 
 	// in case of error pump rest of request body to bitsink
@@ -38,11 +49,7 @@ func (dw *DumpWriter) DumpMap(tag string, source *Pipe, callback func()) {
 
 	dir := filepath.Join(dw.root, dw.sessionID)
 	os.MkdirAll(dir, os.ModePerm)
-	filename := tag + ".mapdump"
-
-	if info.ContentType == QZippedContentType {
-		filename += ".qz"
-	}
+	filename := tag + ".mapdump" + dumpSuffix(info.ContentType)
 
 	target, err := os.Create(filepath.Join(dir, filename))
 	if err != nil {
@@ -0,0 +1,13 @@
+package main
+
+import (
+	"testing"
+
+	"github.com/stretchr/testify/assert"
+)
+
+func TestDumpSuffix(t *testing.T) {
+	assert.Equal(t, ".qz", dumpSuffix(QZippedContentType))
+	assert.Equal(t, ".chunks", dumpSuffix(MapChunksContentType))
+	assert.Equal(t, "", dumpSuffix(DefalutContentType))
+}
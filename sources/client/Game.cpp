@@ -240,7 +240,7 @@ void Game::ProcessInputMessages()
 
             qDebug() << "Map will be generated";
 
-            data = world_->SaveWorld();
+            world_->SaveWorld(&data);
             AddLastMessages(&data);
             AddBuildInfo(&data);
 
@@ -266,6 +266,19 @@ void Game::ProcessInputMessages()
             continue;
         }
 
+        if (msg.type == message_type::REQUEST_HASH_TREE)
+        {
+            Message msg_tree;
+
+            msg_tree.type = message_type::HASH_TREE_MESSAGE;
+            msg_tree.data = world_->GetHashTreeNode(msg.data["node"].toObject());
+            msg_tree.data["tick"] = world_->GetGameTick();
+
+            Network2::GetInstance().Send(msg_tree);
+
+            continue;
+        }
+
         if (msg.type == message_type::PING)
         {
             QString ping_id = msg.data["ping_id"].toString();
@@ -14,6 +14,7 @@
 #include <QCoreApplication>
 
 #include <CoreInterface.h>
+#include <MapChunks.h>
 
 using kv::Message;
 
@@ -34,8 +35,8 @@ void Network2::sendMap(const QString& url, const QByteArray& data_raw)
     QByteArray data = data_raw;
     if (prefer_compress_)
     {
-        type_header = "application/zip";
-        data = qCompress(data);
+        type_header = MapChunks::CONTENT_TYPE;
+        data = MapChunks::Compress(data);
     }
 
     QNetworkRequest request(QUrl{url});
@@ -160,11 +161,26 @@ void Network2::mapDownloaded(QNetworkReply* reply)
         return;
     }
 
-    map_data_ = reply->readAll();
-    if (reply->header(QNetworkRequest::ContentTypeHeader) == "application/zip")
+    const QString content_type = reply->header(QNetworkRequest::ContentTypeHeader).toString();
+    if (content_type == MapChunks::CONTENT_TYPE)
     {
-        qDebug() << "Compressed map length: " << map_data_.length();
-        map_data_ = qUncompress(map_data_);
+        if (   !map_uncompressor_.Append(reply->readAll())
+            || !map_uncompressor_.IsFinished())
+        {
+            emit connectionFailed("Unable download map: the map data is corrupted");
+            reply->deleteLater();
+            return;
+        }
+        map_data_ = map_uncompressor_.TakeResult();
+    }
+    else
+    {
+        map_data_ = reply->readAll();
+        if (content_type == "application/zip")
+        {
+            qDebug() << "Compressed map length: " << map_data_.length();
+            map_data_ = qUncompress(map_data_);
+        }
     }
     reply->deleteLater();
 
@@ -187,8 +203,23 @@ void Network2::downloadMap(int your_id, const QString& map)
 
     qDebug() << "Begin download map from " << map_url_;
 
+    map_uncompressor_ = MapChunks::Uncompressor();
     const QNetworkRequest request(QUrl{map_url_});
-    net_manager_->get(request);
+    QNetworkReply* reply = net_manager_->get(request);
+    connect(reply, &QNetworkReply::readyRead, this, &Network2::mapDataReceived);
+}
+
+void Network2::mapDataReceived()
+{
+    QNetworkReply* reply = qobject_cast<QNetworkReply*>(sender());
+    if (   !reply
+        || reply->header(QNetworkRequest::ContentTypeHeader).toString() != MapChunks::CONTENT_TYPE)
+    {
+        // Other formats are read at once when the download is finished
+        return;
+    }
+    // Errors are reported when the download is finished
+    map_uncompressor_.Append(reply->readAll());
 }
 
 SocketHandler::SocketHandler(Network2* network)
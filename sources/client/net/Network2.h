@@ -15,6 +15,7 @@
 #include <QNetworkReply>
 
 #include <Messages.h>
+#include <MapChunks.h>
 
 const int MAX_WAIT_ON_QUEUE = 90;
 
@@ -148,6 +149,7 @@ signals:
     void connectionFailed(const QString& reason);
 private slots:
     void mapDownloaded(QNetworkReply* reply);
+    void mapDataReceived();
     void downloadMap(int your_id, const QString& map);
 private:
     bool is_good_;
@@ -171,4 +173,5 @@ private:
 
     QNetworkAccessManager* net_manager_;
     QByteArray map_data_;
+    MapChunks::Uncompressor map_uncompressor_;
 };
@@ -1,6 +1,9 @@
 #pragma once
 
 #include <unordered_map>
+#include <vector>
+
+#include <QVector>
 
 #include "objects/Object.h"
 
@@ -9,7 +12,35 @@ using VoidItemCreator = kv::Object*(*)();
 
 std::unordered_map<QString, ItemCreator>* GetItemsCreators();
 
-std::unordered_map<QString, VoidItemCreator>* GetVoidItemsCreators();
+struct VoidItemCreatorInfo
+{
+    QString type;
+    VoidItemCreator creator;
+};
+
+// Indexed by TYPE_INDEX
+std::vector<VoidItemCreatorInfo>* GetVoidItemsCreators();
+
+using BatchProcessor = void(*)(const QVector<kv::Object*>& objects);
+
+// Indexed by TYPE_INDEX, nullptr for the types without KV_PROCESS_BATCH
+std::vector<BatchProcessor>* GetBatchProcessors();
+
+// Indexed by TYPE_INDEX, position of the type among the types sorted by name.
+// Type indexes depend on the build, so everything synchronized orders types by this
+const std::vector<int>& GetTypesNameOrder();
+
+// Flat functions which save, load and hash all members of exactly one type
+// without virtual calls
+struct ObjectSerializer
+{
+    void(*save)(kv::Object* object, kv::FastSerializer& file);
+    void(*load)(kv::Object* object, kv::FastDeserializer& file);
+    unsigned int(*hash)(kv::Object* object);
+};
+
+// Indexed by TYPE_INDEX
+extern const ObjectSerializer OBJECT_SERIALIZERS[];
 
 using VariableSetter = void(*)(kv::Object* ptr, kv::FastDeserializer& str);
 
@@ -26,3 +57,6 @@ std::unordered_map<QString, VariablesForType>& GetVariablesForTypes();
 void InitRealTypes();
 void InitCreators();
 void InitSettersForTypes();
+
+// Hash of the types and the order of their saved variables
+quint32 GetSchemaHash();
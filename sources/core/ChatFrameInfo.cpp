@@ -5,8 +5,8 @@ using namespace kv;
 void ChatFrameInfo::Reset()
 {
     personal_.clear();
-    visible_.clear();
-    hear_.clear();
+    visible_.Clear();
+    hear_.Clear();
 }
 
 void ChatFrameInfo::PostPersonal(const QString& text, quint32 net_id)
@@ -16,17 +16,17 @@ void ChatFrameInfo::PostPersonal(const QString& text, quint32 net_id)
 
 void ChatFrameInfo::PostVisible(const QString& text, const Position& place)
 {
-    visible_[place].append(text);
+    visible_.Add(place, text);
 }
 
 void ChatFrameInfo::PostHear(const Phrase& phrase, const Position& place)
 {
-    hear_[place].append(phrase);
+    hear_.Add(place, phrase);
 }
 
 const QHash<Position, QVector<QString>>& ChatFrameInfo::GetVisible() const
 {
-    return visible_;
+    return visible_.GetValues();
 }
 
 const QVector<QString>& ChatFrameInfo::GetPersonalTexts(const quint32 net_id) const
@@ -44,30 +44,24 @@ void ChatFrameInfo::AddFromVisibleToPersonal(
     const QVector<Position>& points, const quint32 net_id)
 {
     auto& personal = personal_[net_id];
-    for (const auto& point : points)
+    visible_.ForEachOn(points, [&personal](const QString& text)
     {
-        for (const auto& text : visible_[point])
-        {
-            personal.append(text);
-        }
-    }
+        personal.append(text);
+    });
 }
 
 void ChatFrameInfo::ApplyHear(Hearer* hearer)
 {
     kv::Assert(hearer, "ChatFrameInfo::ApplyHear(): hearer is nullptr");
 
-    const auto& points = hearer->GetHeardPoints();
-    for (const auto& point : points)
+    // Heard points may be expensive to calculate, and usually nobody speaks
+    if (hear_.IsEmpty())
     {
-        const auto phrases = hear_.find(point);
-        if (phrases == hear_.end())
-        {
-            continue;
-        }
-        for (const Phrase& phrase : *phrases)
-        {
-            hearer->Hear(phrase);
-        }
+        return;
     }
+
+    hear_.ForEachOn(hearer->GetHeardPoints(), [hearer](const Phrase& phrase)
+    {
+        hearer->Hear(phrase);
+    });
 }
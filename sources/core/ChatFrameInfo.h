@@ -6,6 +6,7 @@
 #include "KvGlobals.h"
 
 #include "Hearer.h"
+#include "SpatialBuckets.h"
 
 namespace kv
 {
@@ -24,12 +25,17 @@ public:
 
     void AddFromVisibleToPersonal(const QVector<Position>& points, quint32 net_id);
     const QHash<Position, QVector<QString>>& GetVisible() const;
+    template<typename Function>
+    void ForEachVisibleOn(const QVector<Position>& points, Function function) const
+    {
+        visible_.ForEachOn(points, function);
+    }
 
     void ApplyHear(Hearer* hearer);
 private:
     QHash<quint32, QVector<QString>> personal_;
-    QHash<Position, QVector<QString>> visible_;
-    QHash<Position, QVector<Phrase>> hear_;
+    SpatialBuckets<QString> visible_;
+    SpatialBuckets<Phrase> hear_;
 };
 
 }
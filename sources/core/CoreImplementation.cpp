@@ -1,7 +1,11 @@
 #include "CoreImplementation.h"
 
+#include <algorithm>
+
 #include <QDateTime>
 #include <QElapsedTimer>
+#include <QJsonArray>
+#include <QThread>
 
 #include "core_headers/CoreInterface.h"
 
@@ -25,14 +29,20 @@
 #include "atmos/Atmos.h"
 #include "ObjectFactory.h"
 #include "Names.h"
+#include "SaveableOperators.h"
 
 #include "Version.h"
 
 std::vector<ObjectInfo>* id_ptr_id_table = nullptr;
+bool id_ptr_read_only = false;
+quint32 id_ptr_cache_epoch = 0;
 
 namespace
 {
 
+// In ticks, see WorldImplementation::Hash
+const int FULL_HASH_CHECK_PERIOD = 50;
+
 kv::CoreInterface::ObjectsMetadata GenerateMetadata()
 {
     InitSettersForTypes();
@@ -84,7 +94,8 @@ namespace kv
 {
 
 WorldImplementation::WorldImplementation()
-    : atmos_(new Atmosphere),
+    : workers_(new WorkerPool(std::max(1, QThread::idealThreadCount()))),
+      atmos_(new Atmosphere(workers_.get())),
       factory_(new ObjectFactory(this)),
       names_(new Names(this)),
       process_messages_ns_(0),
@@ -146,28 +157,33 @@ void WorldImplementation::FinishTick()
 void WorldImplementation::ProcessHearers()
 {
     QVector<IdPtr<Object>>& hearers = global_objects_->hearers;
-    QVector<IdPtr<Object>> deleted_hearers;
 
-    for (IdPtr<Object>& hearer : hearers)
+    // Deleted hearers are dropped during the same pass,
+    // the order of the remaining ones is kept
+    int kept = 0;
+    for (int i = 0; i < hearers.size(); ++i)
     {
+        // Non-const, Hear() can change the hearer
+        IdPtr<Object> hearer = hearers[i];
         if (!hearer.IsValid())
         {
-            deleted_hearers.append(hearer);
             continue;
         }
         chat_frame_info_.ApplyHear(hearer->ToHearer());
+        if (kept != i)
+        {
+            hearers[kept] = hearer;
+        }
+        ++kept;
     }
-
-    for (const IdPtr<Object>& deleted : qAsConst(deleted_hearers))
-    {
-        hearers.erase(std::find(hearers.begin(), hearers.end(), deleted));
-    }
+    hearers.resize(kept);
 }
 
 void WorldImplementation::RemoveStaleRepresentation()
 {
-    sounds_for_frame_.clear();
+    sounds_for_frame_.Clear();
     chat_frame_info_.Reset();
+    GetMap().RemoveUnusedLos();
 }
 
 namespace key
@@ -248,38 +264,44 @@ void WorldImplementation::PostOoc(const QString& who, const QString& text)
 
 void WorldImplementation::Represent(const QVector<PlayerAndFrame>& frames) const
 {
-    for (const PlayerAndFrame& player_and_frame : frames)
+    // Frames only read the world, so they are generated concurrently
+    id_ptr_read_only = true;
+    workers_->ParallelFor(frames.size(), [this, &frames](int index)
     {
-        const quint32 player_net_id = player_and_frame.first;
-        GrowingFrame* frame = player_and_frame.second;
+        RepresentFor(frames[index].first, frames[index].second);
+    });
+    id_ptr_read_only = false;
+}
 
-        AppendSystemTexts(frame);
+void WorldImplementation::RepresentFor(quint32 player_net_id, GrowingFrame* frame) const
+{
+    AppendSystemTexts(frame);
 
-        IdPtr<Mob> mob = GetPlayerId(player_net_id);
-        if (!mob.IsValid())
-        {
-            qDebug() << "Oops! No mob for such net id!" << player_net_id;
-            continue;
-        }
+    const IdPtr<Mob> mob = GetPlayerId(player_net_id);
+    if (!mob.IsValid())
+    {
+        qDebug() << "Oops! No mob for such net id!" << player_net_id;
+        return;
+    }
 
-        VisiblePoints points;
-        mob->CalculateVisible(&points);
-        GetMap().Represent(frame, points, mob);
-        mob->GenerateInterfaceForFrame(frame);
+    VisiblePoints points;
+    mob->CalculateVisible(&points);
+    GetMap().Represent(frame, points, mob);
+    mob->GenerateInterfaceForFrame(frame);
 
-        GetAtmosphere().Represent(frame);
+    GetAtmosphere().Represent(frame);
 
-        AppendSoundsToFrame(frame, points, player_net_id);
-        AppendChatMessages(frame, points, player_net_id);
+    AppendSoundsToFrame(frame, points, player_net_id);
+    AppendChatMessages(frame, points, player_net_id);
 
-        // TODO: reset all shifts
-        frame->SetCamera(mob->GetPosition().x, mob->GetPosition().y);
-    }
+    // TODO: reset all shifts
+    frame->SetCamera(mob->GetPosition().x, mob->GetPosition().y);
 }
 
 qint32 WorldImplementation::GetGameTick() const
 {
-    return GetGlobals()->game_tick;
+    const IdPtr<GlobalObjectsHolder> globals = GetGlobals();
+    return globals->game_tick;
 }
 
 void WorldImplementation::AppendSystemTexts(GrowingFrame* frame) const
@@ -293,7 +315,10 @@ void WorldImplementation::AppendSystemTexts(GrowingFrame* frame) const
         append("Performance", text, (ns * 1.0) / 1000000.0);
     };
 
-    append("Main", "Game tick: %1", GetGlobals()->game_tick);
+    // The temporary IdPtr would take the non-const access path,
+    // which is forbidden during the representation
+    const IdPtr<GlobalObjectsHolder> globals = GetGlobals();
+    append("Main", "Game tick: %1", globals->game_tick);
 
     append_ns("Process objects: %1 ms", foreach_process_ns_);
     append_ns("Process physics movement: %1 ms", physics_process_ns_);
@@ -304,15 +329,10 @@ void WorldImplementation::AppendSystemTexts(GrowingFrame* frame) const
 void WorldImplementation::AppendSoundsToFrame(
     GrowingFrame* frame, const VisiblePoints& points, quint32 net_id) const
 {
-    // TODO: Sounds for frame may be hash table or some sorted vector
-    // now scalability is quite bad
-    for (auto it : qAsConst(sounds_for_frame_))
+    sounds_for_frame_.ForEachOn(points, [frame](const QString& sound)
     {
-        if (std::find(points.begin(), points.end(), it.first) != points.end())
-        {
-            frame->Append(FrameData::Sound{it.second});
-        }
-    }
+        frame->Append(FrameData::Sound{sound});
+    });
 
     auto& musics_for_mobs = global_objects_->musics_for_mobs;
 
@@ -329,14 +349,10 @@ void WorldImplementation::AppendSoundsToFrame(
 void WorldImplementation::AppendChatMessages(
     GrowingFrame* frame, const VisiblePoints& points, quint32 net_id) const
 {
-    auto& visible = GetChatFrameInfo().GetVisible();
-    for (const auto& point : points)
+    GetChatFrameInfo().ForEachVisibleOn(points, [frame](const QString& text)
     {
-        for (const auto& text : visible[point])
-        {
-            frame->Append(FrameData::ChatMessage{text});
-        }
-    }
+        frame->Append(FrameData::ChatMessage{text});
+    });
 
     for (const auto& personal : chat_frame_info_.GetPersonalTexts(net_id))
     {
@@ -346,14 +362,158 @@ void WorldImplementation::AppendChatMessages(
 
 quint32 WorldImplementation::Hash() const
 {
-    return factory_->Hash();
+    quint32 objects_hash = factory_->Hash();
+
+    // Objects changed without the non-const IdPtr access are not rehashed
+    // by the factory, so the clients would be desynced silently.
+    // The full hash is slow, so in release it is checked only from time to time
+#ifdef QT_NO_DEBUG
+    const bool check_full
+        = global_objects_.IsValid() && ((GetGameTick() % FULL_HASH_CHECK_PERIOD) == 0);
+#else
+    const bool check_full = true;
+#endif
+    if (check_full)
+    {
+        const quint32 full_hash = factory_->HashFull();
+        if (objects_hash != full_hash)
+        {
+            const QString message = QString("Incremental objects hash %1 differs from the full one %2")
+                .arg(objects_hash).arg(full_hash);
+#ifndef QT_NO_DEBUG
+            kv::Abort(message);
+#endif
+            qDebug() << message;
+            // The cached parts of the hash are fixed too
+            factory_->MarkAllObjectsChanged();
+            objects_hash = factory_->Hash();
+        }
+    }
+    return objects_hash + atmos_->Hash();
+}
+
+namespace
+{
+
+const quint32 HASH_TREE_FANOUT = 16;
+
+QJsonObject MakeHashTreeChild(
+    const QJsonObject& node, quint32 hash, bool leaf, const QJsonObject& info = QJsonObject())
+{
+    QJsonObject retval;
+    retval["node"] = node;
+    retval["hash"] = static_cast<double>(hash);
+    retval["leaf"] = leaf;
+    if (!info.isEmpty())
+    {
+        retval["info"] = info;
+    }
+    return retval;
+}
+
+}
+
+QJsonObject WorldImplementation::GetHashTreeNode(const QJsonObject& node) const
+{
+    // Cached parts of the hash are updated there
+    Hash();
+
+    const quint32 table_size = static_cast<quint32>(factory_->GetIdTable().size());
+    const QString kind = node["kind"].toString();
+
+    QJsonArray children;
+    if (kind.isEmpty())
+    {
+        children.append(MakeHashTreeChild(
+            QJsonObject{{"kind", "objects"}}, factory_->HashIdsRange(0, table_size), false));
+        // The types sums add up to the objects hash, so their names are hashed too
+        children.append(MakeHashTreeChild(
+            QJsonObject{{"kind", "types"}}, ::Hash(factory_->HashTypes()), false));
+        children.append(MakeHashTreeChild(
+            QJsonObject{{"kind", "atmos"}}, atmos_->Hash(), true));
+        if (global_objects_.IsValid() && global_objects_->random.IsValid())
+        {
+            const auto& random = global_objects_->random;
+            children.append(MakeHashTreeChild(
+                QJsonObject{{"kind", "random"}},
+                factory_->HashIdsRange(kv::IdIndex(random.Id()), kv::IdIndex(random.Id()) + 1),
+                true,
+                QJsonObject{{"seed", static_cast<double>(random->GetSeed())},
+                            {"calls_counter", static_cast<double>(random->GetCallsCounter())}}));
+        }
+    }
+    else if (kind == "objects")
+    {
+        const quint32 begin = static_cast<quint32>(node["begin"].toDouble(0));
+        const quint32 end = static_cast<quint32>(node["end"].toDouble(table_size));
+        if ((end - begin) <= HASH_TREE_FANOUT)
+        {
+            for (quint32 id = begin; id < std::min(end, table_size); ++id)
+            {
+                const kv::Object* object = factory_->GetIdTable()[id].object;
+                children.append(MakeHashTreeChild(
+                    QJsonObject{{"kind", "object"}, {"id", static_cast<double>(id)}},
+                    factory_->HashIdsRange(id, id + 1),
+                    true,
+                    QJsonObject{{"type", object ? object->GetType() : QString()}}));
+            }
+        }
+        else
+        {
+            const quint32 step = (end - begin + HASH_TREE_FANOUT - 1) / HASH_TREE_FANOUT;
+            for (quint32 child_begin = begin; child_begin < end; child_begin += step)
+            {
+                const quint32 child_end = std::min(child_begin + step, end);
+                children.append(MakeHashTreeChild(
+                    QJsonObject{{"kind", "objects"},
+                                {"begin", static_cast<double>(child_begin)},
+                                {"end", static_cast<double>(child_end)}},
+                    factory_->HashIdsRange(child_begin, child_end),
+                    false));
+            }
+        }
+    }
+    else if (kind == "types")
+    {
+        const QMap<QString, quint32> types = factory_->HashTypes();
+        for (auto it = types.begin(); it != types.end(); ++it)
+        {
+            children.append(MakeHashTreeChild(
+                QJsonObject{{"kind", "type"}, {"type", it.key()}}, it.value(), true));
+        }
+    }
+    else
+    {
+        qDebug() << "Unknown hash tree node:" << node;
+    }
+
+    QJsonObject retval;
+    retval["node"] = node;
+    retval["children"] = children;
+    return retval;
+}
+
+void WorldImplementation::SaveWorld(QByteArray* data) const
+{
+    FastSerializer serializer(data);
+    serializer.SetMode(FastSerializer::Mode::COMPACT);
+    world::Save(this, serializer);
 }
 
-QByteArray WorldImplementation::SaveWorld() const
+void WorldImplementation::SaveWorldTagged(QByteArray* data) const
 {
-    FastSerializer serializer;
+    FastSerializer serializer(data);
     world::Save(this, serializer);
-    return QByteArray(serializer.GetData(), serializer.GetIndex());
+}
+
+WorldInterface::TickPerformance WorldImplementation::GetTickPerformance() const
+{
+    TickPerformance retval;
+    retval.objects_ns = foreach_process_ns_;
+    retval.atmos_ns = atmos_process_ns_;
+    retval.physics_ns = physics_process_ns_;
+    retval.deletion_ns = deletion_process_ns_;
+    return retval;
 }
 
 AtmosInterface& WorldImplementation::GetAtmosphere()
@@ -453,9 +613,14 @@ void WorldImplementation::PerformUnsync()
     }
 }
 
+void WorldImplementation::SetLosEngine(LosEngine engine)
+{
+    GetMap().SetLosEngine(engine);
+}
+
 void WorldImplementation::AddSound(const QString& name, const Position position)
 {
-    sounds_for_frame_.append({position, name});
+    sounds_for_frame_.Add(position, name);
 }
 
 void WorldImplementation::PlayMusic(const QString& name, const int volume, const quint32 mob)
@@ -506,7 +671,6 @@ void WorldImplementation::AfterMapgen(const quint32 id, const bool unsync_genera
 CoreImplementation::CoreImplementation()
 {
     InitRealTypes();
-    InitCastTable();
     InitSettersForTypes();
 }
 
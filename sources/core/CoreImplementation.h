@@ -4,7 +4,9 @@
 #include "Interfaces.h"
 
 #include "ChatFrameInfo.h"
+#include "SpatialBuckets.h"
 #include "WorldLoaderSaver.h"
+#include "WorkerPool.h"
 
 namespace kv
 {
@@ -25,8 +27,12 @@ public:
 
     virtual qint32 GetGameTick() const override;
     virtual quint32 Hash() const override;
+    virtual QJsonObject GetHashTreeNode(const QJsonObject& node) const override;
 
-    virtual QByteArray SaveWorld() const override;
+    virtual void SaveWorld(QByteArray* data) const override;
+    virtual void SaveWorldTagged(QByteArray* data) const override;
+
+    virtual TickPerformance GetTickPerformance() const override;
 
     // Game interface
     virtual AtmosInterface& GetAtmosphere() override;
@@ -53,6 +59,8 @@ public:
 
     virtual void PerformUnsync() override;
 
+    virtual void SetLosEngine(LosEngine engine) override;
+
     void PrepareToMapgen();
     void AfterMapgen(quint32 id, bool unsync_generation);
 private:
@@ -61,12 +69,16 @@ private:
 
     void PostOoc(const QString& who, const QString& text);
 
+    // Reads the world only, so it is safe to call it concurrently
+    void RepresentFor(quint32 player_net_id, GrowingFrame* frame) const;
+
     void AppendSystemTexts(GrowingFrame* frame) const;
     void AppendSoundsToFrame(GrowingFrame* frame, const VisiblePoints& points, quint32 net_id) const;
     void AppendChatMessages(GrowingFrame* frame, const VisiblePoints& points, quint32 net_id) const;
 
     void ProcessHearers();
 
+    std::unique_ptr<WorkerPool> workers_;
     std::unique_ptr<AtmosInterface> atmos_;
     std::unique_ptr<ObjectFactoryInterface> factory_;
     std::unique_ptr<Names> names_;
@@ -77,7 +89,7 @@ private:
 
     IdPtr<kv::Mob> current_mob_;
 
-    QVector<QPair<kv::Position, QString>> sounds_for_frame_;
+    SpatialBuckets<QString> sounds_for_frame_;
 
     // Perfomance
     qint64 process_messages_ns_;
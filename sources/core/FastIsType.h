@@ -1,8 +1,5 @@
 #pragma once
 
-#include <QVector>
-#include <QBitArray>
-
 #include <kvengine_export.h>
 
 #if !defined(_MSC_VER)
@@ -14,15 +11,16 @@ namespace kv
     class Object;
 }
 
-extern KVENGINE_EXPORT std::vector<QBitArray>* cast_table;
+// Generated by autogen.py. Types are numbered in the pre-order of the hierarchy,
+// so all descendants of a type follow it and a type check is a range check.
+extern KVENGINE_EXPORT const int TYPES_DESCENDANTS_AMOUNT[];
 
 __forceinline bool FastIsType(int typeto, int typefrom)
 {
-    return (*cast_table)[typefrom].testBit(typeto);
+    return static_cast<unsigned int>(typefrom - typeto)
+        <= static_cast<unsigned int>(TYPES_DESCENDANTS_AMOUNT[typeto]);
 }
 
-void InitCastTable();
-
 template<typename Typeto>
 inline bool FastIsType(int typefrom)
 {
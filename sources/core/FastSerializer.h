@@ -1,8 +1,12 @@
 #pragma once
 
+#include <QByteArray>
 #include <QDebug>
+#include <QHash>
 #include <QString>
 
+#include <algorithm>
+#include <limits>
 #include <type_traits>
 #include <vector>
 
@@ -49,22 +53,50 @@ public:
     static const Type BYTEARRAY_TYPE = 5;
     static const Type TYPE_TYPE = 6;
     static const Type INT64_TYPE = 7;
+    static const Type TYPE_INDEX_TYPE = 8;
+
+    enum class Mode
+    {
+        // Each value is prefixed by its type, numbers have fixed width
+        TAGGED,
+        // No types, numbers are zig-zag varints, strings are UTF-8
+        // and each string is written only once per stream
+        COMPACT
+    };
 
     static const int DEFAULT_SIZE = 32 * 1024 * 1024;
     FastSerializer(int size = DEFAULT_SIZE)
-        : index_(0)
+        : sink_(&own_data_),
+          index_(0),
+          mode_(Mode::TAGGED)
+    {
+        own_data_.resize(size);
+        data_ = own_data_.data();
+    }
+    // Appends right to the end of the sink without intermediate buffers,
+    // the sink is truncated to the written data in the destructor
+    explicit FastSerializer(QByteArray* sink)
+        : sink_(sink),
+          index_(static_cast<quint32>(sink->size())),
+          mode_(Mode::TAGGED)
     {
-        data_.resize(size);
+        data_ = sink_->data();
     }
+    FastSerializer(const FastSerializer& other) = delete;
+    FastSerializer& operator=(const FastSerializer& other) = delete;
 
     ~FastSerializer()
     {
-        // Nothing
+        if (sink_ != &own_data_)
+        {
+            sink_->resize(static_cast<int>(index_));
+        }
     }
 
     void ResetIndex()
     {
         index_ = 0;
+        strings_.clear();
     }
     quint32 GetIndex()
     {
@@ -72,15 +104,80 @@ public:
     }
     char* GetData()
     {
-        return data_.data();
+        return data_;
+    }
+    Mode GetMode() const
+    {
+        return mode_;
+    }
+    void SetMode(Mode mode)
+    {
+        mode_ = mode;
     }
     void WriteType(const QString& type)
     {
         Write(type, TYPE_TYPE);
     }
+    // Index from the types dictionary of the save, stored as a varint
+    void WriteTypeIndex(quint32 index)
+    {
+        if (mode_ == Mode::TAGGED)
+        {
+            Preallocate(1);
+            data_[index_] = TYPE_INDEX_TYPE;
+            ++index_;
+        }
+        WriteVarint(index);
+    }
+    static quint64 ZigZag(qint64 value)
+    {
+        return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+    }
 private:
+    void WriteVarint(quint64 value)
+    {
+        const int MAX_VARINT_SIZE = 10;
+        Preallocate(MAX_VARINT_SIZE);
+
+        while (value >= 0x80)
+        {
+            data_[index_] = static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+            ++index_;
+        }
+        data_[index_] = static_cast<char>(value);
+        ++index_;
+    }
+    void WriteCompact(const QString& value)
+    {
+        auto it = strings_.find(value);
+        if (it != strings_.end())
+        {
+            WriteVarint(it.value() + 1);
+            return;
+        }
+        strings_.insert(value, static_cast<quint32>(strings_.size()));
+
+        WriteVarint(0);
+        WriteCompact(value.toUtf8());
+    }
+    void WriteCompact(const QByteArray& value)
+    {
+        WriteVarint(static_cast<quint32>(value.size()));
+        Preallocate(value.size());
+        std::copy(value.begin(), value.end(), data_ + index_);
+        index_ += value.size();
+    }
+
     void Write(bool value)
     {
+        if (mode_ == Mode::COMPACT)
+        {
+            Preallocate(1);
+            data_[index_] = value;
+            ++index_;
+            return;
+        }
         Preallocate(2);
         data_[index_] = BOOL_TYPE;
         data_[index_ + 1] = value;
@@ -88,6 +185,11 @@ private:
     }
     void Write(qint32 value)
     {
+        if (mode_ == Mode::COMPACT)
+        {
+            WriteVarint(ZigZag(value));
+            return;
+        }
         Preallocate(5);
 
         data_[index_ + 0] = INT32_TYPE;
@@ -100,6 +202,11 @@ private:
     }
     void Write(quint32 value)
     {
+        if (mode_ == Mode::COMPACT)
+        {
+            WriteVarint(value);
+            return;
+        }
         Preallocate(5);
 
         data_[index_ + 0] = UINT32_TYPE;
@@ -113,6 +220,11 @@ private:
 
     void Write(const QString& value, Type type = STRING_TYPE)
     {
+        if (mode_ == Mode::COMPACT)
+        {
+            WriteCompact(value);
+            return;
+        }
         const QChar* data = value.data();
         const int size = value.size();
 
@@ -134,6 +246,11 @@ private:
     }
     void Write(const QByteArray& value)
     {
+        if (mode_ == Mode::COMPACT)
+        {
+            WriteCompact(value);
+            return;
+        }
         Preallocate(1);
         data_[index_ + 0] = BYTEARRAY_TYPE;
         ++index_;
@@ -150,6 +267,11 @@ private:
     }
     void Write(qint64 value)
     {
+        if (mode_ == Mode::COMPACT)
+        {
+            WriteVarint(ZigZag(value));
+            return;
+        }
         const int TYPE_SIZE = sizeof(value);
 
         Preallocate(TYPE_SIZE + 1);
@@ -167,14 +289,29 @@ private:
     void Write(const char* value);
     void Preallocate(int size)
     {
-        while ((index_ + size) > data_.size())
+        const int required = static_cast<int>(index_) + size;
+        if (required <= sink_->size())
         {
-            data_.resize(data_.size() * 2);
+            return;
         }
+
+        const int MIN_SIZE = 1024;
+        int new_size = std::max(sink_->size(), MIN_SIZE);
+        while (new_size < required)
+        {
+            new_size *= 2;
+        }
+        sink_->resize(new_size);
+        data_ = sink_->data();
     }
 
-    std::vector<char> data_;
+    QByteArray own_data_;
+    QByteArray* sink_;
+    char* data_;
     quint32 index_;
+
+    Mode mode_;
+    QHash<QString, quint32> strings_;
 };
 
 template<class T>
@@ -199,7 +336,8 @@ public:
     FastDeserializer(const char* data, quint32 size)
         : data_(data),
           size_(size),
-          index_(0)
+          index_(0),
+          mode_(FastSerializer::Mode::TAGGED)
     {
         // Nothing
     }
@@ -215,12 +353,35 @@ public:
     {
         return index_;
     }
+    FastSerializer::Mode GetMode() const
+    {
+        return mode_;
+    }
+    void SetMode(FastSerializer::Mode mode)
+    {
+        mode_ = mode;
+    }
     void ReadType(QString* value)
     {
         Read(value, FastSerializer::TYPE_TYPE);
     }
+    void ReadTypeIndex(quint32* value)
+    {
+        if (mode_ == FastSerializer::Mode::TAGGED)
+        {
+            EnsureType(FastSerializer::TYPE_INDEX_TYPE);
+        }
+        *value = ReadVarint32();
+    }
+    static qint64 UnZigZag(quint64 value)
+    {
+        return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+    }
     bool IsNextType(FastSerializer::Type type)
     {
+        kv::Assert(
+            mode_ == FastSerializer::Mode::TAGGED,
+            "Types are not stored in the compact mode!");
         if (IsEnd())
         {
             return false;
@@ -233,13 +394,78 @@ public:
     }
     FastSerializer::Type GetNextType() const
     {
+        kv::Assert(
+            mode_ == FastSerializer::Mode::TAGGED,
+            "Types are not stored in the compact mode!");
         kv::Assert(!IsEnd(), "Cannot determine the next type because the end has been reached!");
         return data_[index_];
     }
 private:
+    quint64 ReadVarint()
+    {
+        const int MAX_SHIFT = 63;
+
+        quint64 value = 0;
+        for (int shift = 0; ; shift += 7)
+        {
+            EnsureSize(1);
+            const quint64 byte = static_cast<unsigned char>(data_[index_]);
+            ++index_;
+
+            value |= (byte & 0x7F) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+            if (shift >= MAX_SHIFT)
+            {
+                kv::Abort("FastDeserializer: too long varint!");
+            }
+        }
+    }
+    quint32 ReadVarint32()
+    {
+        const quint64 value = ReadVarint();
+        if (value > std::numeric_limits<quint32>::max())
+        {
+            kv::Abort("FastDeserializer: varint is out of range!");
+        }
+        return static_cast<quint32>(value);
+    }
+    void ReadCompact(QString* value)
+    {
+        const quint32 id = ReadVarint32();
+        if (id != 0)
+        {
+            if (id > strings_.size())
+            {
+                kv::Abort(QString("FastDeserializer: unknown string id: %1").arg(id));
+            }
+            *value = strings_[id - 1];
+            return;
+        }
+
+        const quint32 size = ReadVarint32();
+        EnsureSize(size);
+        *value = QString::fromUtf8(data_ + index_, static_cast<int>(size));
+        index_ += size;
+
+        strings_.push_back(*value);
+    }
+    void ReadCompact(QByteArray* value)
+    {
+        const quint32 size = ReadVarint32();
+        EnsureSize(size);
+        *value = QByteArray(data_ + index_, static_cast<int>(size));
+        index_ += size;
+    }
+
     void Read(bool* value)
     {
-        EnsureType(FastSerializer::BOOL_TYPE);
+        if (mode_ == FastSerializer::Mode::TAGGED)
+        {
+            EnsureType(FastSerializer::BOOL_TYPE);
+        }
         EnsureSize(1);
 
         *value = data_[index_];
@@ -248,6 +474,17 @@ private:
 
     void Read(qint32* value)
     {
+        if (mode_ == FastSerializer::Mode::COMPACT)
+        {
+            const qint64 result = UnZigZag(ReadVarint());
+            if (   result < std::numeric_limits<qint32>::min()
+                || result > std::numeric_limits<qint32>::max())
+            {
+                kv::Abort("FastDeserializer: varint is out of range!");
+            }
+            *value = static_cast<qint32>(result);
+            return;
+        }
         EnsureType(FastSerializer::INT32_TYPE);
         EnsureSize(4);
 
@@ -272,6 +509,11 @@ private:
 
     void Read(quint32* value)
     {
+        if (mode_ == FastSerializer::Mode::COMPACT)
+        {
+            *value = ReadVarint32();
+            return;
+        }
         EnsureType(FastSerializer::UINT32_TYPE);
         EnsureSize(4);
 
@@ -298,6 +540,11 @@ private:
         QString* value,
         FastSerializer::Type type = FastSerializer::STRING_TYPE)
     {
+        if (mode_ == FastSerializer::Mode::COMPACT)
+        {
+            ReadCompact(value);
+            return;
+        }
         EnsureType(type);
 
         int size;
@@ -325,6 +572,11 @@ private:
 
     void Read(QByteArray* value)
     {
+        if (mode_ == FastSerializer::Mode::COMPACT)
+        {
+            ReadCompact(value);
+            return;
+        }
         EnsureType(FastSerializer::BYTEARRAY_TYPE);
 
         int size;
@@ -344,6 +596,11 @@ private:
     }
     void Read(qint64* value)
     {
+        if (mode_ == FastSerializer::Mode::COMPACT)
+        {
+            *value = UnZigZag(ReadVarint());
+            return;
+        }
         const int TYPE_SIZE = sizeof(value);
 
         EnsureType(FastSerializer::INT64_TYPE);
@@ -361,9 +618,9 @@ private:
 
         index_ += TYPE_SIZE;
     }
-    void EnsureSize(int size)
+    void EnsureSize(quint32 size)
     {
-        if ((size + index_) > size_)
+        if (size > size_ - index_)
         {
             kv::Abort("FastDeserializer: EnsureSize fail!");
         }
@@ -382,6 +639,9 @@ private:
     const char* const data_;
     const quint32 size_;
     quint32 index_;
+
+    FastSerializer::Mode mode_;
+    std::vector<QString> strings_;
 };
 
 template<class T>
@@ -417,6 +677,12 @@ inline QString Humanize(FastDeserializer* deserializer)
             *deserializer >> value;
             stream << value;
         }
+        else if (type == FastSerializer::INT64_TYPE)
+        {
+            qint64 value;
+            *deserializer >> value;
+            stream << value;
+        }
         else if (type == FastSerializer::STRING_TYPE)
         {
             QString value;
@@ -439,6 +705,12 @@ inline QString Humanize(FastDeserializer* deserializer)
             }
             stream << "\r\n" << value;
         }
+        else if (type == FastSerializer::TYPE_INDEX_TYPE)
+        {
+            quint32 value;
+            deserializer->ReadTypeIndex(&value);
+            stream << "\r\n#" << value;
+        }
         else
         {
             kv::Abort(QString("Unknown type: %1").arg(type));
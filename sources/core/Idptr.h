@@ -3,6 +3,8 @@
 #include <cstdlib>
 
 #include <iostream>
+#include <type_traits>
+#include <vector>
 
 #include <QDebug>
 
@@ -15,25 +17,93 @@
 namespace kv
 {
     class Object;
+
+    // Object id is an index in the objects table with the generation of the index
+    // in the high bits, so an id of a deleted object never matches a new object.
+    // The last generation is never used in ids, indexes with it are retired.
+    const int ID_INDEX_BITS = 22;
+    const quint32 MAX_ID_INDEX = (1u << ID_INDEX_BITS) - 1;
+    const quint32 MAX_ID_GENERATION = (1u << (32 - ID_INDEX_BITS)) - 1;
+
+    inline quint32 IdIndex(quint32 id)
+    {
+        return id & MAX_ID_INDEX;
+    }
+    inline quint32 IdGeneration(quint32 id)
+    {
+        return id >> ID_INDEX_BITS;
+    }
+    inline quint32 MakeId(quint32 index, quint32 generation)
+    {
+        return (generation << ID_INDEX_BITS) | index;
+    }
 }
 
 struct ObjectInfo
 {
     ObjectInfo()
-        : object(nullptr)
+        : object(nullptr),
+          generation(0),
+          hash(0),
+          next_changed(0),
+          changed(false)
     {
         // Nothing
     }
     kv::Object* object;
+    // Generation of the id of the object, it is changed when the object is deleted,
+    // so pointers cached for the old id are not trusted anymore
+    quint32 generation;
+    // The last HashMembers() result, see ObjectFactory::Hash
+    unsigned int hash;
+    // Intrusive list of the changed objects, the head is kept in the entry 0
+    quint32 next_changed;
+    bool changed;
 };
 
 extern KVENGINE_EXPORT std::vector<ObjectInfo>* id_ptr_id_table;
 
+// While it is set IdPtrs may be shared between threads, so the const access
+// does not cache pointers and the non-const access is forbidden
+extern KVENGINE_EXPORT bool id_ptr_read_only;
+
+// Changed when the whole table is cleared, the ids are reused then
+// with the same generations, so pointers cached before are not trusted
+extern KVENGINE_EXPORT quint32 id_ptr_cache_epoch;
+
+inline void MarkObjectChanged(std::vector<ObjectInfo>* table, quint32 id)
+{
+    const quint32 index = kv::IdIndex(id);
+    ObjectInfo& info = (*table)[index];
+    if (info.changed)
+    {
+        return;
+    }
+    info.changed = true;
+    info.next_changed = (*table)[0].next_changed;
+    (*table)[0].next_changed = index;
+}
+
 struct IdPtrBase
 {
 protected:
+    // The generation is stored in the id, so the cached pointer is valid
+    // while the generation of the table entry is the same
+    bool IsCacheValid() const
+    {
+        return casted_ != nullptr
+            && cache_epoch_ == id_ptr_cache_epoch
+            && (*id_ptr_id_table)[kv::IdIndex(id_)].generation == kv::IdGeneration(id_);
+    }
+    void SetCache(kv::Object* object) const
+    {
+        casted_ = object;
+        cache_epoch_ = id_ptr_cache_epoch;
+    }
+
     mutable kv::Object* casted_;
     quint32 id_;
+    mutable quint32 cache_epoch_;
 };
 
 template<class T>
@@ -50,6 +120,7 @@ public:
     {
         id_ = 0;
         casted_ = nullptr;
+        cache_epoch_ = 0;
     }
     IdPtr(quint32 id)
     {
@@ -80,55 +151,51 @@ public:
     {
         id_ = id;
         casted_ = nullptr;
+        cache_epoch_ = 0;
         return *this;
     }
     IdPtr& operator=(const IdPtr& other)
     {
         id_ = other.id_;
         casted_ = other.casted_;
+        cache_epoch_ = other.cache_epoch_;
         return *this;
     }
 
     template<class U>
     IdPtr& operator=(const IdPtr<U>& other)
     {
-#if defined(KV_ID_PTR_CASTING_CACHE)
-        if (other.id_ == 0)
-        {
-            id_ = 0;
-            casted_ = nullptr;
-            return *this;
-        }
-        if (other.casted_ != nullptr)
+        id_ = other.id_;
+        casted_ = nullptr;
+        cache_epoch_ = 0;
+        // The same object is casted to the same pointer
+        if (other.IsCacheValid())
         {
             if (std::is_base_of<T, U>::value)
             {
-                casted_ = other.casted_;
-                id_ = other.id_;
-                return *this;
+                SetCache(other.casted_);
             }
-            T* retval = castTo<T>(other.casted_);
-            if (retval)
+            else
             {
-                casted_ = retval;
-                id_ = other.id_;
-                return *this;
+                SetCache(CastTo<T>(other.casted_));
             }
-            id_ = 0;
-            casted_ = nullptr;
-            return *this;
         }
-#endif // KV_ID_PTR_CASTING_CACHE
-        *this = other.id_;
         return *this;
     }
 
+    // Object can be changed through the non-const access,
+    // so it is marked for the world hash update
     T& operator*()
     {
         kv::Assert(id_, "Unable to dereference IdPtr with 0 id");
-        if (casted_ == nullptr)
+        if (id_ptr_read_only)
+        {
+            kv::Abort(QString("Non-const access to IdPtr in the read only mode, id: %1").arg(id_));
+        }
+        Update();
+        if (casted_ != nullptr)
         {
-            Update();
+            MarkObjectChanged(id_ptr_id_table, id_);
         }
         return *static_cast<T*>(casted_);
     }
@@ -136,11 +203,7 @@ public:
     const T& operator*() const
     {
         kv::Assert(id_, "Unable to dereference IdPtr with 0 id");
-        if (casted_ == nullptr)
-        {
-            Update();
-        }
-        return *static_cast<T*>(casted_);
+        return *static_cast<T*>(Resolve());
     }
 
     T* operator->()
@@ -155,22 +218,11 @@ public:
 
     bool IsValid() const
     {
-        Update();
-        return casted_ != nullptr;
+        return Resolve() != nullptr;
     }
     explicit operator bool() const
     {
-#if defined(KV_ID_PTR_VALID_CACHE)
-        if (casted_)
-        {
-            return true;
-        }
-#endif // KV_ID_PTR_VALID_CACHE
-        if (IsValid())
-        {
-            return true;
-        }
-        return false;
+        return IsValid();
     }
     quint32 Id() const
     {
@@ -179,37 +231,55 @@ public:
 private:
     void Update() const
     {
-        if (id_ == 0)
+        if (IsCacheValid())
         {
-            casted_ = nullptr;
             return;
         }
+        SetCache(Lookup());
+    }
 
-        kv::Object* local = GetFromIdTable(id_);
-        if (local == nullptr)
+    kv::Object* Resolve() const
+    {
+        if (IsCacheValid())
         {
-            casted_ = nullptr;
-            return;
+            return casted_;
         }
-        if (casted_)
+        kv::Object* retval = Lookup();
+        if (!id_ptr_read_only)
         {
-            return;
+            SetCache(retval);
         }
-        T* retval = CastTo<T>(local);
-        if (retval)
+        return retval;
+    }
+
+    kv::Object* Lookup() const
+    {
+        if (id_ == 0)
         {
-            casted_ = retval;
+            return nullptr;
         }
+        kv::Object* local = GetFromIdTable(id_);
+        if (local == nullptr)
+        {
+            return nullptr;
+        }
+        return CastTo<T>(local);
     }
 
     static kv::Object* GetFromIdTable(quint32 id)
     {
-        if (static_cast<int>(id) >= id_ptr_id_table->size())
+        const quint32 index = kv::IdIndex(id);
+        if (index >= id_ptr_id_table->size())
         {
             kv::Abort(QString("Id table lookup fail, id: %1, size: %2")
                 .arg(id).arg(id_ptr_id_table->size()));
         }
-        return (*id_ptr_id_table)[id].object;
+        const ObjectInfo& info = (*id_ptr_id_table)[index];
+        if (info.generation != kv::IdGeneration(id))
+        {
+            return nullptr;
+        }
+        return info.object;
     }
 };
 
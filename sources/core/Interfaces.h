@@ -31,9 +31,11 @@ public:
 
     virtual void Represent(kv::GrowingFrame* frame) const = 0;
 
-    using Flags = char;
+    using Flags = quint16;
     virtual void SetFlags(quint32 x, quint32 y, quint32 z, Flags flags) = 0;
     virtual void LoadGrid(MapInterface* map) = 0;
+
+    virtual quint32 Hash() = 0;
 };
 
 using VisiblePoints = QVector<kv::Position>;
@@ -47,18 +49,28 @@ public:
     virtual int GetHeight() const = 0;
     virtual int GetDepth() const = 0;
 
-    virtual void Represent(kv::GrowingFrame* frame, const VisiblePoints& points, IdPtr<kv::Mob> mob) const = 0;
+    virtual void Represent(kv::GrowingFrame* frame, const VisiblePoints& points, const IdPtr<kv::Mob>& mob) const = 0;
 
     virtual void Resize(int new_map_x, int new_map_y, int new_map_z) = 0;
 
     using SqType = IdPtr<kv::CubeTile>;
     virtual SqType& At(int x, int y, int z) = 0;
     virtual const SqType& At(int x, int y, int z) const = 0;
+    // The coordinates which would leave the map stay the same
+    virtual const SqType& GetNeighbour(const kv::Position& position, Dir dir) const = 0;
 
     virtual void FillTilesAtmosHolders() = 0;
     virtual void CalculateLos(VisiblePoints* retval, int posx, int posy, int posz = 0) const = 0;
+    // LOS results are reused while the viewer and the opacity around it stay the same,
+    // results which were not requested since the previous call are dropped
+    virtual void RemoveUnusedLos() = 0;
+    virtual void SetLosEngine(kv::LosEngine engine) = 0;
 
     virtual bool Istransparent(int posx, int posy, int posz = 0) const = 0;
+
+    // Opacity of the tiles is cached for LOS, so tiles should report its changes
+    virtual void UpdateOpacity(int posx, int posy, int posz) = 0;
+    virtual void LoadOpacity() = 0;
 };
 
 class ObjectFactoryInterface
@@ -69,14 +81,21 @@ public:
     virtual std::vector<ObjectInfo>& GetIdTable() = 0;
     virtual const std::vector<ObjectInfo>& GetIdTable() const = 0;
 
-    virtual quint32 Hash() const = 0;
+    virtual quint32 Hash() = 0;
+    // Parts of the value returned by the last Hash() call
+    virtual quint32 HashIdsRange(quint32 begin, quint32 end) const = 0;
+    virtual QMap<QString, quint32> HashTypes() const = 0;
+    // Rehashes all the objects, so the result of Hash() can be checked
+    virtual quint32 HashFull() const = 0;
+    // The next Hash() call rehashes all the objects
+    virtual void MarkAllObjectsChanged() = 0;
 
     virtual void BeginWorldCreation() = 0;
     virtual void FinishWorldCreation() = 0;
     virtual void MarkWorldAsCreated() = 0;
 
     virtual quint32 CreateImpl(const QString& type, quint32 owner = 0) = 0;
-    virtual kv::Object* CreateVoid(const QString& hash, quint32 id_new) = 0;
+    virtual kv::Object* CreateVoid(int type_index, quint32 id_new) = 0;
 
     virtual quint32 CreateAssetImpl(const kv::Asset& asset, quint32 owner = 0) = 0;
 
@@ -87,6 +106,10 @@ public:
 
     virtual int GetId() const = 0;
     virtual void SetId(int id) = 0;
+
+    // Ids of the deleted objects which will be reused
+    virtual const QVector<quint32>& GetFreeIds() const = 0;
+    virtual void SetFreeIds(const QVector<quint32>& ids) = 0;
 };
 
 class ObjectProcessorInterface
@@ -94,7 +117,9 @@ class ObjectProcessorInterface
 public:
     virtual ~ObjectProcessorInterface() { }
 
+    // Schedules the object according to its frequency
     virtual void Add(quint32 object) = 0;
+    virtual void Remove(quint32 object) = 0;
     virtual void RunProcess() = 0;
 };
 
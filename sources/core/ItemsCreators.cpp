@@ -1,5 +1,8 @@
 #include "AutogenMetadata.h"
 
+#include <algorithm>
+#include <numeric>
+
 bool AreCreatorsInited()
 {
     static bool is = false;
@@ -17,20 +20,55 @@ std::unordered_map<QString, ItemCreator>* GetItemsCreators()
         = new std::unordered_map<QString, ItemCreator>;
     if (!AreCreatorsInited())
     {
-        InitCreators();
         InitRealTypes();
+        InitCreators();
     }
     return result;
 }
 
-std::unordered_map<QString, VoidItemCreator>* GetVoidItemsCreators()
+std::vector<VoidItemCreatorInfo>* GetVoidItemsCreators()
 {
-    static std::unordered_map<QString, VoidItemCreator>* result
-        = new std::unordered_map<QString, VoidItemCreator>;
+    static std::vector<VoidItemCreatorInfo>* result
+        = new std::vector<VoidItemCreatorInfo>;
     if (!AreCreatorsInited())
     {
+        InitRealTypes();
         InitCreators();
+    }
+    return result;
+}
+
+std::vector<BatchProcessor>* GetBatchProcessors()
+{
+    static std::vector<BatchProcessor>* result
+        = new std::vector<BatchProcessor>;
+    if (!AreCreatorsInited())
+    {
         InitRealTypes();
+        InitCreators();
     }
     return result;
 }
+
+const std::vector<int>& GetTypesNameOrder()
+{
+    static const std::vector<int> result = []()
+    {
+        const std::vector<VoidItemCreatorInfo>& creators = *GetVoidItemsCreators();
+
+        std::vector<int> sorted(creators.size());
+        std::iota(sorted.begin(), sorted.end(), 0);
+        std::sort(sorted.begin(), sorted.end(), [&creators](int left, int right)
+        {
+            return creators[left].type < creators[right].type;
+        });
+
+        std::vector<int> order(creators.size());
+        for (int position = 0; position < static_cast<int>(sorted.size()); ++position)
+        {
+            order[sorted[position]] = position;
+        }
+        return order;
+    }();
+    return result;
+}
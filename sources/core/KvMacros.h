@@ -32,6 +32,9 @@ namespace internal
     }                                                                      \
     ThisClass(kv::internal::NoInitialization)                              \
         : BaseClass(kv::internal::no_initialization) { }                   \
+    void _Z_KV_SaveOwn(FastSerializer& file);                              \
+    void _Z_KV_LoadOwn(FastDeserializer& file);                            \
+    unsigned int _Z_KV_HashOwn();                                          \
     virtual void Save(FastSerializer& file) override;                      \
     virtual void Load(FastDeserializer& file) override;                    \
     virtual unsigned int HashMembers() override
@@ -64,4 +67,8 @@ namespace internal
 #define KV_ON_LOAD_CALL(function) \
     struct _Z_KV_SuppressAnnoyingExtraSemicolonWarning##function {}
 
+// 'function' is static and processes all due objects of exactly this type at once
+#define KV_PROCESS_BATCH(function) \
+    struct _Z_KV_SuppressAnnoyingExtraSemicolonWarning##function {}
+
 #define END_DECLARE(ThisClass)
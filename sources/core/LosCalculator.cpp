@@ -38,24 +38,18 @@ bool LosCalculator::CheckCorner(Position p) const
 {
     int x = CornerToPos(p.x);
     int y = CornerToPos(p.y);
-    int z = CornerToPos(p.z);
-    return CheckBorders(x, y, z);
+    return CheckBorders(x, y);
 }
 
-bool LosCalculator::CheckBorders(const int x, const int y, const int z) const
+bool LosCalculator::CheckBorders(const int x, const int y) const
 {
     if (   x < 0
-        || x >= map_->GetWidth())
+        || x >= width_)
     {
         return false;
     }
     if (   y < 0
-        || y >= map_->GetHeight())
-    {
-        return false;
-    }
-    if (   z < 0
-        || z >= map_->GetDepth())
+        || y >= height_)
     {
         return false;
     }
@@ -72,7 +66,7 @@ Position LosCalculator::CornerPointToPoint(Position p)
 bool LosCalculator::Istransparent(Position p) const
 {
     Position tilePoint = CornerPointToPoint(p);
-    return map_->Istransparent(tilePoint.x, tilePoint.y, tilePoint.z);
+    return !opacity_.testBit(tilePoint.x + tilePoint.y * width_);
 }
 
 bool LosCalculator::BresenX(Position source, Position target) const
@@ -226,7 +220,7 @@ void LosCalculator::MarkTilesOfCornerAsVisible(
         for (int dy = -1; dy <= 0; dy++)
         {
             Position p(at.x + dx, at.y + dy, at.z);
-            if (!CheckBorders(p.x, p.y, p.z))
+            if (!CheckBorders(p.x, p.y))
             {
                 continue;
             }
@@ -251,9 +245,12 @@ void LosCalculator::MarkTilesOfCornerAsVisible(
     }
 }
 
-LosCalculator::LosCalculator()
+LosCalculator::LosCalculator(int width, int height, const QBitArray& opacity)
+    : width_(width),
+      height_(height),
+      opacity_(opacity)
 {
-    map_ = nullptr;
+    // Nothing
 }
 
 // LOSfinder::calculateVisisble calculates visibility list of map from given map point
@@ -265,10 +262,8 @@ LosCalculator::LosCalculator()
 // if ray passes through edge it checks both adjasent tiles. They both must be transparent, otherwise ray blocks
 // if tile has at least one visible corner then this tile is visible
 // otherwise tile is invisible
-void LosCalculator::Calculate(const MapInterface* map, VisiblePoints* retlist, int posx, int posy, int posz) const
+void LosCalculator::Calculate(VisiblePoints* retlist, int posx, int posy, int posz) const
 {
-    map_ = map;
-
     const int VISIBLE_TILES_SIZE = 4 * (SIZE_H_SQ + 2) * (SIZE_W_SQ + 2);
 
     std::vector<char> visible_tiles;
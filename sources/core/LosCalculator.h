@@ -2,13 +2,15 @@
 
 #include "Interfaces.h"
 
+#include <QBitArray>
 #include <QVector>
 
 class LosCalculator
 {
 public:
-    LosCalculator();
-    void Calculate(const MapInterface* map, VisiblePoints* retval, int posx, int posy, int posz = 0) const;
+    // Opacity is the bitmap of the viewer z level, see Map::GetOpacity
+    LosCalculator(int width, int height, const QBitArray& opacity);
+    void Calculate(VisiblePoints* retval, int posx, int posy, int posz = 0) const;
 private:
     static int PosToCorner(int pos);
     static int CornerToPos(int corner);
@@ -16,7 +18,7 @@ private:
     static kv::Position CornerPointToPoint(kv::Position p);
 
     bool CheckCorner(kv::Position p) const;
-    bool CheckBorders(int x, int y, int z) const;
+    bool CheckBorders(int x, int y) const;
     bool Istransparent(kv::Position p) const;
     bool BresenX(kv::Position source, kv::Position target) const;
     bool BresenY(kv::Position source, kv::Position target) const;
@@ -28,5 +30,7 @@ private:
         std::vector<char>* visibility) const;
 
     // TODO: Cache other helpful stuff, like visibility array
-    mutable const MapInterface* map_;
+    const int width_;
+    const int height_;
+    const QBitArray& opacity_;
 };
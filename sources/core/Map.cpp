@@ -6,17 +6,18 @@ void Map::FillTilesAtmosHolders()
 {
     for (int z = 0; z < GetDepth(); ++z)
     {
-        for (int x = 0; x < GetWidth(); ++x)
+        for (int y = 0; y < GetHeight(); ++y)
         {
-            for (int y = 0; y < GetHeight(); ++y)
+            for (int x = 0; x < GetWidth(); ++x)
             {
-                auto turf = squares_[x][y][z]->GetTurf();
+                SqType& tile = squares_.At(x, y, z);
+                auto turf = tile->GetTurf();
                 if (   turf.IsValid()
                     && turf->GetAtmosState() != atmos::SPACE
                     && turf->GetAtmosState() != atmos::NON_SIMULATED)
                 {
                     // It is not passable then still fill with air cause of doors
-                    auto holder = squares_[x][y][z]->GetAtmosHolder();
+                    auto holder = tile->GetAtmosHolder();
                     atmos::AddDefaultValues(holder);
                 }
             }
@@ -24,7 +25,7 @@ void Map::FillTilesAtmosHolders()
     }
 }
 
-void Map::Represent(GrowingFrame* frame, const VisiblePoints& points, IdPtr<kv::Mob> mob) const
+void Map::Represent(GrowingFrame* frame, const VisiblePoints& points, const IdPtr<kv::Mob>& mob) const
 {
     for (const Position& point : points)
     {
@@ -54,15 +55,14 @@ void Map::Resize(int new_x, int new_y, int new_z)
         kv::Abort(QString("Incorrect map new size (%1, %2, %3)").arg(new_x).arg(new_y).arg(new_z));
     }
 
-    squares_.resize(new_x);
-    for (int x = 0; x < new_x; ++x)
+    squares_.Resize(new_x, new_y, new_z);
+
+    opacity_.fill(QBitArray(), new_z);
+    for (QBitArray& level : opacity_)
     {
-        squares_[x].resize(new_y);
-        for (int y = 0; y < new_y; ++y)
-        {
-            squares_[x][y].resize(new_z);
-        }
+        level.resize(new_x * new_y);
     }
+    los_cache_.Reset(new_x, new_y, new_z);
 }
 
 Map::Map()
@@ -77,43 +77,109 @@ Map::~Map()
 
 Map::SqType& Map::At(int x, int y, int z)
 {
-    return squares_[x][y][z];
+    return squares_.At(x, y, z);
 }
 
 const Map::SqType& Map::At(int x, int y, int z) const
 {
-    return squares_[x][y][z];
+    return squares_.At(x, y, z);
 }
 
 int Map::GetWidth() const
 {
-    return squares_.size();
+    return squares_.GetWidth();
 }
 
 int Map::GetHeight() const
 {
-    if (!GetWidth())
-    {
-        return 0;
-    }
-    return squares_[0].size();
+    return squares_.GetHeight();
 }
 
 int Map::GetDepth() const
 {
-    if (!GetHeight())
+    return squares_.GetDepth();
+}
+
+const Map::SqType& Map::GetNeighbour(const Position& position, Dir dir) const
+{
+    return squares_.GetNeighbour(position, dir);
+}
+
+bool Map::Istransparent(int posx, int posy, int posz) const
+{
+    return !opacity_[posz].testBit(posx + posy * GetWidth());
+}
+
+void Map::UpdateOpacity(int posx, int posy, int posz)
+{
+    if (   posx < 0 || posx >= GetWidth()
+        || posy < 0 || posy >= GetHeight()
+        || posz < 0 || posz >= opacity_.size())
+    {
+        return;
+    }
+    const SqType& tile = At(posx, posy, posz);
+    const bool opaque = tile.IsValid() && !tile->Istransparent();
+    const int index = posx + posy * GetWidth();
+    if (opacity_[posz].testBit(index) != opaque)
     {
-        return 0;
+        opacity_[posz].setBit(index, opaque);
+        los_cache_.Invalidate({posx, posy, posz});
     }
-    return squares_[0][0].size();
 }
 
-bool Map::Istransparent(int posx, int posy, int posz) const
+void Map::LoadOpacity()
 {
-    return At(posx, posy, posz)->Istransparent();
+    opacity_.fill(QBitArray(), GetDepth());
+    los_cache_.Reset(GetWidth(), GetHeight(), GetDepth());
+    for (int z = 0; z < GetDepth(); ++z)
+    {
+        opacity_[z].resize(GetWidth() * GetHeight());
+        for (int y = 0; y < GetHeight(); ++y)
+        {
+            for (int x = 0; x < GetWidth(); ++x)
+            {
+                UpdateOpacity(x, y, z);
+            }
+        }
+    }
 }
 
 void Map::CalculateLos(VisiblePoints* retval, int posx, int posy, int posz) const
 {
-    los_calculator_.Calculate(this, retval, posx, posy, posz);
+    // The cached result replaces the content, so the calculated one does too
+    retval->clear();
+    if (posz < 0 || posz >= opacity_.size())
+    {
+        return;
+    }
+    const Position position(posx, posy, posz);
+    if (los_cache_.Find(position, retval))
+    {
+        return;
+    }
+    if (los_engine_ == LosEngine::RAY_TRACING)
+    {
+        LosCalculator(GetWidth(), GetHeight(), GetOpacity(posz)).Calculate(retval, posx, posy, posz);
+    }
+    else
+    {
+        ShadowCaster(GetWidth(), GetHeight(), GetOpacity(posz)).Calculate(retval, posx, posy, posz);
+    }
+    los_cache_.Insert(position, *retval);
+}
+
+void Map::RemoveUnusedLos()
+{
+    los_cache_.RemoveUnused();
+}
+
+void Map::SetLosEngine(LosEngine engine)
+{
+    if (los_engine_ == engine)
+    {
+        return;
+    }
+    los_engine_ = engine;
+    los_cache_.Reset(GetWidth(), GetHeight(), GetDepth());
 }
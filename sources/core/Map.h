@@ -8,9 +8,14 @@
 #include "Interfaces.h"
 
 #include "LosCalculator.h"
+#include "ShadowCaster.h"
+#include "TileGrid.h"
+#include "VisibilityCache.h"
 
 #include "SaveableOperators.h"
 
+#include <QBitArray>
+
 namespace kv
 {
 
@@ -30,17 +35,30 @@ public:
     virtual int GetHeight() const override;
     virtual int GetDepth() const override;
 
+    virtual const SqType& GetNeighbour(const Position& position, Dir dir) const override;
+
     virtual void Resize(int new_x, int new_y, int new_z) override;
     virtual void FillTilesAtmosHolders() override;
 
-    virtual void Represent(GrowingFrame* frame, const VisiblePoints& points, IdPtr<Mob> mob) const override;
+    virtual void Represent(GrowingFrame* frame, const VisiblePoints& points, const IdPtr<Mob>& mob) const override;
 
     virtual bool Istransparent(int posx, int posy, int posz = 0) const override;
+    virtual void UpdateOpacity(int posx, int posy, int posz) override;
+    virtual void LoadOpacity() override;
+    // Bit (x + y * width) is set for the opaque tiles
+    const QBitArray& GetOpacity(int posz) const { return opacity_[posz]; }
 
     virtual void CalculateLos(VisiblePoints* retval, int posx, int posy, int posz = 0) const override;
+    virtual void RemoveUnusedLos() override;
+    virtual void SetLosEngine(LosEngine engine) override;
 private:
-    LosCalculator los_calculator_;
-    QVector<QVector<QVector<SqType>>> KV_SAVEABLE(squares_);
+    TileGrid KV_SAVEABLE(squares_);
+
+    // It is not saved, tiles are the source of truth
+    QVector<QBitArray> opacity_;
+    mutable VisibilityCache los_cache_{ShadowCaster::VIEW_RADIUS};
+    // Not saved, each client picks its own engine
+    LosEngine los_engine_ = LosEngine::RAY_TRACING;
 };
 END_DECLARE(Map)
 
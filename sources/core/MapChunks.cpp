@@ -0,0 +1,108 @@
+#include "core_headers/MapChunks.h"
+
+#include <QtEndian>
+
+namespace
+{
+
+const int HEADER_SIZE = 4;
+
+void AppendSize(QByteArray* data, quint32 size)
+{
+    uchar temp[HEADER_SIZE];
+    qToBigEndian(size, temp);
+    data->append(reinterpret_cast<char*>(temp), HEADER_SIZE);
+}
+
+}
+
+QByteArray MapChunks::Compress(const QByteArray& data, int chunk_size)
+{
+    QByteArray retval;
+    for (int position = 0; position < data.size(); position += chunk_size)
+    {
+        const QByteArray chunk = qCompress(data.mid(position, chunk_size));
+        AppendSize(&retval, static_cast<quint32>(chunk.size()));
+        retval.append(chunk);
+    }
+    AppendSize(&retval, 0);
+    return retval;
+}
+
+QByteArray MapChunks::Uncompress(const QByteArray& data)
+{
+    Uncompressor uncompressor;
+    if (!uncompressor.Append(data) || !uncompressor.IsFinished())
+    {
+        return QByteArray();
+    }
+    return uncompressor.TakeResult();
+}
+
+MapChunks::Uncompressor::Uncompressor()
+    : is_finished_(false),
+      is_failed_(false)
+{
+    // Nothing
+}
+
+bool MapChunks::Uncompressor::Append(const QByteArray& data)
+{
+    if (is_failed_)
+    {
+        return false;
+    }
+    pending_.append(data);
+
+    int position = 0;
+    while (pending_.size() - position >= HEADER_SIZE)
+    {
+        const quint32 size = qFromBigEndian<quint32>(
+            reinterpret_cast<const uchar*>(pending_.constData() + position));
+        if (is_finished_)
+        {
+            // Nothing is expected after the end
+            is_failed_ = true;
+            return false;
+        }
+        if (size == 0)
+        {
+            is_finished_ = true;
+            position += HEADER_SIZE;
+            continue;
+        }
+        if (static_cast<quint32>(pending_.size() - position - HEADER_SIZE) < size)
+        {
+            break;
+        }
+        const QByteArray chunk
+            = qUncompress(pending_.mid(position + HEADER_SIZE, static_cast<int>(size)));
+        if (chunk.isEmpty())
+        {
+            is_failed_ = true;
+            return false;
+        }
+        result_.append(chunk);
+        position += HEADER_SIZE + static_cast<int>(size);
+    }
+    pending_.remove(0, position);
+
+    if (is_finished_ && !pending_.isEmpty())
+    {
+        is_failed_ = true;
+        return false;
+    }
+    return true;
+}
+
+bool MapChunks::Uncompressor::IsFinished() const
+{
+    return is_finished_ && !is_failed_;
+}
+
+QByteArray MapChunks::Uncompressor::TakeResult()
+{
+    QByteArray retval;
+    retval.swap(result_);
+    return retval;
+}
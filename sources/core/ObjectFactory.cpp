@@ -1,5 +1,7 @@
 #include "ObjectFactory.h"
 
+#include <algorithm>
+
 #include "KvAbort.h"
 
 #include "objects/Object.h"
@@ -8,13 +10,20 @@
 #include "Map.h"
 #include "SynchronizedRandom.h"
 #include "AutogenMetadata.h"
+#include "ObjectsPool.h"
 #include "WorldLoaderSaver.h"
 
 #include "objects/GlobalObjectsHolder.h"
 
+namespace
+{
+    const quint32 HASH_BUCKET_SIZE = 64;
+}
+
 ObjectFactory::ObjectFactory(GameInterface* game)
 {
     objects_table_.resize(100);
+    hash_ = 0;
     id_ = 1;
     is_world_generating_ = true;
     game_ = game;
@@ -31,6 +40,7 @@ ObjectFactory::~ObjectFactory()
             delete info.object;
         }
     }
+    kv::internal::ReleaseObjectsPools();
 }
 
 std::vector<ObjectInfo>& ObjectFactory::GetIdTable()
@@ -53,14 +63,14 @@ kv::Object* ObjectFactory::NewVoidObject(const QString& type)
     return creator->second();
 }
 
-kv::Object* ObjectFactory::NewVoidObjectSaved(const QString& type)
+kv::Object* ObjectFactory::NewVoidObjectSaved(int type_index)
 {
-    auto creator = GetVoidItemsCreators()->find(type);
-    if (creator == GetVoidItemsCreators()->end())
+    const auto& creators = *GetVoidItemsCreators();
+    if (type_index < 0 || type_index >= static_cast<int>(creators.size()))
     {
-        kv::Abort(QString("Unable to find void creator for type: %1").arg(type));
+        kv::Abort(QString("Unable to find void creator for type index: %1").arg(type_index));
     }
-    return creator->second();
+    return creators[type_index].creator();
 }
 
 void ObjectFactory::Clear()
@@ -71,16 +81,32 @@ void ObjectFactory::Clear()
         if (objects_table_[i].object != nullptr)
         {
             delete objects_table_[i].object;
+            objects_table_[i].object = nullptr;
         }
     }
+    ProcessDeletion();
+    kv::internal::ReleaseObjectsPools();
     if (table_size != objects_table_.size())
     {
         qDebug() << "WARNING: table_size != idTable_.size()!";
     }
 
-    ids_to_delete_.clear();
+    for (auto& info : objects_table_)
+    {
+        info.generation = 0;
+        info.hash = 0;
+        info.next_changed = 0;
+        info.changed = false;
+    }
+    hash_ = 0;
+    buckets_hashes_.clear();
+    types_hashes_.clear();
+    types_names_.clear();
 
     id_ = 1;
+    free_ids_.clear();
+    // The ids start again from the same generations
+    ++id_ptr_cache_epoch;
 }
 
 void ObjectFactory::BeginWorldCreation()
@@ -96,6 +122,7 @@ void ObjectFactory::FinishWorldCreation()
     {
         if (objects_table_[i].object != nullptr)
         {
+            MarkObjectChanged(&objects_table_, i);
             objects_table_[i].object->AfterWorldCreation();
         }
     }
@@ -111,17 +138,13 @@ quint32 ObjectFactory::CreateImpl(const QString &type, quint32 owner_id)
     kv::Object* item = NewVoidObject(type);
     kv::internal::GetObjectGame(item) = game_;
 
-    if (id_ >= objects_table_.size())
-    {
-        objects_table_.resize(id_ * 2);
-    }
-    objects_table_[id_].object = item;
+    const quint32 retval = AllocateId();
+    objects_table_[kv::IdIndex(retval)].object = item;
+    MarkObjectChanged(&objects_table_, retval);
 
-    kv::internal::GetObjectId(item) = id_;
+    kv::internal::GetObjectId(item) = retval;
     item->SetFreq(item->GetFreq());
 
-    quint32 retval = id_;
-    ++id_;
     IdPtr<kv::MapObject> owner = owner_id;
     if (owner.IsValid())
     {
@@ -147,20 +170,20 @@ quint32 ObjectFactory::CreateImpl(const QString &type, quint32 owner_id)
     return retval;
 }
 
-kv::Object* ObjectFactory::CreateVoid(const QString &hash, quint32 id_new)
+kv::Object* ObjectFactory::CreateVoid(int type_index, quint32 id_new)
 {
-    kv::Object* item = NewVoidObjectSaved(hash);
+    kv::Object* item = NewVoidObjectSaved(type_index);
     kv::internal::GetObjectGame(item) = game_;
-    if (id_new >= objects_table_.size())
-    {
-        objects_table_.resize(id_new * 2);
-    }
 
-    if (id_new >= id_)
+    const quint32 index = kv::IdIndex(id_new);
+    ReserveIndex(index);
+    if (index >= id_)
     {
-        id_ = id_new + 1;
+        id_ = index + 1;
     }
-    objects_table_[id_new].object = item;
+    objects_table_[index].object = item;
+    objects_table_[index].generation = kv::IdGeneration(id_new);
+    MarkObjectChanged(&objects_table_, id_new);
     kv::internal::GetObjectId(item) = id_new;
     item->SetFreq(item->GetFreq());
     return item;
@@ -186,31 +209,181 @@ quint32 ObjectFactory::CreateAssetImpl(const kv::Asset& asset, quint32 owner_id)
 
 void ObjectFactory::DeleteLater(quint32 id)
 {
-    ids_to_delete_.push_back(objects_table_[id].object);
-    objects_table_[id].object = nullptr;
+    const quint32 index = kv::IdIndex(id);
+    ObjectInfo& info = objects_table_[index];
+    // Already deleted
+    if (!info.object || info.generation != kv::IdGeneration(id))
+    {
+        return;
+    }
+    UpdateObjectHash(index, 0);
+    ids_to_delete_.push_back(info.object);
+    info.object = nullptr;
+    // IdPtrs with the old id do not trust their cached pointers anymore
+    ++info.generation;
 }
 
 void ObjectFactory::ProcessDeletion()
 {
-    for (auto it = ids_to_delete_.begin(); it != ids_to_delete_.end(); ++it)
+    for (kv::Object* object : ids_to_delete_)
     {
-        delete *it;
+        const quint32 index = kv::IdIndex(object->GetId());
+        delete object;
+        FreeIndex(index);
     }
     ids_to_delete_.clear();
 }
 
-quint32 ObjectFactory::Hash() const
+quint32 ObjectFactory::AllocateId()
+{
+    if (!free_ids_.isEmpty())
+    {
+        const quint32 id = free_ids_.takeLast();
+        objects_table_[kv::IdIndex(id)].generation = kv::IdGeneration(id);
+        return id;
+    }
+
+    if (id_ > kv::MAX_ID_INDEX)
+    {
+        kv::Abort(QString("Objects table is full, id: %1").arg(id_));
+    }
+    const quint32 index = id_;
+    ++id_;
+    ReserveIndex(index);
+    objects_table_[index].generation = 0;
+    return kv::MakeId(index, 0);
+}
+
+void ObjectFactory::FreeIndex(quint32 index)
+{
+    // The generation is already changed by DeleteLater
+    const quint32 generation = objects_table_[index].generation;
+    // The index is not reused anymore, otherwise the old ids would become valid again
+    if (generation == kv::MAX_ID_GENERATION)
+    {
+        return;
+    }
+    free_ids_.append(kv::MakeId(index, generation));
+}
+
+void ObjectFactory::ReserveIndex(quint32 index)
+{
+    if (index >= objects_table_.size())
+    {
+        objects_table_.resize(index * 2);
+    }
+}
+
+quint32 ObjectFactory::Hash()
+{
+    // Objects marked during hashing stay in the new list
+    quint32 index = objects_table_[0].next_changed;
+    objects_table_[0].next_changed = 0;
+    while (index != 0)
+    {
+        kv::Object* object = objects_table_[index].object;
+        // TODO (?): i to hash
+        UpdateObjectHash(
+            index, object ? OBJECT_SERIALIZERS[object->GetTypeIndex()].hash(object) : 0);
+
+        ObjectInfo& info = objects_table_[index];
+        index = info.next_changed;
+        info.next_changed = 0;
+        info.changed = false;
+    }
+    return hash_;
+}
+
+quint32 ObjectFactory::HashIdsRange(quint32 begin, quint32 end) const
+{
+    end = std::min(end, static_cast<quint32>(objects_table_.size()));
+    quint32 retval = 0;
+    quint32 id = begin;
+    while (id < end)
+    {
+        const quint32 bucket = id / HASH_BUCKET_SIZE;
+        if (   ((id % HASH_BUCKET_SIZE) == 0)
+            && ((id + HASH_BUCKET_SIZE) <= end)
+            && (bucket < buckets_hashes_.size()))
+        {
+            retval += buckets_hashes_[bucket];
+            id += HASH_BUCKET_SIZE;
+            continue;
+        }
+        retval += objects_table_[id].hash;
+        ++id;
+    }
+    return retval;
+}
+
+QMap<QString, quint32> ObjectFactory::HashTypes() const
+{
+    QMap<QString, quint32> retval;
+    for (quint32 type_index = 0; type_index < types_hashes_.size(); ++type_index)
+    {
+        if (!types_names_[type_index].isEmpty())
+        {
+            retval[types_names_[type_index]] = types_hashes_[type_index];
+        }
+    }
+    return retval;
+}
+
+quint32 ObjectFactory::HashFull() const
+{
+    quint32 retval = 0;
+    const quint32 table_size = static_cast<quint32>(objects_table_.size());
+    for (quint32 i = 1; i < table_size; ++i)
+    {
+        kv::Object* object = objects_table_[i].object;
+        if (object != nullptr)
+        {
+            retval += OBJECT_SERIALIZERS[object->GetTypeIndex()].hash(object);
+        }
+    }
+    return retval;
+}
+
+void ObjectFactory::MarkAllObjectsChanged()
 {
-    unsigned int h = 0;
     const quint32 table_size = static_cast<quint32>(objects_table_.size());
     for (quint32 i = 1; i < table_size; ++i)
     {
         if (objects_table_[i].object != nullptr)
         {
-            // TODO (?): i to hash
-            h += objects_table_[i].object->HashMembers();
+            MarkObjectChanged(&objects_table_, i);
         }
     }
+}
+
+void ObjectFactory::UpdateObjectHash(quint32 index, unsigned int object_hash)
+{
+    ObjectInfo& info = objects_table_[index];
+    const quint32 difference = object_hash - info.hash;
+    info.hash = object_hash;
+    if (difference == 0)
+    {
+        return;
+    }
+    hash_ += difference;
+
+    const quint32 bucket = index / HASH_BUCKET_SIZE;
+    if (bucket >= buckets_hashes_.size())
+    {
+        buckets_hashes_.resize(bucket + 1, 0);
+    }
+    buckets_hashes_[bucket] += difference;
 
-    return h;
+    // Hash can be changed only for an existing object
+    const quint32 type_index = static_cast<quint32>(info.object->GetTypeIndex());
+    if (type_index >= types_hashes_.size())
+    {
+        types_hashes_.resize(type_index + 1, 0);
+        types_names_.resize(type_index + 1);
+    }
+    types_hashes_[type_index] += difference;
+    if (types_names_[type_index].isEmpty())
+    {
+        types_names_[type_index] = info.object->GetType();
+    }
 }
@@ -14,14 +14,19 @@ public:
     virtual std::vector<ObjectInfo>& GetIdTable() override;
     virtual const std::vector<ObjectInfo>& GetIdTable() const override;
 
-    virtual quint32 Hash() const override;
+    // Only the objects changed since the last call are rehashed
+    virtual quint32 Hash() override;
+    virtual quint32 HashIdsRange(quint32 begin, quint32 end) const override;
+    virtual QMap<QString, quint32> HashTypes() const override;
+    virtual quint32 HashFull() const override;
+    virtual void MarkAllObjectsChanged() override;
 
     virtual void BeginWorldCreation() override;
     virtual void FinishWorldCreation() override;
     virtual void MarkWorldAsCreated() override;
 
     virtual quint32 CreateImpl(const QString& type, quint32 owner = 0) override;
-    virtual kv::Object* CreateVoid(const QString& hash, quint32 id_new) override;
+    virtual kv::Object* CreateVoid(int type_index, quint32 id_new) override;
 
     virtual quint32 CreateAssetImpl(const kv::Asset& asset, quint32 owner_id = 0) override;
 
@@ -32,9 +37,18 @@ public:
 
     virtual int GetId() const override { return id_; }
     virtual void SetId(int id) override { id_ = id; }
+
+    virtual const QVector<quint32>& GetFreeIds() const override { return free_ids_; }
+    virtual void SetFreeIds(const QVector<quint32>& ids) override { free_ids_ = ids; }
 private:
     static kv::Object* NewVoidObject(const QString& type);
-    static kv::Object* NewVoidObjectSaved(const QString& type);
+    static kv::Object* NewVoidObjectSaved(int type_index);
+
+    quint32 AllocateId();
+    void FreeIndex(quint32 index);
+    void ReserveIndex(quint32 index);
+
+    void UpdateObjectHash(quint32 index, unsigned int object_hash);
 
     GameInterface* game_;
 
@@ -46,5 +60,15 @@ private:
 
     std::vector<ObjectInfo> objects_table_;
 
+    // Sum of the cached hashes of the objects
+    quint32 hash_;
+    // The same sums for the ids buckets and for the types
+    std::vector<quint32> buckets_hashes_;
+    std::vector<quint32> types_hashes_;
+    std::vector<QString> types_names_;
+
+    // The first never used index
     quint32 id_;
+    // Taken from the end, so the latest freed ids are reused first
+    QVector<quint32> free_ids_;
 };
@@ -0,0 +1,127 @@
+#include "ObjectsPool.h"
+
+#include <memory>
+#include <new>
+#include <vector>
+
+namespace
+{
+
+const std::size_t CHUNK_ALIGNMENT = alignof(std::max_align_t);
+const std::size_t CHUNKS_PER_SLAB = 256;
+
+class SlabPool
+{
+public:
+    explicit SlabPool(std::size_t chunk_size)
+        : chunk_size_(chunk_size),
+          free_(nullptr),
+          alive_(0)
+    {
+        // Nothing
+    }
+    void* Allocate()
+    {
+        if (!free_)
+        {
+            AddSlab();
+        }
+        FreeChunk* chunk = free_;
+        free_ = chunk->next;
+        ++alive_;
+        return chunk;
+    }
+    void Deallocate(void* pointer)
+    {
+        FreeChunk* chunk = static_cast<FreeChunk*>(pointer);
+        chunk->next = free_;
+        free_ = chunk;
+        --alive_;
+    }
+    void Release()
+    {
+        if (alive_ != 0)
+        {
+            return;
+        }
+        for (char* slab : slabs_)
+        {
+            ::operator delete(slab);
+        }
+        slabs_.clear();
+        free_ = nullptr;
+    }
+private:
+    struct FreeChunk
+    {
+        FreeChunk* next;
+    };
+
+    void AddSlab()
+    {
+        char* slab = static_cast<char*>(::operator new(chunk_size_ * CHUNKS_PER_SLAB));
+        slabs_.push_back(slab);
+        // Chunks are handed out in the address order
+        for (std::size_t i = CHUNKS_PER_SLAB; i > 0; --i)
+        {
+            FreeChunk* chunk = reinterpret_cast<FreeChunk*>(slab + (i - 1) * chunk_size_);
+            chunk->next = free_;
+            free_ = chunk;
+        }
+    }
+
+    std::size_t chunk_size_;
+    std::vector<char*> slabs_;
+    FreeChunk* free_;
+    std::size_t alive_;
+};
+
+// Objects can be deleted after the static destructors, so the pools are never destroyed
+std::vector<std::unique_ptr<SlabPool>>& GetPools()
+{
+    static std::vector<std::unique_ptr<SlabPool>>* pools
+        = new std::vector<std::unique_ptr<SlabPool>>;
+    return *pools;
+}
+
+SlabPool& GetPool(std::size_t size)
+{
+    const std::size_t chunks = (size + CHUNK_ALIGNMENT - 1) / CHUNK_ALIGNMENT;
+    auto& pools = GetPools();
+    if (chunks >= pools.size())
+    {
+        pools.resize(chunks + 1);
+    }
+    if (!pools[chunks])
+    {
+        pools[chunks].reset(new SlabPool(chunks * CHUNK_ALIGNMENT));
+    }
+    return *pools[chunks];
+}
+
+}
+
+void* kv::internal::AllocateObject(std::size_t size)
+{
+    return GetPool(size).Allocate();
+}
+
+void kv::internal::DeallocateObject(void* pointer, std::size_t size)
+{
+    if (!pointer)
+    {
+        return;
+    }
+    GetPool(size).Deallocate(pointer);
+}
+
+void kv::internal::ReleaseObjectsPools()
+{
+    for (auto& pool : GetPools())
+    {
+        if (pool)
+        {
+            pool->Release();
+        }
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+
+namespace kv
+{
+namespace internal
+{
+
+// Game objects are allocated from slab pools, one pool for each object size,
+// so objects of one type are close in memory and allocations are cheap
+void* AllocateObject(std::size_t size);
+void DeallocateObject(void* pointer, std::size_t size);
+
+// Frees in bulk the memory of the pools without alive objects
+void ReleaseObjectsPools();
+
+}
+}
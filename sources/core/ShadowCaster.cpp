@@ -0,0 +1,186 @@
+#include "ShadowCaster.h"
+
+using kv::Position;
+
+namespace
+{
+
+const int SIZE_H_SQ = ShadowCaster::VIEW_RADIUS;
+const int SIZE_W_SQ = ShadowCaster::VIEW_RADIUS;
+// Rows up to the farthest side of the viewport
+const int MAX_DEPTH = std::max(SIZE_H_SQ, SIZE_W_SQ);
+
+int FloorDivision(int numerator, int denominator)
+{
+    const int quotient = numerator / denominator;
+    if ((numerator % denominator != 0) && ((numerator < 0) != (denominator < 0)))
+    {
+        return quotient - 1;
+    }
+    return quotient;
+}
+
+int CeilDivision(int numerator, int denominator)
+{
+    return -FloorDivision(-numerator, denominator);
+}
+
+}
+
+// Maps (depth, column) in the quadrant to the map position
+struct ShadowCaster::Quadrant
+{
+    int depth_x;
+    int depth_y;
+    int column_x;
+    int column_y;
+
+    Position center;
+    VisiblePoints* retval;
+    std::vector<char>* visibility;
+
+    Position ToPosition(int depth, int column) const
+    {
+        return Position(
+            center.x + depth * depth_x + column * column_x,
+            center.y + depth * depth_y + column * column_y,
+            center.z);
+    }
+};
+
+ShadowCaster::ShadowCaster(int width, int height, const QBitArray& opacity)
+    : width_(width),
+      height_(height),
+      opacity_(opacity)
+{
+    // Nothing
+}
+
+int ShadowCaster::RoundTiesUp(int depth, Slope slope)
+{
+    // floor(depth * slope + 1/2)
+    return FloorDivision(2 * depth * slope.numerator + slope.denominator, 2 * slope.denominator);
+}
+
+int ShadowCaster::RoundTiesDown(int depth, Slope slope)
+{
+    // ceil(depth * slope - 1/2)
+    return CeilDivision(2 * depth * slope.numerator - slope.denominator, 2 * slope.denominator);
+}
+
+bool ShadowCaster::IsSymmetric(const Row& row, int column)
+{
+    return column * row.start.denominator >= row.depth * row.start.numerator
+        && column * row.end.denominator <= row.depth * row.end.numerator;
+}
+
+bool ShadowCaster::IsOpaque(const Quadrant& quadrant, int depth, int column) const
+{
+    const Position position = quadrant.ToPosition(depth, column);
+    if (   position.x < 0 || position.x >= width_
+        || position.y < 0 || position.y >= height_)
+    {
+        return true;
+    }
+    return opacity_.testBit(position.x + position.y * width_);
+}
+
+void ShadowCaster::Reveal(const Quadrant& quadrant, int depth, int column) const
+{
+    const Position position = quadrant.ToPosition(depth, column);
+    if (   position.x < 0 || position.x >= width_
+        || position.y < 0 || position.y >= height_)
+    {
+        return;
+    }
+
+    const int vis_x = position.x - quadrant.center.x + SIZE_W_SQ;
+    const int vis_y = position.y - quadrant.center.y + SIZE_H_SQ;
+    if (   vis_x < 0 || vis_x >= 2 * SIZE_W_SQ
+        || vis_y < 0 || vis_y >= 2 * SIZE_H_SQ)
+    {
+        return;
+    }
+
+    char& visible = (*quadrant.visibility)[2 * SIZE_H_SQ * vis_x + vis_y];
+    if (visible)
+    {
+        return;
+    }
+    visible = 1;
+    quadrant.retval->push_back(position);
+}
+
+void ShadowCaster::Scan(const Quadrant& quadrant, Row row) const
+{
+    if (row.depth > MAX_DEPTH)
+    {
+        return;
+    }
+
+    const int min_column = RoundTiesUp(row.depth, row.start);
+    const int max_column = RoundTiesDown(row.depth, row.end);
+
+    bool has_previous = false;
+    bool previous_opaque = false;
+    for (int column = min_column; column <= max_column; ++column)
+    {
+        const bool opaque = IsOpaque(quadrant, row.depth, column);
+        // Walls are visible when any part of them is lit,
+        // floor only when its center is lit
+        if (opaque || IsSymmetric(row, column))
+        {
+            Reveal(quadrant, row.depth, column);
+        }
+
+        const Slope slope{2 * column - 1, 2 * row.depth};
+        if (has_previous && previous_opaque && !opaque)
+        {
+            row.start = slope;
+        }
+        if (has_previous && !previous_opaque && opaque)
+        {
+            Scan(quadrant, {row.depth + 1, row.start, slope});
+        }
+
+        has_previous = true;
+        previous_opaque = opaque;
+    }
+    if (has_previous && !previous_opaque)
+    {
+        Scan(quadrant, {row.depth + 1, row.start, row.end});
+    }
+}
+
+void ShadowCaster::Calculate(VisiblePoints* retval, int posx, int posy, int posz) const
+{
+    if (   posx < 0 || posx >= width_
+        || posy < 0 || posy >= height_)
+    {
+        return;
+    }
+
+    std::vector<char> visibility(4 * SIZE_H_SQ * SIZE_W_SQ, 0);
+
+    // North, south, east and west
+    const int DIRECTIONS[4][4]
+        = { { 0, -1, 1, 0 },
+            { 0, 1, 1, 0 },
+            { 1, 0, 0, 1 },
+            { -1, 0, 0, 1 } };
+
+    for (const auto& direction : DIRECTIONS)
+    {
+        Quadrant quadrant;
+        quadrant.depth_x = direction[0];
+        quadrant.depth_y = direction[1];
+        quadrant.column_x = direction[2];
+        quadrant.column_y = direction[3];
+        quadrant.center = Position(posx, posy, posz);
+        quadrant.retval = retval;
+        quadrant.visibility = &visibility;
+
+        Reveal(quadrant, 0, 0);
+        Scan(quadrant, {1, {-1, 1}, {1, 1}});
+    }
+}
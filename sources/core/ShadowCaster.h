@@ -0,0 +1,46 @@
+#pragma once
+
+#include "Interfaces.h"
+
+#include <QBitArray>
+#include <QVector>
+
+// Symmetric shadowcasting: each quadrant around the viewer is scanned row by row,
+// and opaque tiles narrow the visible slopes for the next rows.
+// The viewport and the result format are the same as in LosCalculator.
+class ShadowCaster
+{
+public:
+    // Visible tiles are in [pos - VIEW_RADIUS, pos + VIEW_RADIUS) on both axes
+    static const int VIEW_RADIUS = 12;
+
+    // Opacity is the bitmap of the viewer z level, see Map::GetOpacity
+    ShadowCaster(int width, int height, const QBitArray& opacity);
+    void Calculate(VisiblePoints* retval, int posx, int posy, int posz = 0) const;
+private:
+    // numerator / denominator, the denominator is always positive
+    struct Slope
+    {
+        int numerator;
+        int denominator;
+    };
+    struct Row
+    {
+        int depth;
+        Slope start;
+        Slope end;
+    };
+    struct Quadrant;
+
+    static int RoundTiesUp(int depth, Slope slope);
+    static int RoundTiesDown(int depth, Slope slope);
+    static bool IsSymmetric(const Row& row, int column);
+
+    void Scan(const Quadrant& quadrant, Row row) const;
+    bool IsOpaque(const Quadrant& quadrant, int depth, int column) const;
+    void Reveal(const Quadrant& quadrant, int depth, int column) const;
+
+    const int width_;
+    const int height_;
+    const QBitArray& opacity_;
+};
@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+
+#include <QBitArray>
+#include <QHash>
+#include <QSet>
+#include <QVector>
+
+#include "KvGlobals.h"
+
+namespace kv
+{
+
+// Values placed on the map during one tick, grouped by square chunks,
+// so a query costs the amount of the values near the points
+template<typename T>
+class SpatialBuckets
+{
+public:
+    static const int CHUNK_SIZE = 8;
+
+    void Add(const Position& position, const T& value)
+    {
+        auto it = values_.find(position);
+        if (it == values_.end())
+        {
+            chunks_[GetChunk(position)].append(positions_.size());
+            positions_.append(position);
+            it = values_.insert(position, QVector<T>());
+        }
+        it->append(value);
+    }
+
+    void Clear()
+    {
+        values_.clear();
+        chunks_.clear();
+        positions_.clear();
+    }
+
+    bool IsEmpty() const
+    {
+        return positions_.isEmpty();
+    }
+
+    const QHash<Position, QVector<T>>& GetValues() const
+    {
+        return values_;
+    }
+
+    // Calls function(value) for each value placed on the points.
+    // Values are visited in the order of the first appearance of their positions,
+    // and in the adding order for the same position.
+    template<typename Function>
+    void ForEachOn(const QVector<Position>& points, Function function) const
+    {
+        if (positions_.isEmpty() || points.isEmpty())
+        {
+            return;
+        }
+
+        QVector<int> candidates;
+        CollectCandidates(points, &candidates);
+        if (candidates.isEmpty())
+        {
+            return;
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        const PointsFilter filter(points);
+        for (const int index : qAsConst(candidates))
+        {
+            const Position& position = positions_[index];
+            if (!filter.Contains(position))
+            {
+                continue;
+            }
+            for (const T& value : *values_.constFind(position))
+            {
+                function(value);
+            }
+        }
+    }
+private:
+    // Points of one LOS lie in a small window, so they are marked in a bitmask
+    // over their bounding box, and spread points are kept in a hash set
+    class PointsFilter
+    {
+    public:
+        explicit PointsFilter(const QVector<Position>& points)
+            : min_(points.first()),
+              max_(points.first())
+        {
+            for (const Position& point : points)
+            {
+                min_.x = std::min(min_.x, point.x);
+                min_.y = std::min(min_.y, point.y);
+                min_.z = std::min(min_.z, point.z);
+                max_.x = std::max(max_.x, point.x);
+                max_.y = std::max(max_.y, point.y);
+                max_.z = std::max(max_.z, point.z);
+            }
+            width_ = max_.x - min_.x + 1;
+            height_ = max_.y - min_.y + 1;
+
+            const qint64 box_size
+                = static_cast<qint64>(width_) * height_ * (max_.z - min_.z + 1);
+            use_mask_ = box_size <= MAX_MASK_RATIO * static_cast<qint64>(points.size());
+            if (use_mask_)
+            {
+                mask_.resize(static_cast<int>(box_size));
+                for (const Position& point : points)
+                {
+                    mask_.setBit(GetIndex(point));
+                }
+                return;
+            }
+            set_.reserve(points.size());
+            for (const Position& point : points)
+            {
+                set_.insert(point);
+            }
+        }
+        bool Contains(const Position& position) const
+        {
+            if (!use_mask_)
+            {
+                return set_.contains(position);
+            }
+            if (   position.x < min_.x || position.x > max_.x
+                || position.y < min_.y || position.y > max_.y
+                || position.z < min_.z || position.z > max_.z)
+            {
+                return false;
+            }
+            return mask_.testBit(GetIndex(position));
+        }
+    private:
+        // A bit per box tile is still less than a hash set entry per point
+        static const int MAX_MASK_RATIO = 64;
+
+        int GetIndex(const Position& position) const
+        {
+            return (position.x - min_.x)
+                + ((position.y - min_.y) + (position.z - min_.z) * height_) * width_;
+        }
+
+        Position min_;
+        Position max_;
+        int width_;
+        int height_;
+        bool use_mask_;
+        QBitArray mask_;
+        QSet<Position> set_;
+    };
+
+    static int ToChunk(int coordinate)
+    {
+        return coordinate >= 0
+            ? coordinate / CHUNK_SIZE
+            : (coordinate + 1) / CHUNK_SIZE - 1;
+    }
+    static Position GetChunk(const Position& position)
+    {
+        return {ToChunk(position.x), ToChunk(position.y), position.z};
+    }
+
+    void CollectCandidates(const QVector<Position>& points, QVector<int>* candidates) const
+    {
+        Position min = GetChunk(points.first());
+        Position max = min;
+        for (const Position& point : points)
+        {
+            const Position chunk = GetChunk(point);
+            min.x = std::min(min.x, chunk.x);
+            min.y = std::min(min.y, chunk.y);
+            min.z = std::min(min.z, chunk.z);
+            max.x = std::max(max.x, chunk.x);
+            max.y = std::max(max.y, chunk.y);
+            max.z = std::max(max.z, chunk.z);
+        }
+
+        const qint64 box_size
+            = static_cast<qint64>(max.x - min.x + 1)
+            * (max.y - min.y + 1)
+            * (max.z - min.z + 1);
+        if (box_size > chunks_.size())
+        {
+            // Points are spread over the map, so it is cheaper to check all chunks
+            for (auto it = chunks_.begin(); it != chunks_.end(); ++it)
+            {
+                const Position& chunk = it.key();
+                if (   chunk.x >= min.x && chunk.x <= max.x
+                    && chunk.y >= min.y && chunk.y <= max.y
+                    && chunk.z >= min.z && chunk.z <= max.z)
+                {
+                    candidates->append(it.value());
+                }
+            }
+            return;
+        }
+
+        for (int z = min.z; z <= max.z; ++z)
+        {
+            for (int y = min.y; y <= max.y; ++y)
+            {
+                for (int x = min.x; x <= max.x; ++x)
+                {
+                    const auto it = chunks_.find({x, y, z});
+                    if (it != chunks_.end())
+                    {
+                        candidates->append(it.value());
+                    }
+                }
+            }
+        }
+    }
+
+    QHash<Position, QVector<T>> values_;
+    // Indexes in positions_ for each chunk
+    QHash<Position, QVector<int>> chunks_;
+    // Positions in the order of their first appearance
+    QVector<Position> positions_;
+};
+
+}
@@ -0,0 +1,124 @@
+#include "TileGrid.h"
+
+#include "KvAbort.h"
+
+#include <algorithm>
+
+using namespace kv;
+
+TileGrid::TileGrid()
+    : width_(0),
+      height_(0),
+      depth_(0)
+{
+    // Nothing
+}
+
+void TileGrid::Resize(int width, int height, int depth)
+{
+    QVector<Tile> tiles(width * height * depth);
+    const int common_width = std::min(width, width_);
+    const int common_height = std::min(height, height_);
+    const int common_depth = std::min(depth, depth_);
+    for (int z = 0; z < common_depth; ++z)
+    {
+        for (int y = 0; y < common_height; ++y)
+        {
+            for (int x = 0; x < common_width; ++x)
+            {
+                tiles[x + (y + z * height) * width] = At(x, y, z);
+            }
+        }
+    }
+
+    width_ = width;
+    height_ = height;
+    depth_ = depth;
+    tiles_ = std::move(tiles);
+}
+
+namespace kv
+{
+
+FastSerializer& operator<<(FastSerializer& file, const TileGrid& grid)
+{
+    file << grid.GetWidth();
+    for (int x = 0; x < grid.GetWidth(); ++x)
+    {
+        file << grid.GetHeight();
+        for (int y = 0; y < grid.GetHeight(); ++y)
+        {
+            file << grid.GetDepth();
+            for (int z = 0; z < grid.GetDepth(); ++z)
+            {
+                file << grid.At(x, y, z);
+            }
+        }
+    }
+    return file;
+}
+
+FastDeserializer& operator>>(FastDeserializer& file, TileGrid& grid)
+{
+    int width;
+    file >> width;
+    grid.Resize(0, 0, 0);
+
+    // Sizes of the inner vectors are known only after the first of them is read
+    for (int x = 0; x < width; ++x)
+    {
+        int height;
+        file >> height;
+        if (x == 0)
+        {
+            grid.Resize(width, height, 0);
+        }
+        if (height != grid.GetHeight())
+        {
+            kv::Abort(QString("Map column %1 has height %2 instead of %3")
+                .arg(x).arg(height).arg(grid.GetHeight()));
+        }
+        for (int y = 0; y < height; ++y)
+        {
+            int depth;
+            file >> depth;
+            if (x == 0 && y == 0)
+            {
+                grid.Resize(width, height, depth);
+            }
+            if (depth != grid.GetDepth())
+            {
+                kv::Abort(QString("Map column (%1, %2) has depth %3 instead of %4")
+                    .arg(x).arg(y).arg(depth).arg(grid.GetDepth()));
+            }
+            for (int z = 0; z < depth; ++z)
+            {
+                file >> grid.At(x, y, z);
+            }
+        }
+    }
+    return file;
+}
+
+unsigned int Hash(const TileGrid& grid)
+{
+    // Same as the hash of the nested vectors
+    unsigned int retval = 0;
+    for (int x = 0; x < grid.GetWidth(); ++x)
+    {
+        unsigned int column = 0;
+        for (int y = 0; y < grid.GetHeight(); ++y)
+        {
+            unsigned int cell = 0;
+            for (int z = 0; z < grid.GetDepth(); ++z)
+            {
+                cell += (z + 1) * Hash(grid.At(x, y, z));
+            }
+            column += (y + 1) * cell;
+        }
+        retval += (x + 1) * column;
+    }
+    return retval;
+}
+
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <QVector>
+
+#include "KvGlobals.h"
+#include "Idptr.h"
+
+namespace kv
+{
+
+class CubeTile;
+
+// Tiles of the map in one array. Levels go one after another, and x changes first
+// inside of a level, like in the opacity bitmaps, so walks over a level are sequential.
+class TileGrid
+{
+public:
+    using Tile = IdPtr<CubeTile>;
+
+    TileGrid();
+
+    // Tiles keep their positions, new tiles are empty
+    void Resize(int width, int height, int depth);
+
+    int GetWidth() const { return width_; }
+    int GetHeight() const { return height_; }
+    int GetDepth() const { return depth_; }
+
+    int GetIndex(int x, int y, int z) const
+    {
+        return x + (y + z * height_) * width_;
+    }
+
+    Tile& At(int x, int y, int z)
+    {
+        return tiles_[GetIndex(x, y, z)];
+    }
+    const Tile& At(int x, int y, int z) const
+    {
+        return tiles_[GetIndex(x, y, z)];
+    }
+
+    // The coordinates which would leave the map stay the same
+    const Tile& GetNeighbour(const Position& position, Dir dir) const
+    {
+        const Vector shift = DirToVDir(dir);
+        int index = GetIndex(position.x, position.y, position.z);
+        if (IsInside(position.x + shift.x, width_))
+        {
+            index += shift.x;
+        }
+        if (IsInside(position.y + shift.y, height_))
+        {
+            index += shift.y * width_;
+        }
+        if (IsInside(position.z + shift.z, depth_))
+        {
+            index += shift.z * width_ * height_;
+        }
+        return tiles_[index];
+    }
+
+    const QVector<Tile>& GetTiles() const { return tiles_; }
+private:
+    static bool IsInside(int coordinate, int size)
+    {
+        return coordinate >= 0 && coordinate < size;
+    }
+
+    int width_;
+    int height_;
+    int depth_;
+    QVector<Tile> tiles_;
+};
+
+// The grid is saved and hashed as nested [x][y][z] vectors,
+// so the maps saved before the flat storage can be loaded
+FastSerializer& operator<<(FastSerializer& file, const TileGrid& grid);
+FastDeserializer& operator>>(FastDeserializer& file, TileGrid& grid);
+unsigned int Hash(const TileGrid& grid);
+
+}
@@ -0,0 +1,96 @@
+#include "VisibilityCache.h"
+
+#include <algorithm>
+
+using namespace kv;
+
+VisibilityCache::VisibilityCache(int view_radius)
+    : view_radius_(view_radius),
+      width_(0),
+      height_(0),
+      width_chunks_(0),
+      epoch_(0)
+{
+    // Nothing
+}
+
+void VisibilityCache::Reset(int width, int height, int depth)
+{
+    width_ = width;
+    height_ = height;
+    width_chunks_ = (width + CHUNK_SIZE - 1) / CHUNK_SIZE;
+    const int height_chunks = (height + CHUNK_SIZE - 1) / CHUNK_SIZE;
+
+    epochs_.fill(QVector<quint32>(width_chunks_ * height_chunks, 0), depth);
+    epoch_ = 0;
+    entries_.clear();
+}
+
+void VisibilityCache::Invalidate(const Position& position)
+{
+    ++epoch_;
+    const int chunk = position.x / CHUNK_SIZE + (position.y / CHUNK_SIZE) * width_chunks_;
+    epochs_[position.z][chunk] = epoch_;
+}
+
+bool VisibilityCache::Find(const Position& position, QVector<Position>* retval)
+{
+    const quint32 epoch = GetEpoch(position);
+
+    QMutexLocker lock(&mutex_);
+    auto it = entries_.find(position);
+    if (it == entries_.end() || it->epoch != epoch)
+    {
+        return false;
+    }
+    it->used = true;
+    // The points are shared, so it is cheap
+    *retval = it->points;
+    return true;
+}
+
+void VisibilityCache::Insert(const Position& position, const QVector<Position>& points)
+{
+    const quint32 epoch = GetEpoch(position);
+
+    QMutexLocker lock(&mutex_);
+    entries_[position] = Entry{epoch, true, points};
+}
+
+void VisibilityCache::RemoveUnused()
+{
+    for (auto it = entries_.begin(); it != entries_.end();)
+    {
+        if (!it->used)
+        {
+            it = entries_.erase(it);
+            continue;
+        }
+        it->used = false;
+        ++it;
+    }
+}
+
+quint32 VisibilityCache::GetEpoch(const Position& position) const
+{
+    if (position.z < 0 || position.z >= epochs_.size())
+    {
+        return 0;
+    }
+    const QVector<quint32>& level = epochs_[position.z];
+
+    const int min_x = std::max(0, position.x - view_radius_) / CHUNK_SIZE;
+    const int max_x = std::min(width_ - 1, position.x + view_radius_ - 1);
+    const int min_y = std::max(0, position.y - view_radius_) / CHUNK_SIZE;
+    const int max_y = std::min(height_ - 1, position.y + view_radius_ - 1);
+
+    quint32 retval = 0;
+    for (int y = min_y; y * CHUNK_SIZE <= max_y; ++y)
+    {
+        for (int x = min_x; x * CHUNK_SIZE <= max_x; ++x)
+        {
+            retval = std::max(retval, level[x + y * width_chunks_]);
+        }
+    }
+    return retval;
+}
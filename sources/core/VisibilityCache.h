@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+
+#include "KvGlobals.h"
+
+namespace kv
+{
+
+// LOS results which are reused while the viewer stays on the same tile
+// and the opacity of the tiles in its view does not change.
+// Find and Insert can be called concurrently, other methods cannot.
+class VisibilityCache
+{
+public:
+    // Opacity changes are tracked by square chunks
+    static const int CHUNK_SIZE = 8;
+
+    // Tiles from [pos - view_radius, pos + view_radius) can affect the result
+    explicit VisibilityCache(int view_radius);
+
+    // Forgets all results
+    void Reset(int width, int height, int depth);
+    // Should be called when the opacity of the tile is changed
+    void Invalidate(const Position& position);
+
+    // Returns false if there is no result calculated with the current opacity
+    bool Find(const Position& position, QVector<Position>* retval);
+    void Insert(const Position& position, const QVector<Position>& points);
+
+    // Forgets results which were not found since the previous call
+    void RemoveUnused();
+private:
+    quint32 GetEpoch(const Position& position) const;
+
+    struct Entry
+    {
+        quint32 epoch;
+        bool used;
+        QVector<Position> points;
+    };
+
+    const int view_radius_;
+
+    int width_;
+    int height_;
+    int width_chunks_;
+    // Last change for each chunk of each level
+    QVector<QVector<quint32>> epochs_;
+    quint32 epoch_;
+
+    QMutex mutex_;
+    QHash<Position, Entry> entries_;
+};
+
+}
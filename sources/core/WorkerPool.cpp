@@ -0,0 +1,98 @@
+#include "WorkerPool.h"
+
+#include <QRunnable>
+#include <QSemaphore>
+
+#include <algorithm>
+#include <atomic>
+
+#include "KvAbort.h"
+
+namespace
+{
+
+void ProcessIndexes(
+    std::atomic<int>* next, int size, const std::function<void(int)>& function)
+{
+    for (int index = (*next)++; index < size; index = (*next)++)
+    {
+        function(index);
+    }
+}
+
+class Task : public QRunnable
+{
+public:
+    Task(std::atomic<int>* next,
+         int size,
+         const std::function<void(int)>* function,
+         QSemaphore* done)
+        : next_(next),
+          size_(size),
+          function_(function),
+          done_(done)
+    {
+        // Nothing
+    }
+    virtual void run() override
+    {
+        ProcessIndexes(next_, size_, *function_);
+        done_->release();
+    }
+private:
+    std::atomic<int>* next_;
+    int size_;
+    const std::function<void(int)>* function_;
+    QSemaphore* done_;
+};
+
+}
+
+namespace kv
+{
+
+WorkerPool::WorkerPool(int threads_amount)
+    : threads_amount_(threads_amount)
+{
+    if (threads_amount_ < 1)
+    {
+        kv::Abort(QString("Invalid amount of worker threads: %1").arg(threads_amount_));
+    }
+    pool_.setMaxThreadCount(std::max(1, threads_amount_ - 1));
+    // Workers are needed each tick, so there is no point to stop them
+    pool_.setExpiryTimeout(-1);
+}
+
+WorkerPool::~WorkerPool()
+{
+    pool_.waitForDone();
+}
+
+int WorkerPool::GetThreadsAmount() const
+{
+    return threads_amount_;
+}
+
+void WorkerPool::ParallelFor(int size, const std::function<void(int)>& function)
+{
+    const int helpers_amount = std::min(threads_amount_, size) - 1;
+    if (helpers_amount <= 0)
+    {
+        for (int index = 0; index < size; ++index)
+        {
+            function(index);
+        }
+        return;
+    }
+
+    std::atomic<int> next(0);
+    QSemaphore done;
+    for (int i = 0; i < helpers_amount; ++i)
+    {
+        pool_.start(new Task(&next, size, &function, &done));
+    }
+    ProcessIndexes(&next, size, function);
+    done.acquire(helpers_amount);
+}
+
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <functional>
+
+#include <QThreadPool>
+
+namespace kv
+{
+
+class WorkerPool
+{
+public:
+    // The calling thread is counted as one of the workers
+    explicit WorkerPool(int threads_amount);
+    ~WorkerPool();
+
+    int GetThreadsAmount() const;
+
+    // Calls 'function' once for each index from [0, size) and returns
+    // after all the calls are done. Indexes are processed concurrently in
+    // an unspecified order, so a call should touch only the data which belongs
+    // to its index - then the result does not depend on the amount of threads.
+    void ParallelFor(int size, const std::function<void(int)>& function);
+private:
+    int threads_amount_;
+    QThreadPool pool_;
+};
+
+}
@@ -1,6 +1,7 @@
 #include "WorldLoaderSaver.h"
 
 #include <QFile>
+#include <QHash>
 #include <QJsonArray>
 
 #include "Idptr.h"
@@ -24,24 +25,88 @@ namespace kv
 namespace world
 {
 
+namespace
+{
+
+const quint32 SAVE_FORMAT_VERSION = 4;
+
+void SaveTypesDictionary(kv::FastSerializer& serializer)
+{
+    const auto& creators = *GetVoidItemsCreators();
+    serializer << static_cast<quint32>(creators.size());
+    for (const VoidItemCreatorInfo& info : creators)
+    {
+        serializer << info.type;
+    }
+}
+
+// Maps type indexes from the save to the type indexes of the current build,
+// -1 stands for types unknown to the current build
+std::vector<int> LoadTypesDictionary(kv::FastDeserializer& deserializer)
+{
+    QHash<QString, int> local_indexes;
+    const auto& creators = *GetVoidItemsCreators();
+    for (int i = 0; i < static_cast<int>(creators.size()); ++i)
+    {
+        local_indexes.insert(creators[i].type, i);
+    }
+
+    quint32 size;
+    deserializer >> size;
+
+    std::vector<int> retval;
+    retval.reserve(size);
+    for (quint32 i = 0; i < size; ++i)
+    {
+        QString type;
+        deserializer >> type;
+        retval.push_back(local_indexes.value(type, -1));
+    }
+    return retval;
+}
+
+} // namespace
+
 void Save(const GameInterface* game, kv::FastSerializer& serializer)
 {
+    // The header is always tagged, the rest is written in the mode of the serializer
+    const FastSerializer::Mode mode = serializer.GetMode();
+    serializer.SetMode(FastSerializer::Mode::TAGGED);
+    serializer << SAVE_FORMAT_VERSION;
+    serializer << (mode == FastSerializer::Mode::COMPACT);
+    serializer << GetSchemaHash();
+    serializer.SetMode(mode);
+
+    SaveTypesDictionary(serializer);
+
     SaveMapHeader(game, serializer);
 
     auto& objects_table = game->GetFactory().GetIdTable();
 
+    quint32 objects_amount = 0;
+    for (auto it = objects_table.begin() + 1; it != objects_table.end(); ++it)
+    {
+        if (it->object)
+        {
+            ++objects_amount;
+        }
+    }
+    serializer << objects_amount;
+
     auto it = objects_table.begin();
     ++it;
     while (it != objects_table.end())
     {
-        if (it->object)
+        if (kv::Object* object = it->object)
         {
-            it->object->Save(serializer);
+            OBJECT_SERIALIZERS[object->GetTypeIndex()].save(object, serializer);
         }
         ++it;
     }
 
+    serializer.SetMode(FastSerializer::Mode::TAGGED);
     serializer.WriteType(kv::END_TYPE);
+    serializer.SetMode(mode);
 }
 
 void Load(GameInterface* game, kv::FastDeserializer& deserializer)
@@ -50,26 +115,61 @@ void Load(GameInterface* game, kv::FastDeserializer& deserializer)
 
     factory.Clear();
 
-    LoadMapHeader(game, deserializer);
-    while (!deserializer.IsEnd())
+    quint32 version = 0;
+    if (deserializer.IsNextType(kv::FastSerializer::UINT32_TYPE))
     {
-        QString type;
-        deserializer.ReadType(&type);
+        deserializer >> version;
+    }
+    if (version != SAVE_FORMAT_VERSION)
+    {
+        kv::Abort(QString("Unsupported save format version: %1").arg(version));
+    }
+    bool is_compact;
+    deserializer >> is_compact;
+    quint32 schema_hash;
+    deserializer >> schema_hash;
+    if (schema_hash != GetSchemaHash())
+    {
+        kv::Abort(
+            QString("Save schema mismatch: expected - %1, actual - %2")
+                .arg(GetSchemaHash())
+                .arg(schema_hash));
+    }
+    deserializer.SetMode(
+        is_compact ? FastSerializer::Mode::COMPACT : FastSerializer::Mode::TAGGED);
+
+    const std::vector<int> types = LoadTypesDictionary(deserializer);
+
+    LoadMapHeader(game, deserializer);
 
-        if (type == kv::END_TYPE)
+    quint32 objects_amount;
+    deserializer >> objects_amount;
+    for (quint32 i = 0; i < objects_amount; ++i)
+    {
+        quint32 saved_index;
+        deserializer.ReadTypeIndex(&saved_index);
+        if (saved_index >= types.size() || types[saved_index] == -1)
         {
-            qDebug() << "Zero id reached";
-            break;
+            kv::Abort(QString("Unknown type index in the save: %1").arg(saved_index));
         }
 
         quint32 id_loc;
         deserializer >> id_loc;
 
-        kv::Object* object = factory.CreateVoid(type, id_loc);
-        object->Load(deserializer);
+        kv::Object* object = factory.CreateVoid(types[saved_index], id_loc);
+        OBJECT_SERIALIZERS[types[saved_index]].load(object, deserializer);
+    }
+
+    deserializer.SetMode(FastSerializer::Mode::TAGGED);
+    QString end;
+    deserializer.ReadType(&end);
+    if (end != kv::END_TYPE)
+    {
+        kv::Abort(QString("Unexpected end of the save: %1").arg(end));
     }
     factory.MarkWorldAsCreated();
 
+    game->GetMap().LoadOpacity();
     game->GetAtmosphere().LoadGrid(&game->GetMap());
 }
 
@@ -78,6 +178,7 @@ void SaveMapHeader(const GameInterface* game, kv::FastSerializer& serializer)
     const ObjectFactoryInterface& factory = game->GetFactory();
 
     serializer << factory.GetId();
+    serializer << factory.GetFreeIds();
 
     serializer << game->GetGlobals();
 }
@@ -91,6 +192,10 @@ void LoadMapHeader(GameInterface* game, kv::FastDeserializer& deserializer)
     qDebug() << "id_: " << id;
     factory.SetId(id);
 
+    QVector<quint32> free_ids;
+    deserializer >> free_ids;
+    factory.SetFreeIds(free_ids);
+
     quint32 globals;
     deserializer >> globals;
     game->SetGlobals(globals);
@@ -293,6 +398,7 @@ void LoadFromJsonMapGen(GameInterface* game, const QJsonObject& data)
 
     factory.FinishWorldCreation();
     game->GetMap().FillTilesAtmosHolders();
+    game->GetMap().LoadOpacity();
 }
 
 } // namespace world
@@ -12,8 +12,9 @@
 
 using namespace kv;
 
-Atmosphere::Atmosphere()
-    : map_(nullptr)
+Atmosphere::Atmosphere(WorkerPool* workers)
+    : workers_(workers),
+      map_(nullptr)
 {
     grid_processing_ns_ = 0;
     movement_processing_ns_ = 0;
@@ -24,7 +25,11 @@ Atmosphere::Atmosphere()
 
     qDebug() << "Atmosphere load";
     z_size_ = 1;
-    grid_ = nullptr;
+}
+
+Atmosphere::~Atmosphere()
+{
+    // Nothing
 }
 
 void Atmosphere::Resize(quint32 x, quint32 y, quint32 z)
@@ -33,8 +38,12 @@ void Atmosphere::Resize(quint32 x, quint32 y, quint32 z)
     y_size_ = y;
     z_size_ = z;
 
-    delete grid_;
-    grid_ = new atmos::AtmosGrid(x_size_, y_size_);
+    grids_.clear();
+    for (int z_level = 0; z_level < z_size_; ++z_level)
+    {
+        grids_.emplace_back(new atmos::AtmosGrid(x_size_, y_size_));
+        grids_.back()->SetWorkerPool(workers_);
+    }
 }
 
 void Atmosphere::Process(qint32 game_tick)
@@ -43,7 +52,15 @@ void Atmosphere::Process(qint32 game_tick)
 
     QElapsedTimer timer;
     timer.start();
-    grid_->Process(game_tick);
+    // Each level is spread between the workers by itself
+    for (auto& grid : grids_)
+    {
+        grid->Process(game_tick);
+    }
+    for (int z = 0; z < z_size_ - 1; ++z)
+    {
+        grids_[z]->ProcessVertical(grids_[z + 1].get());
+    }
     grid_processing_ns_ = (grid_processing_ns_ + timer.nsecsElapsed()) / 2;
     timer.start();
 }
@@ -53,23 +70,24 @@ const int FLOW_MOVE_BORDER = -15;
 
 void Atmosphere::ProcessTileMove(int x, int y, int z, qint32 game_tick)
 {
-    atmos::AtmosGrid::Cell& cell = grid_->At(x, y);
+    atmos::AtmosGrid* grid = grids_[z].get();
+    const int index = grid->GetIndex(x, y);
 
     Vector force;
 
-    if (cell.flags & atmos::NO_OBJECTS)
+    if (grid->GetFlags(index) & atmos::NO_OBJECTS)
     {
         for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
         {
-            cell.flows[dir] = 0;
+            grid->Flow(index, dir) = 0;
         }
     }
     else
     {
         for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
         {
-            int flow = cell.flows[dir];
-            cell.flows[dir] = 0;
+            int flow = grid->Flow(index, dir);
+            grid->Flow(index, dir) = 0;
             if (flow <= FLOW_MOVE_BORDER)
             {
                 Vector local = DirToVDir(atmos::INDEXES_TO_DIRS[static_cast<int>(dir)]);
@@ -107,7 +125,7 @@ void Atmosphere::ProcessTileMove(int x, int y, int z, qint32 game_tick)
         return;
     }
 
-    if (!cell.IsPassable(atmos::CENTER_BLOCK))
+    if (!grid->IsPassable(index, atmos::CENTER_BLOCK))
     {
         return;
     }
@@ -123,29 +141,31 @@ void Atmosphere::ProcessTileMove(int x, int y, int z, qint32 game_tick)
     auto tile = map_->At(x, y, z);
     for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
     {
-        atmos::AtmosGrid::Cell& nearby = grid_->Get(x, y, atmos::INDEXES_TO_DIRS[dir]);
-        if (  (nearby.data.pressure + PRESSURE_MOVE_BORDER)
-            < cell.data.pressure)
+        const int nearby = grid->GetNearIndex(x, y, atmos::INDEXES_TO_DIRS[dir]);
+        const int pressure = grid->GetPressure(index);
+        const int nearby_pressure = grid->GetPressure(nearby);
+        if (  (nearby_pressure + PRESSURE_MOVE_BORDER)
+            < pressure)
         {
-            if (!cell.IsPassable(atmos::DIRS[dir]))
+            if (!grid->IsPassable(index, atmos::DIRS[dir]))
             {
                 const Dir bump_dir = atmos::INDEXES_TO_DIRS[dir];
-                int force = (cell.data.pressure - nearby.data.pressure) / PRESSURE_PER_FORCE;
+                int force = (pressure - nearby_pressure) / PRESSURE_PER_FORCE;
                 force = std::max(1, force) * FORCE_UNIT;
                 tile->BumpByGas(force * DirToVDir(bump_dir), true);
                 continue;
             }
         }
-        else if (  (cell.data.pressure + PRESSURE_MOVE_BORDER)
-                 < nearby.data.pressure)
+        else if (  (pressure + PRESSURE_MOVE_BORDER)
+                 < nearby_pressure)
         {
-            if (nearby.IsPassable(atmos::REVERT_DIRS[dir]))
+            if (grid->IsPassable(nearby, atmos::REVERT_DIRS[dir]))
             {
-                if (!cell.IsPassable(atmos::DIRS[dir]))
+                if (!grid->IsPassable(index, atmos::DIRS[dir]))
                 {
                     const int revert_dir = atmos::REVERT_DIRS_INDEXES[dir];
                     const Dir bump_dir = atmos::INDEXES_TO_DIRS[revert_dir];
-                    int force = (cell.data.pressure - nearby.data.pressure) / PRESSURE_PER_FORCE;
+                    int force = (pressure - nearby_pressure) / PRESSURE_PER_FORCE;
                     force = std::max(1, force) * FORCE_UNIT;
                     tile->BumpByGas(force * DirToVDir(bump_dir), false);
                     continue;
@@ -164,9 +184,8 @@ void Atmosphere::ProcessTileFire(int x, int y, int z, qint32 game_tick)
         return;
     }
 
-    atmos::AtmosGrid::Cell& cell = grid_->At(x, y);
-
-    if (!cell.data.fire)
+    atmos::AtmosGrid* grid = grids_[z].get();
+    if (!grid->IsBurning(grid->GetIndex(x, y)))
     {
         return;
     }
@@ -183,12 +202,22 @@ void Atmosphere::ProcessConsequences(qint32 game_tick)
 
     for (int z = 0; z < z_size_; ++z)
     {
+        atmos::AtmosGrid* grid = grids_[z].get();
         for (int x = 0; x < x_size_; ++x)
         {
-            for (int y = 0; y < y_size_; ++y)
+            for (int group_y = 0; group_y < y_size_; group_y += atmos::CELL_GROUP_SIZE)
             {
-                ProcessTileMove(x, y, z, game_tick);
-                ProcessTileFire(x, y, z, game_tick);
+                // Nothing moves and burns in idle groups
+                const int index = grid->GetIndex(x, group_y);
+                if (grid->IsIdle(grid->GetGroupIndex(index)))
+                {
+                    continue;
+                }
+                for (int y = group_y; y < group_y + atmos::CELL_GROUP_SIZE; ++y)
+                {
+                    ProcessTileMove(x, y, z, game_tick);
+                    ProcessTileFire(x, y, z, game_tick);
+                }
             }
         }
     }
@@ -207,13 +236,27 @@ void Atmosphere::Represent(GrowingFrame* frame) const
         FrameData::TextEntry{
             "Performance",
             QString("Atmos move processing: %1 ms").arg((movement_processing_ns_ * 1.0) / 1000000.0)});
+
+    if (!grids_.empty())
+    {
+        int active_groups = 0;
+        for (const auto& grid : grids_)
+        {
+            active_groups += grid->GetActiveGroupsAmount();
+        }
+        frame->Append(
+            FrameData::TextEntry{
+                "Performance",
+                QString("Atmos active groups: %1").arg(active_groups)});
+    }
 }
 
 void Atmosphere::SetFlags(quint32 x, quint32 y, quint32 z, AtmosInterface::Flags flags)
 {
     AssertGrid();
 
-    grid_->At(x, y).flags = flags;
+    atmos::AtmosGrid* grid = grids_[z].get();
+    grid->SetFlags(grid->GetIndex(x, y), flags);
 }
 
 void Atmosphere::LoadGrid(MapInterface* map)
@@ -231,15 +274,22 @@ void Atmosphere::LoadGrid(MapInterface* map)
                 auto& tile = map_->At(x, y, z);
                 tile->UpdateAtmosPassable();
                 atmos::AtmosHolder* holder = tile->GetAtmosHolder();
-                atmos::AtmosGrid::Cell& cell = grid_->At(x, y);
-
-                cell.data = holder->data_;
-                holder->SetAtmosData(&cell.data);
+                holder->BindToGrid(grids_[z].get(), grids_[z]->GetIndex(x, y));
             }
         }
     }
 }
 
+quint32 Atmosphere::Hash()
+{
+    quint32 retval = 0;
+    for (int z = 0; z < static_cast<int>(grids_.size()); ++z)
+    {
+        retval += (z + 1) * grids_[z]->Hash();
+    }
+    return retval;
+}
+
 void Atmosphere::AssertGrid()
 {
     kv::Assert(map_, "Atmosphere: Grid is not loaded!");
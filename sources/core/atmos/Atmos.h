@@ -1,6 +1,7 @@
 #pragma once
 
 #include <array>
+#include <memory>
 #include <vector>
 
 #include "KvGlobals.h"
@@ -13,11 +14,17 @@ namespace atmos
 {
     class AtmosGrid;
 }
+namespace kv
+{
+    class WorkerPool;
+}
 
 class Atmosphere : public AtmosInterface
 {
 public:
-    Atmosphere();
+    // Grid is processed on the workers if they are provided
+    Atmosphere(kv::WorkerPool* workers = nullptr);
+    ~Atmosphere();
 
     virtual void Process(qint32 game_tick) override;
     virtual void ProcessConsequences(qint32 game_tick) override;
@@ -26,12 +33,17 @@ public:
 
     virtual void SetFlags(quint32 x, quint32 y, quint32 z, Flags flags) override;
     virtual void LoadGrid(MapInterface* map) override;
+
+    // Cells of the grids are not hashed by the tiles atmos holders
+    virtual quint32 Hash() override;
 private:
     void AssertGrid();
 
     void Resize(quint32 x, quint32 y, quint32 z);
 
-    atmos::AtmosGrid* grid_;
+    // One grid per z-level
+    std::vector<std::unique_ptr<atmos::AtmosGrid>> grids_;
+    kv::WorkerPool* workers_;
 
     qint64 grid_processing_ns_;
     qint64 movement_processing_ns_;
@@ -1,249 +1,511 @@
 #include "AtmosGrid.h"
 
+#include <algorithm>
+
+#include "WorkerPool.h"
+
 namespace atmos
 {
 
 void AtmosGrid::Process(qint32 game_tick)
 {
+    std::fill(changed_.begin(), changed_.end(), 0);
+
     ProcessGroups(game_tick);
     ProcessGroupsBorders(game_tick);
     Finalize();
+
+    UpdateSleeping();
 }
 
-inline void ProcessFiveCells(AtmosGrid::Cell* near_cells[])
+namespace
 {
-    int near_size = 0;
-    int gases_sums[GASES_NUM];
-    for (int i = 0; i < GASES_NUM; ++i)
+    // Gases, energy, pressure, temperature, volume, fire, flows and flags
+    const int FIELDS_AMOUNT = GASES_NUM + 5 + DIRS_SIZE + 1;
+
+    const int SIDES_BLOCKS = UP_BLOCK | DOWN_BLOCK | LEFT_BLOCK | RIGHT_BLOCK;
+
+    // Only such cells can be pushed by the pressure difference, see Atmosphere
+    inline int HasBlockedSide(int flags)
     {
-        gases_sums[i] = 0;
+        return ((flags & CENTER_BLOCK) == 0) && ((flags & SIDES_BLOCKS) != 0) ? 1 : 0;
     }
-    int energy_sum = 0;
-
-    bool fire = false;
 
-    for (int dir = 0; dir < atmos::DIRS_SIZE + 1; ++dir)
+    inline int IsOpenUp(int flags)
     {
-        if (AtmosGrid::Cell* nearby = near_cells[dir])
-        {
-            for (int i = 0; i < GASES_NUM; ++i)
-            {
-                gases_sums[i] += nearby->data.gases[i];
-            }
-            energy_sum += nearby->data.energy;
-            fire = fire || nearby->data.fire;
-            ++near_size;
-        }
+        return ((flags & (CENTER_BLOCK | ZUP_BLOCK)) == 0) ? 1 : 0;
+    }
+    inline bool IsOpenDown(int flags)
+    {
+        return (flags & (CENTER_BLOCK | ZDOWN_BLOCK)) == 0;
     }
+}
 
-    fire = fire && gases_sums[PLASMA] && gases_sums[OXYGEN];
+AtmosGrid::AtmosGrid(int width, int height)
+    : width_(width),
+      height_(height),
+      group_height_(height / atmos::CELL_GROUP_SIZE),
+      group_width_(width / atmos::CELL_GROUP_SIZE),
+      length_(width_ * height_),
+      sleeping_enabled_(true),
+      workers_(nullptr)
+{
+    if (width_ < 2)
+    {
+        kv::Abort("Width too small for AtmosGrid!");
+    }
+    if (height_ < 2)
+    {
+        kv::Abort("Height too small for AtmosGrid!");
+    }
+    if ((width_ % atmos::CELL_GROUP_SIZE) != 0)
+    {
+        kv::Abort(QString("Width is not multiplier of %1!").arg(atmos::CELL_GROUP_SIZE));
+    }
+    if ((height_ % atmos::CELL_GROUP_SIZE) != 0)
+    {
+        kv::Abort(QString("Height is not multiplier of %1!").arg(atmos::CELL_GROUP_SIZE));
+    }
 
-    int gases_average[GASES_NUM];
-    int gases_remains[GASES_NUM];
+    storage_.resize(length_ * FIELDS_AMOUNT, 0);
+    int* field = storage_.data();
+    auto next_field = [&field, this]()
+    {
+        int* retval = field;
+        field += length_;
+        return retval;
+    };
     for (int i = 0; i < GASES_NUM; ++i)
     {
-        gases_average[i] = gases_sums[i] / near_size;
-        gases_remains[i] = gases_sums[i] % near_size;
+        cells_.gases[i] = next_field();
     }
-    int energy_average = energy_sum / near_size;
-    int energy_remains = energy_sum % near_size;
+    cells_.energy = next_field();
+    cells_.pressure = next_field();
+    cells_.temperature = next_field();
+    cells_.volume = next_field();
+    cells_.fire = next_field();
+    for (int dir = 0; dir < DIRS_SIZE; ++dir)
+    {
+        cells_.flows[dir] = next_field();
+    }
+    cells_.flags = next_field();
 
-    AtmosGrid::Cell& center = *near_cells[atmos::DIRS_SIZE];
+    std::fill(cells_.volume, cells_.volume + length_, 1);
 
-    for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
+    const int GROUPS_AMOUNT = group_height_ * group_width_;
+    idle_ticks_.resize(GROUPS_AMOUNT, 0);
+    changed_.resize(GROUPS_AMOUNT, 0);
+    blocked_sides_.resize(GROUPS_AMOUNT, 0);
+    open_up_.resize(GROUPS_AMOUNT, AMOUNT_CELLS_IN_GROUP);
+    groups_hashes_.resize(GROUPS_AMOUNT, 0);
+    groups_hashes_valid_.resize(GROUPS_AMOUNT, 0);
+    strips_changed_.resize(std::max(group_width_, group_height_));
+
+    kernels_ = GetKernels(GetSupportedSimdLevel());
+}
+
+AtmosGrid::~AtmosGrid()
+{
+    // Nothing
+}
+
+AtmosData AtmosGrid::Load(int index) const
+{
+    AtmosData retval;
+    for (int i = 0; i < GASES_NUM; ++i)
     {
-        if (near_cells[dir])
-        {
-            AtmosGrid::Cell& nearby = *near_cells[dir];
-            for (int i = 0; i < GASES_NUM; ++i)
-            {
-                int diff = gases_average[i] - nearby.data.gases[i];
-                nearby.flows[atmos::REVERT_DIRS_INDEXES[dir]] += diff;
-                center.flows[dir] -= diff;
-                nearby.data.gases[i] = gases_average[i];
-            }
-            nearby.data.energy = energy_average;
-            nearby.data.fire = fire;
-        }
+        retval.gases[i] = cells_.gases[i][index];
     }
+    retval.energy = cells_.energy[index];
+    retval.pressure = cells_.pressure[index];
+    retval.volume = static_cast<qint16>(cells_.volume[index]);
+    retval.temperature = cells_.temperature[index];
+    retval.fire = cells_.fire[index] != 0;
+    return retval;
+}
 
+void AtmosGrid::Store(int index, const AtmosData& data)
+{
+    const int fire = data.fire ? 1 : 0;
+    bool changed
+        =  (cells_.energy[index] != data.energy)
+        || (cells_.volume[index] != data.volume)
+        || (cells_.fire[index] != fire);
     for (int i = 0; i < GASES_NUM; ++i)
     {
-        center.data.gases[i] = gases_average[i] + gases_remains[i];
+        changed = changed || (cells_.gases[i][index] != data.gases[i]);
+        cells_.gases[i][index] = data.gases[i];
+    }
+    cells_.energy[index] = data.energy;
+    cells_.pressure[index] = data.pressure;
+    cells_.volume[index] = data.volume;
+    cells_.temperature[index] = data.temperature;
+    cells_.fire[index] = fire;
+
+    groups_hashes_valid_[GetGroupIndex(index)] = 0;
+    if (changed)
+    {
+        WakeUp(index);
     }
-    center.data.energy = energy_average + energy_remains;
-    center.data.fire = fire;
 }
 
-inline AtmosGrid::Cell& GetNearInGroup(AtmosGrid::Cell* current, Dir dir)
+void AtmosGrid::SetFlags(int index, AtmosInterface::Flags flags)
 {
-    switch (dir)
+    if (cells_.flags[index] == flags)
     {
-    case Dir::SOUTH:
-        return *(current + 1);
-    case Dir::NORTH:
-        return *(current - 1);
-    case Dir::EAST:
-        return *(current + atmos::CELL_GROUP_SIZE);
-    case Dir::WEST:
-        return *(current - atmos::CELL_GROUP_SIZE);
+        return;
     }
-    KV_UNREACHABLE
+    const int group = GetGroupIndex(index);
+    blocked_sides_[group] -= HasBlockedSide(cells_.flags[index]);
+    open_up_[group] -= IsOpenUp(cells_.flags[index]);
+    cells_.flags[index] = flags;
+    blocked_sides_[group] += HasBlockedSide(flags);
+    open_up_[group] += IsOpenUp(flags);
+
+    WakeUp(index);
 }
 
-namespace
+void AtmosGrid::WakeUp(int index)
 {
-    const int AMOUNT_CELLS_IN_GROUP = atmos::CELL_GROUP_SIZE * atmos::CELL_GROUP_SIZE;
-    const int STAGES_AMOUNT = 5;
-    inline bool BelongsToStage(int x, int y, int stage, qint32 game_tick)
+    idle_ticks_[GetGroupIndex(index)] = 0;
+}
+
+void AtmosGrid::SetSleepingEnabled(bool enabled)
+{
+    sleeping_enabled_ = enabled;
+    std::fill(groups_hashes_valid_.begin(), groups_hashes_valid_.end(), 0);
+}
+
+int AtmosGrid::GetActiveGroupsAmount() const
+{
+    int retval = 0;
+    for (int group = 0; group < static_cast<int>(idle_ticks_.size()); ++group)
     {
-        return (((x + (y * 2)) % STAGES_AMOUNT) == ((game_tick + stage) % STAGES_AMOUNT));
+        if (!IsSleeping(group))
+        {
+            ++retval;
+        }
     }
+    return retval;
+}
 
-    inline void ProcessInnerGroupCell(AtmosGrid::Cell* current)
+void AtmosGrid::UpdateSleeping()
+{
+    for (int group = 0; group < static_cast<int>(idle_ticks_.size()); ++group)
     {
-        if (!current->IsPassable(atmos::CENTER_BLOCK))
+        if (changed_[group])
         {
-            return;
+            idle_ticks_[group] = 0;
         }
+        else if (idle_ticks_[group] < IDLE_TICKS_TO_SLEEP)
+        {
+            ++idle_ticks_[group];
+        }
+        if (!IsSleeping(group))
+        {
+            groups_hashes_valid_[group] = 0;
+        }
+    }
+}
 
-        AtmosGrid::Cell* near_cells[atmos::DIRS_SIZE + 1];
+unsigned int AtmosGrid::Hash()
+{
+    unsigned int retval = 0;
+    for (int group = 0; group < static_cast<int>(groups_hashes_.size()); ++group)
+    {
+        if (!groups_hashes_valid_[group])
+        {
+            groups_hashes_[group] = HashGroup(group);
+            // Cells of a sleeping group are changed only through Store
+            groups_hashes_valid_[group] = IsSleeping(group) ? 1 : 0;
+        }
+        retval += groups_hashes_[group];
+    }
+    return retval;
+}
 
-        for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
+unsigned int AtmosGrid::HashGroup(int group) const
+{
+    unsigned int retval = 0;
+    const int begin = group * AMOUNT_CELLS_IN_GROUP;
+    for (int index = begin; index < begin + AMOUNT_CELLS_IN_GROUP; ++index)
+    {
+        for (int i = 0; i < GASES_NUM; ++i)
         {
-            if (current->IsPassable(atmos::DIRS[dir]))
-            {
-                AtmosGrid::Cell& nearby = GetNearInGroup(current, atmos::INDEXES_TO_DIRS[dir]);
-                if (   nearby.IsPassable(atmos::REVERT_DIRS[dir])
-                    && nearby.IsPassable(atmos::CENTER_BLOCK))
-                {
-                    near_cells[dir] = &nearby;
-                    continue;
-                }
-            }
-            near_cells[dir] = nullptr;
+            retval += cells_.gases[i][index];
         }
-        near_cells[atmos::DIRS_SIZE] = current;
+        retval += cells_.energy[index];
+        retval += cells_.pressure[index];
+        retval += cells_.volume[index];
+        retval += cells_.temperature[index];
+        retval += cells_.fire[index];
+    }
+    return retval;
+}
 
-        ProcessFiveCells(near_cells);
+void AtmosGrid::SetSimdLevel(SimdLevel level)
+{
+    kv::Assert(
+        level <= GetSupportedSimdLevel(),
+        QString("Unsupported simd level: %1").arg(static_cast<int>(level)));
+    kernels_ = GetKernels(level);
+}
+
+CellsData AtmosGrid::GetGroup(int index) const
+{
+    const int shift = index * AMOUNT_CELLS_IN_GROUP;
+
+    CellsData retval = cells_;
+    for (int i = 0; i < GASES_NUM; ++i)
+    {
+        retval.gases[i] += shift;
+    }
+    retval.energy += shift;
+    retval.pressure += shift;
+    retval.temperature += shift;
+    retval.volume += shift;
+    retval.fire += shift;
+    for (int dir = 0; dir < DIRS_SIZE; ++dir)
+    {
+        retval.flows[dir] += shift;
     }
+    retval.flags += shift;
+    return retval;
 }
-inline void AtmosGrid::ProcessBorderGroupCell(Cell* current, int x, int y)
+
+inline void AtmosGrid::ProcessBorderGroupCell(int x, int y, std::vector<int>* changed)
 {
-    if (!current->IsPassable(atmos::CENTER_BLOCK))
+    const int index = GetIndex(x, y);
+    if (!IsPassable(index, atmos::CENTER_BLOCK))
     {
         return;
     }
 
-    Cell* near_cells[atmos::DIRS_SIZE + 1];
+    int near_cells[atmos::DIRS_SIZE + 1];
 
     for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
     {
-        if (current->IsPassable(atmos::DIRS[dir]))
+        if (IsPassable(index, atmos::DIRS[dir]))
         {
-            Cell& nearby = Get(x, y, atmos::INDEXES_TO_DIRS[dir]);
-            if (   nearby.IsPassable(atmos::REVERT_DIRS[dir])
-                && nearby.IsPassable(atmos::CENTER_BLOCK))
+            const int nearby = GetNearIndex(x, y, atmos::INDEXES_TO_DIRS[dir]);
+            if (   IsPassable(nearby, atmos::REVERT_DIRS[dir])
+                && IsPassable(nearby, atmos::CENTER_BLOCK))
             {
-                near_cells[dir] = &nearby;
+                near_cells[dir] = nearby;
                 continue;
             }
         }
-        near_cells[dir] = nullptr;
+        near_cells[dir] = -1;
+    }
+    near_cells[atmos::DIRS_SIZE] = index;
+
+    // All the cells are in sleeping groups which have not been changed
+    // during this tick, so they would not change
+    bool awake = false;
+    for (int dir = 0; dir < atmos::DIRS_SIZE + 1; ++dir)
+    {
+        if (near_cells[dir] < 0)
+        {
+            continue;
+        }
+        const int group = GetGroupIndex(near_cells[dir]);
+        if (!IsSleeping(group) || changed_[group])
+        {
+            awake = true;
+            break;
+        }
+    }
+    if (!awake)
+    {
+        return;
     }
-    near_cells[atmos::DIRS_SIZE] = current;
 
-    ProcessFiveCells(near_cells);
+    if (ProcessFiveCells(cells_, near_cells))
+    {
+        for (int dir = 0; dir < atmos::DIRS_SIZE + 1; ++dir)
+        {
+            if (near_cells[dir] >= 0)
+            {
+                changed->push_back(GetGroupIndex(near_cells[dir]));
+            }
+        }
+    }
+}
+
+void AtmosGrid::ForEach(int size, const std::function<void(int)>& function)
+{
+    if (workers_)
+    {
+        workers_->ParallelFor(size, function);
+        return;
+    }
+    for (int index = 0; index < size; ++index)
+    {
+        function(index);
+    }
 }
 
 void AtmosGrid::ProcessGroups(qint32 game_tick)
 {
-    Cell* current_group = &cells_[0];
     const int GROUPS_AMOUNT = group_height_ * group_width_;
-    for (int index = 0; index < GROUPS_AMOUNT; ++index, current_group += AMOUNT_CELLS_IN_GROUP)
+    ForEach(GROUPS_AMOUNT, [this, game_tick](int index)
     {
-        for (int stage = 0; stage < STAGES_AMOUNT; ++stage)
+        if (IsSleeping(index))
+        {
+            return;
+        }
+        if (kernels_.process_group(GetGroup(index), game_tick))
         {
-            for (int x = 1; x < atmos::CELL_GROUP_SIZE - 1; ++x)
+            changed_[index] = 1;
+        }
+    });
+}
+
+void AtmosGrid::ProcessGroupsBorders(qint32 game_tick)
+{
+    // Vertical strips are two cells wide and groups are much wider,
+    // so strips do not touch each other, same for horizontal ones.
+    // Vertical and horizontal strips share cells, so the horizontal
+    // ones are processed only after all the vertical ones are done.
+    // A strip may change cells of several groups, and a group may be
+    // changed by several strips, so each strip has its own list.
+    auto merge_changed = [this](int strips_amount)
+    {
+        for (int strip = 0; strip < strips_amount; ++strip)
+        {
+            for (int group : strips_changed_[strip])
             {
-                for (int y = 1; y < atmos::CELL_GROUP_SIZE - 1; ++y)
-                {
-                    if (!BelongsToStage(x, y, stage, game_tick))
-                    {
-                        continue;
-                    }
-                    Cell& current = current_group[y + x * atmos::CELL_GROUP_SIZE];
-                    ProcessInnerGroupCell(&current);
-                }
+                changed_[group] = 1;
             }
         }
-    }
+    };
+    ForEach(group_width_ - 1, [this, game_tick](int index)
+    {
+        std::vector<int>* changed = &strips_changed_[index];
+        changed->clear();
+        ProcessVerticalBorder(index + 1, game_tick, changed);
+    });
+    merge_changed(group_width_ - 1);
+    ForEach(group_height_ - 1, [this, game_tick](int index)
+    {
+        std::vector<int>* changed = &strips_changed_[index];
+        changed->clear();
+        ProcessHorizontalBorder(index + 1, game_tick, changed);
+    });
+    merge_changed(group_height_ - 1);
 }
 
-void AtmosGrid::ProcessGroupsBorders(qint32 game_tick)
+void AtmosGrid::ProcessVerticalBorder(int group_x, qint32 game_tick, std::vector<int>* changed)
 {
-    for (int group_x = 1; group_x < group_width_; ++group_x)
+    int end_x = group_x * atmos::CELL_GROUP_SIZE;
+    int start_x = end_x - 1;
+    for (int stage = 0; stage < STAGES_AMOUNT; ++stage)
     {
-        int end_x = group_x * atmos::CELL_GROUP_SIZE;
-        int start_x = end_x - 1;
-        for (int stage = 0; stage < STAGES_AMOUNT; ++stage)
+        for (int x = start_x; x <= end_x; ++x)
         {
-            for (int x = start_x; x <= end_x; ++x)
+            for (int y = 1; y < height_ - 1; ++y)
             {
-                for (int y = 1; y < height_ - 1; ++y)
+                if (!BelongsToStage(x, y, stage, game_tick))
                 {
-                    if (!BelongsToStage(x, y, stage, game_tick))
-                    {
-                        continue;
-                    }
-                    Cell& current = At(x, y);
-                    ProcessBorderGroupCell(&current, x, y);
+                    continue;
                 }
+                ProcessBorderGroupCell(x, y, changed);
             }
         }
     }
-    for (int group_y = 1; group_y < group_height_; ++group_y)
+}
+
+void AtmosGrid::ProcessHorizontalBorder(int group_y, qint32 game_tick, std::vector<int>* changed)
+{
+    int end_y = group_y * atmos::CELL_GROUP_SIZE;
+    int start_y = end_y - 1;
+    for (int stage = 0; stage < STAGES_AMOUNT; ++stage)
     {
-        int end_y = group_y * atmos::CELL_GROUP_SIZE;
-        int start_y = end_y - 1;
-        for (int stage = 0; stage < STAGES_AMOUNT; ++stage)
+        for (int y = start_y; y <= end_y; ++y)
         {
-            for (int y = start_y; y <= end_y; ++y)
+            for (int x = 1; x < width_ - 1; ++x)
             {
-                for (int x = 1; x < width_ - 1; ++x)
+                if (!BelongsToStage(x, y, stage, game_tick))
                 {
-                    if (!BelongsToStage(x, y, stage, game_tick))
-                    {
-                        continue;
-                    }
-                    Cell& current = At(x, y);
-                    ProcessBorderGroupCell(&current, x, y);
+                    continue;
                 }
+                ProcessBorderGroupCell(x, y, changed);
             }
         }
     }
 }
 
-void AtmosGrid::Finalize()
+void AtmosGrid::ProcessVertical(AtmosGrid* upper)
 {
-    for (int pos = 0; pos < length_; ++pos)
-    {
-        Cell& cell = cells_[pos];
+    kv::Assert(
+        (upper->width_ == width_) && (upper->height_ == height_),
+        "Grids of z-levels have different sizes!");
 
-        if (cell.flags & atmos::SPACE_TILE)
+    const int GROUPS_AMOUNT = group_height_ * group_width_;
+    ForEach(GROUPS_AMOUNT, [this, upper](int group)
+    {
+        if (open_up_[group] == 0)
+        {
+            return;
+        }
+        // Both cells would not change
+        if (IsSleeping(group) && upper->IsSleeping(group))
+        {
+            return;
+        }
+        const int begin = group * AMOUNT_CELLS_IN_GROUP;
+        for (int index = begin; index < begin + AMOUNT_CELLS_IN_GROUP; ++index)
         {
+            if (!IsOpenUp(cells_.flags[index]) || !IsOpenDown(upper->cells_.flags[index]))
+            {
+                continue;
+            }
+
+            AtmosData lower_data = Load(index);
+            AtmosData upper_data = upper->Load(index);
+
+            int gases_sums[GASES_NUM];
             for (int i = 0; i < GASES_NUM; ++i)
             {
-                cell.data.gases[i] *= 4;
-                cell.data.gases[i] /= 5;
+                gases_sums[i] = lower_data.gases[i] + upper_data.gases[i];
+                upper_data.gases[i] = gases_sums[i] / 2;
+                lower_data.gases[i] = gases_sums[i] - upper_data.gases[i];
             }
-            cell.data.energy *= 4;
-            cell.data.energy /= 5;
+            const int energy_sum = lower_data.energy + upper_data.energy;
+            upper_data.energy = energy_sum / 2;
+            lower_data.energy = energy_sum - upper_data.energy;
+
+            const bool fire
+                =  (lower_data.fire || upper_data.fire)
+                && gases_sums[PLASMA] && gases_sums[OXYGEN];
+            lower_data.fire = fire;
+            upper_data.fire = fire;
+
+            UpdateMacroParams(&lower_data);
+            UpdateMacroParams(&upper_data);
+
+            // Changed groups are woken up there
+            Store(index, lower_data);
+            upper->Store(index, upper_data);
         }
+    });
+}
 
-        ProccesBurning(&cell.data);
-        UpdateMacroParams(&cell.data);
-    }
+void AtmosGrid::Finalize()
+{
+    const int GROUPS_AMOUNT = group_height_ * group_width_;
+    ForEach(GROUPS_AMOUNT, [this](int index)
+    {
+        // Borders could have changed a sleeping group
+        if (IsSleeping(index) && !changed_[index])
+        {
+            return;
+        }
+        if (kernels_.finalize_group(GetGroup(index)))
+        {
+            changed_[index] = 1;
+        }
+    });
 }
 
 }
@@ -1,11 +1,19 @@
 #pragma once
 
+#include <functional>
+#include <vector>
+
 #include <QDebug>
 
 #include "AtmosConstants.h"
 #include "KvAbort.h"
 #include "Interfaces.h"
 
+namespace kv
+{
+    class WorkerPool;
+}
+
 namespace atmos
 {
     const int DIRS_SIZE = 4;
@@ -18,6 +26,9 @@ namespace atmos
     const AtmosInterface::Flags CENTER_BLOCK = 16;
     const AtmosInterface::Flags SPACE_TILE = 32;
     const AtmosInterface::Flags NO_OBJECTS = 64;
+    // Vertical sides, between z-levels
+    const AtmosInterface::Flags ZUP_BLOCK = 128;
+    const AtmosInterface::Flags ZDOWN_BLOCK = 256;
 
     const AtmosInterface::Flags DIRS[DIRS_SIZE]
         = { LEFT_BLOCK, UP_BLOCK, DOWN_BLOCK, RIGHT_BLOCK };
@@ -29,121 +40,197 @@ namespace atmos
     const Dir INDEXES_TO_DIRS[DIRS_SIZE]
         = { Dir::WEST, Dir::NORTH, Dir::SOUTH, Dir::EAST };
     const int CELL_GROUP_SIZE = 32;
+    const int AMOUNT_CELLS_IN_GROUP = CELL_GROUP_SIZE * CELL_GROUP_SIZE;
+
+    // Index shifts to the nearby cells inside a group, in the order of DIRS
+    const int NEAR_SHIFTS[DIRS_SIZE]
+        = { -CELL_GROUP_SIZE, -1, 1, CELL_GROUP_SIZE };
+
+    // Nearby cells of the cells of the same stage do not intersect
+    const int STAGES_AMOUNT = 5;
+    inline bool BelongsToStage(int x, int y, int stage, qint32 game_tick)
+    {
+        return (((x + (y * 2)) % STAGES_AMOUNT) == ((game_tick + stage) % STAGES_AMOUNT));
+    }
+
+    // Pointers to the arrays of cells values, a cell has
+    // the same index in each of the arrays
+    struct CellsData
+    {
+        int* gases[GASES_NUM];
+        int* energy;
+        int* pressure;
+        int* temperature;
+        int* volume;
+        int* fire;
+        int* flows[DIRS_SIZE];
+        int* flags;
+    };
+
+    // Nearby cells in the order of DIRS, then the center cell,
+    // absent nearby cell is -1. Returns true if any of the cells is changed.
+    bool ProcessFiveCells(const CellsData& data, const int near_cells[]);
+
+    // All the kernels give exactly the same results, so clients
+    // with different CPUs stay in sync
+    enum class SimdLevel
+    {
+        SCALAR = 0,
+        SSE4 = 1,
+        AVX2 = 2
+    };
+    SimdLevel GetSupportedSimdLevel();
+
+    // Both kernels return true if gases, energy or fire of any cell are changed
+    struct Kernels
+    {
+        // Processes inner cells of the group which 'data' points to
+        bool (*process_group)(const CellsData& data, qint32 game_tick);
+        // Space decay, burning and macro params of the group cells
+        bool (*finalize_group)(const CellsData& data);
+    };
+
+    // After that amount of ticks without changes a group stops to be processed.
+    // The processing depends only on the cells and the stage, which repeats
+    // each STAGES_AMOUNT ticks, so the sleeping group would not change anyway.
+    const int IDLE_TICKS_TO_SLEEP = STAGES_AMOUNT;
+    Kernels GetKernels(SimdLevel level);
 
     class AtmosGrid
     {
     public:
-        struct Cell
-        {
-            AtmosData data;
-
-            int flows[atmos::DIRS_SIZE];
+        AtmosGrid(int width, int height);
+        ~AtmosGrid();
 
-            AtmosInterface::Flags flags;
-            Cell()
-            {
-                for (int i = 0; i < GASES_NUM; ++i)
-                {
-                    data.gases[i] = 0;
-                }
-                for (int i = 0; i < atmos::DIRS_SIZE; ++i)
-                {
-                    flows[i] = 0;
-                }
-                flags = atmos::CLEAR;
-                data.energy = 0;
-                data.pressure = 0;
-                data.temperature = 0;
-                data.volume = 1;
-            }
-            inline char IsPassable(char dir)
-            {
-                return ~flags & dir;
-            }
-            inline void SetUnpassable(char dir)
-            {
-                flags |= dir;
-            }
-            inline void ResetPassable()
-            {
-                flags = atmos::CLEAR;
-            }
-            inline void Truncate()
-            {
-                for (int gas = 0; gas < GASES_NUM; ++gas)
-                {
-                    data.gases[gas] = 0;
-                }
-                data.energy = 0;
-            }
-        };
-        AtmosGrid(int width, int height)
-            : width_(width),
-              height_(height),
-              group_height_(height / atmos::CELL_GROUP_SIZE),
-              group_width_(width / atmos::CELL_GROUP_SIZE),
-              length_(width_ * height_)
-        {
-            if (width_ < 2)
-            {
-                kv::Abort("Width too small for AtmosGrid!");
-            }
-            if (height_ < 2)
-            {
-                kv::Abort("Height too small for AtmosGrid!");
-            }
-            if ((width_ % atmos::CELL_GROUP_SIZE) != 0)
-            {
-                kv::Abort(QString("Width is not multiplier of %1!").arg(atmos::CELL_GROUP_SIZE));
-            }
-            if ((height_ % atmos::CELL_GROUP_SIZE) != 0)
-            {
-                kv::Abort(QString("Height is not multiplier of %1!").arg(atmos::CELL_GROUP_SIZE));
-            }
-            cells_ = new Cell[length_];
-        }
-        ~AtmosGrid()
+        // Cells are stored group by group and column by column inside a group
+        inline int GetIndex(int x, int y) const
         {
-            delete[] cells_;
+            int group_x = x / atmos::CELL_GROUP_SIZE;
+            int x_in_group = x % atmos::CELL_GROUP_SIZE;
+            int group_y = y / atmos::CELL_GROUP_SIZE;
+            int y_in_group = y % atmos::CELL_GROUP_SIZE;
+            int group = (group_y + group_x * group_height_) * atmos::AMOUNT_CELLS_IN_GROUP;
+            return group + y_in_group + x_in_group * atmos::CELL_GROUP_SIZE;
         }
-        inline Cell& Get(int x, int y, Dir dir)
+        inline int GetNearIndex(int x, int y, Dir dir) const
         {
             switch (dir)
             {
             case Dir::SOUTH:
-                return At(x, y + 1);
+                return GetIndex(x, y + 1);
             case Dir::NORTH:
-                return At(x, y - 1);
+                return GetIndex(x, y - 1);
             case Dir::EAST:
-                return At(x + 1, y);
+                return GetIndex(x + 1, y);
             case Dir::WEST:
-                return At(x - 1, y);
+                return GetIndex(x - 1, y);
             }
             KV_UNREACHABLE
         }
 
-        inline Cell& At(int x, int y)
+        AtmosData Load(int index) const;
+        void Store(int index, const AtmosData& data);
+
+        inline AtmosInterface::Flags GetFlags(int index) const
         {
-            int group_x = x / atmos::CELL_GROUP_SIZE;
-            int x_in_group = x % atmos::CELL_GROUP_SIZE;
-            int group_y = y / atmos::CELL_GROUP_SIZE;
-            int y_in_group = y % atmos::CELL_GROUP_SIZE;
-            Cell* group = &(cells_[(group_y + group_x * group_height_) * atmos::CELL_GROUP_SIZE * atmos::CELL_GROUP_SIZE]);
-            return group[y_in_group + x_in_group * atmos::CELL_GROUP_SIZE];
+            return static_cast<AtmosInterface::Flags>(cells_.flags[index]);
+        }
+        void SetFlags(int index, AtmosInterface::Flags flags);
+        inline bool IsPassable(int index, AtmosInterface::Flags dir) const
+        {
+            return (~cells_.flags[index] & dir) != 0;
+        }
+        inline int& Flow(int index, int dir)
+        {
+            return cells_.flows[dir][index];
+        }
+        inline int GetPressure(int index) const
+        {
+            return cells_.pressure[index];
+        }
+        inline bool IsBurning(int index) const
+        {
+            return cells_.fire[index] != 0;
+        }
+
+        // Groups and borders strips do not share cells, so they are spread
+        // between the workers; results are the same as in the serial mode
+        void SetWorkerPool(kv::WorkerPool* workers)
+        {
+            workers_ = workers;
         }
+        // The best supported level is used by default
+        void SetSimdLevel(SimdLevel level);
+        // Groups are put to sleep by default
+        void SetSleepingEnabled(bool enabled);
         void Process(qint32 game_tick);
+
+        inline int GetGroupIndex(int index) const
+        {
+            return index / atmos::AMOUNT_CELLS_IN_GROUP;
+        }
+        inline bool IsSleeping(int group) const
+        {
+            return sleeping_enabled_ && (idle_ticks_[group] >= IDLE_TICKS_TO_SLEEP);
+        }
+        // Sleeping group without cells which can be pushed by the pressure
+        // difference through a blocked side, nothing happens there at all
+        inline bool IsIdle(int group) const
+        {
+            return IsSleeping(group) && (blocked_sides_[group] == 0);
+        }
+        int GetActiveGroupsAmount() const;
+
+        // Hashes of sleeping groups are cached
+        unsigned int Hash();
+
+        // Mixes cells with the same cells of the grid of the z-level above
+        // if the air can pass between them. Both grids should have the same size.
+        void ProcessVertical(AtmosGrid* upper);
     private:
         void ProcessGroups(qint32 game_tick);
         void ProcessGroupsBorders(qint32 game_tick);
         void Finalize();
 
-        void ProcessBorderGroupCell(Cell* current, int x, int y);
+        void UpdateSleeping();
+        void WakeUp(int index);
+
+        unsigned int HashGroup(int group) const;
+
+        void ProcessVerticalBorder(int group_x, qint32 game_tick, std::vector<int>* changed);
+        void ProcessHorizontalBorder(int group_y, qint32 game_tick, std::vector<int>* changed);
+
+        void ForEach(int size, const std::function<void(int)>& function);
+
+        void ProcessBorderGroupCell(int x, int y, std::vector<int>* changed);
+
+        CellsData GetGroup(int index) const;
 
         int width_;
         int height_;
         int group_height_;
         int group_width_;
         int length_;
-        Cell* cells_;
+
+        std::vector<int> storage_;
+        CellsData cells_;
+
+        Kernels kernels_;
+
+        bool sleeping_enabled_;
+        // Amount of ticks in a row without changes, per group
+        std::vector<int> idle_ticks_;
+        std::vector<char> changed_;
+        // Changed groups found by each of the borders strips
+        std::vector<std::vector<int>> strips_changed_;
+        // Amount of passable cells with a blocked side, per group
+        std::vector<int> blocked_sides_;
+        // Amount of passable cells which are open to the z-level above, per group
+        std::vector<int> open_up_;
+
+        std::vector<unsigned int> groups_hashes_;
+        std::vector<char> groups_hashes_valid_;
+
+        kv::WorkerPool* workers_;
     };
 }
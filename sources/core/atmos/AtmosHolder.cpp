@@ -38,22 +38,25 @@ namespace atmos
             div = 0;
         }
 
+        AtmosData owner = Load();
+        AtmosData visitor = guest->Load();
+
         for (quint32 i = 0; i < GASES_NUM; ++i)
         {
-            int gase_owner = (data_ptr_->gases[i] * level_owner) / MAX_GAS_LEVEL;
-            data_ptr_->gases[i] -= gase_owner;
+            int gase_owner = (owner.gases[i] * level_owner) / MAX_GAS_LEVEL;
+            owner.gases[i] -= gase_owner;
 
-            int gase_guest = (guest->data_ptr_->gases[i] * level_guest) / MAX_GAS_LEVEL;
-            guest->data_ptr_->gases[i] -= gase_guest;
+            int gase_guest = (visitor.gases[i] * level_guest) / MAX_GAS_LEVEL;
+            visitor.gases[i] -= gase_guest;
 
             loc_gases[i] = gase_owner + gase_guest;
         }
 
-        int energy_owner = (data_ptr_->energy * level_owner) / MAX_GAS_LEVEL;
-        data_ptr_->energy -= energy_owner;
+        int energy_owner = (owner.energy * level_owner) / MAX_GAS_LEVEL;
+        owner.energy -= energy_owner;
 
-        int energy_guest = (guest->data_ptr_->energy * level_guest) / MAX_GAS_LEVEL;
-        guest->data_ptr_->energy -= energy_guest;
+        int energy_guest = (visitor.energy * level_guest) / MAX_GAS_LEVEL;
+        visitor.energy -= energy_guest;
 
         loc_energy = energy_owner + energy_guest;
 
@@ -62,94 +65,112 @@ namespace atmos
             int gase_owner = (loc_gases[i] * div) / MAX_GAS_LEVEL;
             int gase_guest = loc_gases[i] - gase_owner;
 
-            data_ptr_->gases[i] += gase_owner;
-            guest->data_ptr_->gases[i] += gase_guest;
+            owner.gases[i] += gase_owner;
+            visitor.gases[i] += gase_guest;
         }
 
         energy_owner = (loc_energy * div) / MAX_GAS_LEVEL;
         energy_guest = loc_energy - energy_owner;
 
-        data_ptr_->energy += energy_owner;
-        guest->data_ptr_->energy += energy_guest;
+        owner.energy += energy_owner;
+        visitor.energy += energy_guest;
+
+        atmos::UpdateMacroParams(&owner);
+        atmos::UpdateMacroParams(&visitor);
 
-        UpdateMacroParams();
-        guest->UpdateMacroParams();
+        Store(owner);
+        guest->Store(visitor);
     }
 
     void AtmosHolder::UpdateMacroParams()
     {
-        atmos::UpdateMacroParams(data_ptr_);
+        AtmosData data = Load();
+        atmos::UpdateMacroParams(&data);
+        Store(data);
     }
 
     void AtmosHolder::SetVolume(int volume)
     {
-        data_ptr_->volume = volume;
-        UpdateMacroParams();
+        AtmosData data = Load();
+        data.volume = volume;
+        atmos::UpdateMacroParams(&data);
+        Store(data);
     }
 
     void AtmosHolder::AddGase(int gase, int amount)
     {
-        data_ptr_->gases[gase] += amount;
-        UpdateMacroParams();
+        AtmosData data = Load();
+        data.gases[gase] += amount;
+        atmos::UpdateMacroParams(&data);
+        Store(data);
     }
 
     void AtmosHolder::AddEnergy(int energy)
     {
-        data_ptr_->energy += energy;
-        UpdateMacroParams();
+        AtmosData data = Load();
+        data.energy += energy;
+        atmos::UpdateMacroParams(&data);
+        Store(data);
     }
 
     int AtmosHolder::GetEnergy() const
     {
-        return data_ptr_->energy;
+        return Load().energy;
     }
     int AtmosHolder::GetPressure() const
     {
-        return data_ptr_->pressure;
+        return Load().pressure;
     }
     int AtmosHolder::GetTemperature() const
     {
-        return data_ptr_->temperature;
+        return Load().temperature;
     }
     int AtmosHolder::GetVolume() const
     {
-        return data_ptr_->volume;
+        return Load().volume;
     }
 
     int AtmosHolder::GetGase(int gase) const
     {
-        return data_ptr_->gases[gase];
+        return Load().gases[gase];
     }
 
     int AtmosHolder::RemoveGase(int gase, int amount)
     {
+        AtmosData data = Load();
         int retval = amount;
-        if (static_cast<int>(amount) > data_ptr_->gases[gase])
+        if (static_cast<int>(amount) > data.gases[gase])
+        {
+            retval = data.gases[gase];
+            data.gases[gase] = 0;
+        }
+        else
         {
-            retval = data_ptr_->gases[gase];
-            data_ptr_->gases[gase] = 0;
-            UpdateMacroParams();
-            return retval;
+            data.gases[gase] -= static_cast<int>(amount);
         }
-        data_ptr_->gases[gase] -= static_cast<int>(amount);
-        UpdateMacroParams();
+        atmos::UpdateMacroParams(&data);
+        Store(data);
         return retval;
     }
 
     void AtmosHolder::Truncate()
     {
+        AtmosData data = Load();
         for (quint32 i = 0; i < GASES_NUM; ++i)
         {
-            data_ptr_->gases[i] = 0;
+            data.gases[i] = 0;
         }
-        data_ptr_->energy = 0;
+        data.energy = 0;
 
-        UpdateMacroParams();
+        atmos::UpdateMacroParams(&data);
+        Store(data);
     }
 
     void AtmosHolder::Ignite()
     {
-        data_ptr_->fire = true;
+        AtmosData data = Load();
+        data.fire = true;
+        Store(data);
     }
 
     void AddDefaultValues(AtmosHolder *holder)
@@ -162,31 +183,34 @@ namespace atmos
 
     kv::FastSerializer& operator<<(kv::FastSerializer& file, const atmos::AtmosHolder& atmos_holder)
     {
+        const AtmosData data = atmos_holder.Load();
         for (quint32 i = 0; i < atmos::GASES_NUM; ++i)
         {
-            file << atmos_holder.data_ptr_->gases[i];
+            file << data.gases[i];
         }
-        file << atmos_holder.data_ptr_->energy;
-        file << atmos_holder.data_ptr_->pressure;
-        const qint32 volume = atmos_holder.data_ptr_->volume;
+        file << data.energy;
+        file << data.pressure;
+        const qint32 volume = data.volume;
         file << volume;
-        file << atmos_holder.data_ptr_->temperature;
+        file << data.temperature;
 
         return file;
     }
 
     kv::FastDeserializer& operator>>(kv::FastDeserializer& file, atmos::AtmosHolder& atmos_holder)
     {
+        AtmosData data = atmos_holder.Load();
         for (quint32 i = 0; i < atmos::GASES_NUM; ++i)
         {
-            file >> atmos_holder.data_ptr_->gases[i];
+            file >> data.gases[i];
         }
-        file >> atmos_holder.data_ptr_->energy;
-        file >> atmos_holder.data_ptr_->pressure;
+        file >> data.energy;
+        file >> data.pressure;
         qint32 volume;
         file >> volume;
-        atmos_holder.data_ptr_->volume = static_cast<qint16>(volume);
-        file >> atmos_holder.data_ptr_->temperature;
+        data.volume = static_cast<qint16>(volume);
+        file >> data.temperature;
+        atmos_holder.Store(data);
 
         return file;
     }
@@ -35,7 +35,8 @@ namespace atmos
             data_.temperature = 0;
             data_.volume = 1;
             data_.fire = false;
-            data_ptr_ = &data_;
+            grid_ = nullptr;
+            index_ = 0;
         }
         void Connect(AtmosHolder* guest,
                      int level_owner = MAX_GAS_LEVEL, int level_guest = MAX_GAS_LEVEL,
@@ -54,32 +55,61 @@ namespace atmos
         void Truncate();
 
         void Ignite();
-        bool IsBurning() const { return data_ptr_->fire; }
+        bool IsBurning() const { return Load().fire; }
 
         void UpdateMacroParams();
-        void SetAtmosData(AtmosData* data)
+        // The current values are moved to the cell, and after that
+        // the holder works directly with the cell
+        void BindToGrid(AtmosGrid* grid, int index)
         {
-            data_ptr_ = data;
+            grid->Store(index, data_);
+            grid_ = grid;
+            index_ = index;
         }
     private:
-        AtmosData* data_ptr_;
+        AtmosData Load() const
+        {
+            if (grid_)
+            {
+                return grid_->Load(index_);
+            }
+            return data_;
+        }
+        void Store(const AtmosData& data)
+        {
+            if (grid_)
+            {
+                grid_->Store(index_, data);
+                return;
+            }
+            data_ = data;
+        }
+
         AtmosData data_;
+        AtmosGrid* grid_;
+        int index_;
     };
 
     void AddDefaultValues(atmos::AtmosHolder* holder);
 
     inline unsigned int Hash(const atmos::AtmosHolder& atmos_holder)
     {
+        // The whole grid is hashed by Atmosphere
+        if (atmos_holder.grid_)
+        {
+            return 0;
+        }
+        const AtmosData data = atmos_holder.data_;
         unsigned int retval = 0;
         for (quint32 i = 0; i < atmos::GASES_NUM; ++i)
         {
-            retval += atmos_holder.data_ptr_->gases[i];
+            retval += data.gases[i];
         }
-        retval += atmos_holder.data_ptr_->energy;
-        retval += atmos_holder.data_ptr_->pressure;
-        retval += atmos_holder.data_ptr_->volume;
-        retval += atmos_holder.data_ptr_->temperature;
-        retval += atmos_holder.data_ptr_->fire;
+        retval += data.energy;
+        retval += data.pressure;
+        retval += data.volume;
+        retval += data.temperature;
+        retval += data.fire;
         return retval;
     }
 
@@ -0,0 +1,464 @@
+#include "AtmosGrid.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define KV_ATMOS_X86_SIMD
+#include <immintrin.h>
+#endif
+
+namespace atmos
+{
+
+bool ProcessFiveCells(const CellsData& data, const int near_cells[])
+{
+    int near_size = 0;
+    int gases_sums[GASES_NUM];
+    for (int i = 0; i < GASES_NUM; ++i)
+    {
+        gases_sums[i] = 0;
+    }
+    int energy_sum = 0;
+
+    bool fire = false;
+
+    for (int dir = 0; dir < atmos::DIRS_SIZE + 1; ++dir)
+    {
+        const int nearby = near_cells[dir];
+        if (nearby < 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < GASES_NUM; ++i)
+        {
+            gases_sums[i] += data.gases[i][nearby];
+        }
+        energy_sum += data.energy[nearby];
+        fire = fire || data.fire[nearby];
+        ++near_size;
+    }
+
+    fire = fire && gases_sums[PLASMA] && gases_sums[OXYGEN];
+    const int fire_value = fire ? 1 : 0;
+
+    int gases_average[GASES_NUM];
+    int gases_remains[GASES_NUM];
+    for (int i = 0; i < GASES_NUM; ++i)
+    {
+        gases_average[i] = gases_sums[i] / near_size;
+        gases_remains[i] = gases_sums[i] % near_size;
+    }
+    int energy_average = energy_sum / near_size;
+    int energy_remains = energy_sum % near_size;
+
+    const int center = near_cells[atmos::DIRS_SIZE];
+
+    bool changed = false;
+    for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
+    {
+        const int nearby = near_cells[dir];
+        if (nearby < 0)
+        {
+            continue;
+        }
+        for (int i = 0; i < GASES_NUM; ++i)
+        {
+            int diff = gases_average[i] - data.gases[i][nearby];
+            data.flows[atmos::REVERT_DIRS_INDEXES[dir]][nearby] += diff;
+            data.flows[dir][center] -= diff;
+            data.gases[i][nearby] = gases_average[i];
+            changed = changed || (diff != 0);
+        }
+        changed = changed || (data.energy[nearby] != energy_average);
+        changed = changed || (data.fire[nearby] != fire_value);
+        data.energy[nearby] = energy_average;
+        data.fire[nearby] = fire_value;
+    }
+
+    for (int i = 0; i < GASES_NUM; ++i)
+    {
+        const int value = gases_average[i] + gases_remains[i];
+        changed = changed || (data.gases[i][center] != value);
+        data.gases[i][center] = value;
+    }
+    const int energy = energy_average + energy_remains;
+    changed = changed || (data.energy[center] != energy);
+    changed = changed || (data.fire[center] != fire_value);
+    data.energy[center] = energy;
+    data.fire[center] = fire_value;
+
+    return changed;
+}
+
+namespace
+{
+    inline bool IsPassable(const CellsData& data, int index, AtmosInterface::Flags dir)
+    {
+        return (~data.flags[index] & dir) != 0;
+    }
+
+    inline bool ProcessInnerGroupCell(const CellsData& data, int index)
+    {
+        if (!IsPassable(data, index, atmos::CENTER_BLOCK))
+        {
+            return false;
+        }
+
+        int near_cells[atmos::DIRS_SIZE + 1];
+
+        for (int dir = 0; dir < atmos::DIRS_SIZE; ++dir)
+        {
+            if (IsPassable(data, index, atmos::DIRS[dir]))
+            {
+                const int nearby = index + atmos::NEAR_SHIFTS[dir];
+                if (   IsPassable(data, nearby, atmos::REVERT_DIRS[dir])
+                    && IsPassable(data, nearby, atmos::CENTER_BLOCK))
+                {
+                    near_cells[dir] = nearby;
+                    continue;
+                }
+            }
+            near_cells[dir] = -1;
+        }
+        near_cells[atmos::DIRS_SIZE] = index;
+
+        return ProcessFiveCells(data, near_cells);
+    }
+
+    // Cells of one stage are scattered over the group, and each of them
+    // depends on the results of the previous stage, so the diffusion
+    // is shared by all the kernels
+    bool ProcessGroup(const CellsData& data, qint32 game_tick)
+    {
+        bool changed = false;
+        for (int stage = 0; stage < STAGES_AMOUNT; ++stage)
+        {
+            for (int x = 1; x < atmos::CELL_GROUP_SIZE - 1; ++x)
+            {
+                for (int y = 1; y < atmos::CELL_GROUP_SIZE - 1; ++y)
+                {
+                    if (!BelongsToStage(x, y, stage, game_tick))
+                    {
+                        continue;
+                    }
+                    if (ProcessInnerGroupCell(data, y + x * atmos::CELL_GROUP_SIZE))
+                    {
+                        changed = true;
+                    }
+                }
+            }
+        }
+        return changed;
+    }
+
+    AtmosData LoadCell(const CellsData& data, int index)
+    {
+        AtmosData retval;
+        for (int i = 0; i < GASES_NUM; ++i)
+        {
+            retval.gases[i] = data.gases[i][index];
+        }
+        retval.energy = data.energy[index];
+        retval.pressure = data.pressure[index];
+        retval.volume = static_cast<qint16>(data.volume[index]);
+        retval.temperature = data.temperature[index];
+        retval.fire = data.fire[index] != 0;
+        return retval;
+    }
+
+    void StoreCell(const CellsData& data, int index, const AtmosData& cell)
+    {
+        for (int i = 0; i < GASES_NUM; ++i)
+        {
+            data.gases[i][index] = cell.gases[i];
+        }
+        data.energy[index] = cell.energy;
+        data.pressure[index] = cell.pressure;
+        data.temperature[index] = cell.temperature;
+        data.fire[index] = cell.fire ? 1 : 0;
+    }
+
+    bool IsChanged(const AtmosData& before, const AtmosData& after)
+    {
+        for (int i = 0; i < GASES_NUM; ++i)
+        {
+            if (before.gases[i] != after.gases[i])
+            {
+                return true;
+            }
+        }
+        return (before.energy != after.energy) || (before.fire != after.fire);
+    }
+
+    bool FinalizeGroupScalar(const CellsData& data)
+    {
+        bool changed = false;
+        for (int pos = 0; pos < AMOUNT_CELLS_IN_GROUP; ++pos)
+        {
+            const AtmosData before = LoadCell(data, pos);
+            AtmosData cell = before;
+
+            if (data.flags[pos] & atmos::SPACE_TILE)
+            {
+                for (int i = 0; i < GASES_NUM; ++i)
+                {
+                    cell.gases[i] *= 4;
+                    cell.gases[i] /= 5;
+                }
+                cell.energy *= 4;
+                cell.energy /= 5;
+            }
+
+            ProccesBurning(&cell);
+            UpdateMacroParams(&cell);
+
+            changed = changed || IsChanged(before, cell);
+            StoreCell(data, pos, cell);
+        }
+        return changed;
+    }
+
+    // Only burning cells are touched, the vector kernels do it between
+    // the space decay and the macro params update. A burning cell always
+    // changes: it either burns something or stops to burn.
+    bool ProcessGroupBurning(const CellsData& data)
+    {
+        bool changed = false;
+        for (int pos = 0; pos < AMOUNT_CELLS_IN_GROUP; ++pos)
+        {
+            if (!data.fire[pos])
+            {
+                continue;
+            }
+            AtmosData cell = LoadCell(data, pos);
+            ProccesBurning(&cell);
+            StoreCell(data, pos, cell);
+            changed = true;
+        }
+        return changed;
+    }
+
+#ifdef KV_ATMOS_X86_SIMD
+    // Integer division is done through doubles: an int32 quotient
+    // is exact there, so the results are the same as in the scalar code
+
+    __attribute__((target("sse4.1")))
+    __m128i DivideSse4(__m128i dividend, __m128i divisor)
+    {
+        const __m128d low = _mm_div_pd(
+            _mm_cvtepi32_pd(dividend), _mm_cvtepi32_pd(divisor));
+        const __m128d high = _mm_div_pd(
+            _mm_cvtepi32_pd(_mm_unpackhi_epi64(dividend, dividend)),
+            _mm_cvtepi32_pd(_mm_unpackhi_epi64(divisor, divisor)));
+        return _mm_unpacklo_epi64(_mm_cvttpd_epi32(low), _mm_cvttpd_epi32(high));
+    }
+
+    // Same as 'value / 2' for negative values too
+    __attribute__((target("sse4.1")))
+    __m128i HalveSse4(__m128i value)
+    {
+        return _mm_srai_epi32(_mm_add_epi32(value, _mm_srli_epi32(value, 31)), 1);
+    }
+
+    __attribute__((target("sse4.1")))
+    bool FinalizeGroupSse4(const CellsData& data)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i one = _mm_set1_epi32(1);
+        const __m128i four = _mm_set1_epi32(4);
+        const __m128i five = _mm_set1_epi32(5);
+        const __m128i space_tile = _mm_set1_epi32(atmos::SPACE_TILE);
+        const __m128i energy_const = _mm_set1_epi32(ENERGY_CONST);
+
+        __m128i decayed_mask = zero;
+        const int STEP = 4;
+        for (int pos = 0; pos < AMOUNT_CELLS_IN_GROUP; pos += STEP)
+        {
+            const __m128i flags
+                = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.flags + pos));
+            const __m128i is_space
+                = _mm_cmpeq_epi32(_mm_and_si128(flags, space_tile), space_tile);
+            if (_mm_testz_si128(is_space, is_space))
+            {
+                continue;
+            }
+            for (int i = 0; i < GASES_NUM + 1; ++i)
+            {
+                int* field = (i < GASES_NUM) ? data.gases[i] : data.energy;
+                __m128i* address = reinterpret_cast<__m128i*>(field + pos);
+                const __m128i value = _mm_loadu_si128(address);
+                const __m128i decayed = DivideSse4(_mm_mullo_epi32(value, four), five);
+                const __m128i result = _mm_blendv_epi8(value, decayed, is_space);
+                decayed_mask = _mm_or_si128(decayed_mask, _mm_xor_si128(value, result));
+                _mm_storeu_si128(address, result);
+            }
+        }
+
+        const bool burned = ProcessGroupBurning(data);
+
+        for (int pos = 0; pos < AMOUNT_CELLS_IN_GROUP; pos += STEP)
+        {
+            __m128i moles = zero;
+            __m128i freedom_sum = zero;
+            for (int i = 0; i < GASES_NUM; ++i)
+            {
+                const __m128i gas
+                    = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.gases[i] + pos));
+                moles = _mm_add_epi32(moles, gas);
+                freedom_sum = _mm_add_epi32(
+                    freedom_sum, _mm_mullo_epi32(gas, _mm_set1_epi32(GASES_FREEDOM[i])));
+            }
+            freedom_sum = HalveSse4(freedom_sum);
+
+            const __m128i energy
+                = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.energy + pos));
+            const __m128i no_freedom = _mm_cmpeq_epi32(freedom_sum, zero);
+            __m128i temperature = DivideSse4(
+                _mm_mullo_epi32(energy, energy_const),
+                _mm_blendv_epi8(freedom_sum, one, no_freedom));
+            temperature = _mm_andnot_si128(no_freedom, temperature);
+
+            const __m128i volume
+                = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.volume + pos));
+            const __m128i no_volume = _mm_cmpeq_epi32(volume, zero);
+            __m128i pressure = DivideSse4(
+                _mm_mullo_epi32(moles, temperature),
+                _mm_blendv_epi8(volume, one, no_volume));
+            pressure = _mm_andnot_si128(no_volume, pressure);
+
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data.temperature + pos), temperature);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(data.pressure + pos), pressure);
+        }
+        return burned || !_mm_testz_si128(decayed_mask, decayed_mask);
+    }
+
+    __attribute__((target("avx2")))
+    __m256i DivideAvx2(__m256i dividend, __m256i divisor)
+    {
+        const __m256d low = _mm256_div_pd(
+            _mm256_cvtepi32_pd(_mm256_castsi256_si128(dividend)),
+            _mm256_cvtepi32_pd(_mm256_castsi256_si128(divisor)));
+        const __m256d high = _mm256_div_pd(
+            _mm256_cvtepi32_pd(_mm256_extracti128_si256(dividend, 1)),
+            _mm256_cvtepi32_pd(_mm256_extracti128_si256(divisor, 1)));
+        return _mm256_inserti128_si256(
+            _mm256_castsi128_si256(_mm256_cvttpd_epi32(low)), _mm256_cvttpd_epi32(high), 1);
+    }
+
+    __attribute__((target("avx2")))
+    __m256i HalveAvx2(__m256i value)
+    {
+        return _mm256_srai_epi32(_mm256_add_epi32(value, _mm256_srli_epi32(value, 31)), 1);
+    }
+
+    __attribute__((target("avx2")))
+    bool FinalizeGroupAvx2(const CellsData& data)
+    {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i one = _mm256_set1_epi32(1);
+        const __m256i four = _mm256_set1_epi32(4);
+        const __m256i five = _mm256_set1_epi32(5);
+        const __m256i space_tile = _mm256_set1_epi32(atmos::SPACE_TILE);
+        const __m256i energy_const = _mm256_set1_epi32(ENERGY_CONST);
+
+        __m256i decayed_mask = zero;
+        const int STEP = 8;
+        for (int pos = 0; pos < AMOUNT_CELLS_IN_GROUP; pos += STEP)
+        {
+            const __m256i flags
+                = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data.flags + pos));
+            const __m256i is_space
+                = _mm256_cmpeq_epi32(_mm256_and_si256(flags, space_tile), space_tile);
+            if (_mm256_testz_si256(is_space, is_space))
+            {
+                continue;
+            }
+            for (int i = 0; i < GASES_NUM + 1; ++i)
+            {
+                int* field = (i < GASES_NUM) ? data.gases[i] : data.energy;
+                __m256i* address = reinterpret_cast<__m256i*>(field + pos);
+                const __m256i value = _mm256_loadu_si256(address);
+                const __m256i decayed = DivideAvx2(_mm256_mullo_epi32(value, four), five);
+                const __m256i result = _mm256_blendv_epi8(value, decayed, is_space);
+                decayed_mask = _mm256_or_si256(decayed_mask, _mm256_xor_si256(value, result));
+                _mm256_storeu_si256(address, result);
+            }
+        }
+
+        const bool burned = ProcessGroupBurning(data);
+
+        for (int pos = 0; pos < AMOUNT_CELLS_IN_GROUP; pos += STEP)
+        {
+            __m256i moles = zero;
+            __m256i freedom_sum = zero;
+            for (int i = 0; i < GASES_NUM; ++i)
+            {
+                const __m256i gas
+                    = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data.gases[i] + pos));
+                moles = _mm256_add_epi32(moles, gas);
+                freedom_sum = _mm256_add_epi32(
+                    freedom_sum, _mm256_mullo_epi32(gas, _mm256_set1_epi32(GASES_FREEDOM[i])));
+            }
+            freedom_sum = HalveAvx2(freedom_sum);
+
+            const __m256i energy
+                = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data.energy + pos));
+            const __m256i no_freedom = _mm256_cmpeq_epi32(freedom_sum, zero);
+            __m256i temperature = DivideAvx2(
+                _mm256_mullo_epi32(energy, energy_const),
+                _mm256_blendv_epi8(freedom_sum, one, no_freedom));
+            temperature = _mm256_andnot_si256(no_freedom, temperature);
+
+            const __m256i volume
+                = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data.volume + pos));
+            const __m256i no_volume = _mm256_cmpeq_epi32(volume, zero);
+            __m256i pressure = DivideAvx2(
+                _mm256_mullo_epi32(moles, temperature),
+                _mm256_blendv_epi8(volume, one, no_volume));
+            pressure = _mm256_andnot_si256(no_volume, pressure);
+
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(data.temperature + pos), temperature);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(data.pressure + pos), pressure);
+        }
+        return burned || !_mm256_testz_si256(decayed_mask, decayed_mask);
+    }
+#endif // KV_ATMOS_X86_SIMD
+}
+
+SimdLevel GetSupportedSimdLevel()
+{
+#ifdef KV_ATMOS_X86_SIMD
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse4.1"))
+    {
+        return SimdLevel::SSE4;
+    }
+#endif // KV_ATMOS_X86_SIMD
+    return SimdLevel::SCALAR;
+}
+
+Kernels GetKernels(SimdLevel level)
+{
+    Kernels retval;
+    retval.process_group = &ProcessGroup;
+    retval.finalize_group = &FinalizeGroupScalar;
+#ifdef KV_ATMOS_X86_SIMD
+    switch (level)
+    {
+    case SimdLevel::SCALAR:
+        break;
+    case SimdLevel::SSE4:
+        retval.finalize_group = &FinalizeGroupSse4;
+        break;
+    case SimdLevel::AVX2:
+        retval.finalize_group = &FinalizeGroupAvx2;
+        break;
+    }
+#else
+    Q_UNUSED(level);
+#endif // KV_ATMOS_X86_SIMD
+    return retval;
+}
+
+}
@@ -13,7 +13,7 @@ void Lobby::AfterWorldCreation()
     SetFreq(10);
 }
 
-int Lobby::GetSecondUntilStart()
+int Lobby::GetSecondUntilStart() const
 {
     return seconds_;
 }
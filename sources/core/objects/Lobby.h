@@ -15,7 +15,7 @@ public:
     Lobby();
     virtual void AfterWorldCreation() override;
 
-    int GetSecondUntilStart();
+    int GetSecondUntilStart() const;
     virtual void Process() override;
 
     void AddSpawnPoint(IdPtr<SpawnPoint> Position);
@@ -24,7 +24,7 @@ void kv::PerformAttack(IdPtr<MapObject> target, IdPtr<Item> item)
 
 IdPtr<Turf> MapObject::GetTurf() const
 {
-    auto owner = GetOwner();
+    const auto owner = GetOwner();
     if (owner.IsValid())
     {
         return owner->GetTurf();
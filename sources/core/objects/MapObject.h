@@ -149,7 +149,7 @@ public:
     {
         return owner_->GetPosition();
     }
-    virtual void Represent(GrowingFrame* frame, IdPtr<kv::Mob> mob) const
+    virtual void Represent(GrowingFrame* frame, const IdPtr<kv::Mob>& mob) const
     {
         Q_UNUSED(frame)
         Q_UNUSED(mob)
@@ -17,7 +17,7 @@ void MaterialObject::SetState(const QString& name)
     GetView().SetState(name);
 }
 
-void MaterialObject::Represent(GrowingFrame* frame, IdPtr<Mob> mob) const
+void MaterialObject::Represent(GrowingFrame* frame, const IdPtr<Mob>& mob) const
 { 
     FrameData::Entity ent;
     ent.id = GetId();
@@ -30,6 +30,16 @@ void MaterialObject::Represent(GrowingFrame* frame, IdPtr<Mob> mob) const
     frame->Append(ent);
 }
 
+void MaterialObject::SetTransparency(bool transparent)
+{
+    transparent_ = transparent;
+    // Objects are not placed anywhere during construction
+    if (IdPtr<CubeTile> tile = GetOwner())
+    {
+        tile->UpdateOpacity();
+    }
+}
+
 void MaterialObject::Delete()
 {
     MapObject::Delete();
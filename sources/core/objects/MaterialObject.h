@@ -65,14 +65,14 @@ public:
         }
     }
 
-    void SetTransparency(bool transparent) { transparent_ = transparent; }
+    void SetTransparency(bool transparent);
     virtual bool Istransparent() const override
     {
         return transparent_;
     }
     
     virtual void Delete() override;
-    virtual void Represent(GrowingFrame* frame, IdPtr<kv::Mob> mob) const override;
+    virtual void Represent(GrowingFrame* frame, const IdPtr<kv::Mob>& mob) const override;
 
     int GetVisibleLevel() const { return v_level_; }
     void SetVisibleLevel(int v_level) { v_level_ = v_level; }
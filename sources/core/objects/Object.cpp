@@ -6,9 +6,20 @@
 #include "SynchronizedRandom.h"
 #include "objects/mobs/Mob.h"
 #include "ChatFrameInfo.h"
+#include "ObjectsPool.h"
 
 using namespace kv;
 
+void* Object::operator new(std::size_t size)
+{
+    return kv::internal::AllocateObject(size);
+}
+
+void Object::operator delete(void* pointer, std::size_t size)
+{
+    kv::internal::DeallocateObject(pointer, size);
+}
+
 void Object::PlayMusic(const QString& name, int volume)
 {
     quint32 net_id = GetGame().GetNetId(GetId());
@@ -26,12 +37,22 @@ void Object::Delete()
 
 void Object::Save(FastSerializer& serializer)
 {
-    serializer.WriteType(GetType());
+    serializer.WriteTypeIndex(GetTypeIndex());
+    _Z_KV_SaveOwn(serializer);
+}
+
+void Object::Load(FastDeserializer& deserializer)
+{
+    _Z_KV_LoadOwn(deserializer);
+}
+
+void Object::_Z_KV_SaveOwn(FastSerializer& serializer)
+{
     serializer << id_;
     serializer << how_often_;
 }
 
-void Object::Load(FastDeserializer& deserializer)
+void Object::_Z_KV_LoadOwn(FastDeserializer& deserializer)
 {
     // It is mainly empty because all data is loaded by
     // the outer function
@@ -45,11 +66,16 @@ void Object::SetFreq(int freq)
 {
     kv::Assert(game_, "SetFreq is called in constructor");
 
+    const int old_freq = how_often_;
     how_often_ = freq;
     if (how_often_ != 0)
     {
         GetGame().GetProcessor().Add(GetId());
     }
+    else if (old_freq != 0)
+    {
+        GetGame().GetProcessor().Remove(GetId());
+    }
 }
 
 const GameInterface& Object::GetGame() const
@@ -92,7 +118,8 @@ void Object::PostVisible(const QString& html, const Position& place)
 
 qint32 Object::GetGameTick() const
 {
-    return GetGame().GetGlobals()->game_tick;
+    const IdPtr<GlobalObjectsHolder> globals = GetGame().GetGlobals();
+    return globals->game_tick;
 }
 
 quint32 Object::CreateImpl(const QString& type, quint32 owner)
@@ -42,12 +42,25 @@ public:
 
     virtual ~Object() { }
 
+    // Objects live in the slab pools from ObjectsPool.h
+    static void* operator new(std::size_t size);
+    static void operator delete(void* pointer, std::size_t size);
+
     void PlayMusic(const QString& name, int volume = 100);
 
     virtual void Save(FastSerializer& serializer);
     virtual void Load(FastDeserializer& deserializer);
 
     virtual unsigned int HashMembers()
+    {
+        return _Z_KV_HashOwn();
+    }
+
+    // Members of the class itself without the base classes,
+    // the generated per-type functions call them without virtual dispatch
+    void _Z_KV_SaveOwn(FastSerializer& serializer);
+    void _Z_KV_LoadOwn(FastDeserializer& deserializer);
+    unsigned int _Z_KV_HashOwn()
     {
         unsigned int retval = 0;
         retval += Hash(GetId());
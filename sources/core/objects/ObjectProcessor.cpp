@@ -1,55 +1,217 @@
 #include "ObjectProcessor.h"
 
+#include <algorithm>
+#include <limits>
+#include <tuple>
+
+#include "AutogenMetadata.h"
+
 using namespace kv;
 
+namespace
+{
+
+// Objects are processed on ticks divisible by their frequency,
+// returns the first such tick after the given one
+qint32 GetNextDueTick(qint32 game_tick, int freq)
+{
+    return (game_tick / freq + 1) * freq;
+}
+
+int GetSlot(qint32 tick)
+{
+    return tick % ObjectProcessor::WHEEL_SIZE;
+}
+
+// Position of the type in GetTypesNameOrder, id and type index
+using LaneEntry = std::tuple<int, quint32, int>;
+
+}
+
 ObjectProcessor::ObjectProcessor()
+    : processed_tick_(std::numeric_limits<qint32>::max())
 {
-    // Nothing
+    wheel_.resize(WHEEL_SIZE);
 }
 
 void ObjectProcessor::Add(quint32 object)
 {
-    const auto it = objects_lookup_.find(object);
-    if (it != objects_lookup_.end())
+    const IdPtr<Object> ptr = object;
+    if (!ptr.IsValid() || ptr->GetFreq() == 0)
     {
         return;
     }
+    // The current tick is due too if it is not processed yet
+    const qint32 game_tick = GetGameTick();
+    const qint32 after_tick = (processed_tick_ >= game_tick) ? game_tick : game_tick - 1;
+    Schedule(object, GetNextDueTick(after_tick, ptr->GetFreq()));
+}
 
-    objects_lookup_.insert(object);
-    objects_.append(object);
+void ObjectProcessor::Remove(quint32 object)
+{
+    Unschedule(object);
 }
 
 void ObjectProcessor::RunProcess()
 {
     const qint32 current_game_tick = GetGameTick();
+    // Objects added during the processing wait for the next due tick
+    processed_tick_ = current_game_tick;
+    QVector<Entry>& slot = wheel_[GetSlot(current_game_tick)];
 
-    int end = objects_.size();
-    for (int i = 0; i < end; ++i)
+    // Take the due objects out of the slot, objects from the later rounds
+    // stay there in the same order
+    QVector<quint32> due_objects;
+    int kept = 0;
+    for (int i = 0; i < slot.size(); ++i)
     {
-        auto object = objects_[i];
+        const Entry entry = slot[i];
+        if (entry.second > current_game_tick)
+        {
+            slot[kept] = entry;
+            positions_[entry.first].index = kept;
+            ++kept;
+            continue;
+        }
+        due_objects.append(entry.first);
+        positions_[entry.first].slot = IN_PROCESS;
+    }
+    slot.resize(kept);
 
-        if (   !object.IsValid()
-            || (object->GetFreq() == 0))
+    // Lanes of the same type objects, types (by name) and ids inside each lane
+    // are sorted, so the order is the same on all clients
+    const std::vector<int>& types_order = GetTypesNameOrder();
+    QVector<LaneEntry> lanes;
+    lanes.reserve(due_objects.size());
+    for (const quint32 id : due_objects)
+    {
+        const IdPtr<Object> object = id;
+        if (!object.IsValid())
         {
-            objects_lookup_.erase(object.Id());
-            objects_[i] = objects_.last();
-            objects_.pop_back();
-            --end;
-            --i;
-            return;
+            positions_.erase(id);
+            continue;
         }
+        const int type_index = object->GetTypeIndex();
+        lanes.append(LaneEntry{types_order[type_index], id, type_index});
+    }
+    std::sort(lanes.begin(), lanes.end());
+
+    const std::vector<BatchProcessor>& batch_processors = *GetBatchProcessors();
+    QVector<Object*> batch;
+    int lane_begin = 0;
+    while (lane_begin < lanes.size())
+    {
+        const int type_index = std::get<2>(lanes[lane_begin]);
+        const BatchProcessor batch_processor = batch_processors[type_index];
 
-        if ((current_game_tick % object->GetFreq()) == 0)
+        int lane_end = lane_begin;
+        for (; lane_end < lanes.size() && std::get<2>(lanes[lane_end]) == type_index; ++lane_end)
         {
+            Object* object = TakeDueObject(std::get<1>(lanes[lane_end]), current_game_tick);
+            if (!object)
+            {
+                continue;
+            }
+            if (batch_processor)
+            {
+                batch.append(object);
+                continue;
+            }
             object->Process();
         }
+        if (!batch.isEmpty())
+        {
+            batch_processor(batch);
+            batch.clear();
+        }
+        lane_begin = lane_end;
+    }
+}
+
+Object* ObjectProcessor::TakeDueObject(quint32 id, qint32 current_game_tick)
+{
+    auto it = positions_.find(id);
+    // Removed by the previously processed objects
+    if (it == positions_.end())
+    {
+        return nullptr;
+    }
+    positions_.erase(it);
+
+    IdPtr<Object> object = id;
+    if (!object.IsValid())
+    {
+        return nullptr;
+    }
+    const int freq = object->GetFreq();
+    if (freq == 0)
+    {
+        return nullptr;
+    }
+
+    Schedule(id, GetNextDueTick(current_game_tick, freq));
+    return object.operator->();
+}
+
+void ObjectProcessor::Schedule(quint32 object, qint32 due_tick)
+{
+    auto it = positions_.find(object);
+    if (it != positions_.end())
+    {
+        const Position position = it->second;
+        // It will be rescheduled with the actual frequency after the processing
+        if (position.slot == IN_PROCESS)
+        {
+            return;
+        }
+        if (wheel_[position.slot][position.index].second == due_tick)
+        {
+            return;
+        }
+        Unschedule(object);
+    }
+
+    const int slot_index = GetSlot(due_tick);
+    QVector<Entry>& slot = wheel_[slot_index];
+    positions_[object] = {slot_index, slot.size()};
+    slot.append({object, due_tick});
+}
+
+void ObjectProcessor::Unschedule(quint32 object)
+{
+    auto it = positions_.find(object);
+    if (it == positions_.end())
+    {
+        return;
+    }
+    const Position position = it->second;
+    positions_.erase(it);
+
+    if (position.slot == IN_PROCESS)
+    {
+        return;
+    }
+
+    QVector<Entry>& slot = wheel_[position.slot];
+    if (position.index != slot.size() - 1)
+    {
+        slot[position.index] = slot.last();
+        positions_[slot[position.index].first].index = position.index;
     }
+    slot.removeLast();
 }
 
-void ObjectProcessor::LoadObjectsPlaces()
+void ObjectProcessor::LoadPositions()
 {
-    for (auto& object : objects_)
+    kv::Assert(wheel_.size() == WHEEL_SIZE, "ObjectProcessor: unexpected wheel size");
+
+    processed_tick_ = std::numeric_limits<qint32>::max();
+    positions_.clear();
+    for (int slot = 0; slot < wheel_.size(); ++slot)
     {
-        objects_lookup_.insert(object.Id());
+        for (int index = 0; index < wheel_[slot].size(); ++index)
+        {
+            positions_[wheel_[slot][index].first] = {slot, index};
+        }
     }
 }
@@ -2,8 +2,9 @@
 
 #include "Object.h"
 
-#include <unordered_set>
+#include <unordered_map>
 
+#include <QPair>
 #include <QVector>
 
 #include "Interfaces.h"
@@ -21,15 +22,39 @@ public:
     ObjectProcessor();
 
     void Add(quint32 object) override;
+    void Remove(quint32 object) override;
     void RunProcess() override;
-private:
-    QVector<IdPtr<Object>> KV_SAVEABLE(objects_);
 
-    std::unordered_set<quint32> objects_lookup_;
-    void LoadObjectsPlaces();
-    KV_ON_LOAD_CALL(LoadObjectsPlaces);
+    // Slots of the timing wheel, each tick has its own slot
+    static const int WHEEL_SIZE = 64;
+private:
+    // Object and the tick when it should be processed,
+    // objects due in more than WHEEL_SIZE ticks wait for their round in the slot
+    using Entry = QPair<quint32, qint32>;
+    QVector<QVector<Entry>> KV_SAVEABLE(wheel_);
+
+    struct Position
+    {
+        int slot;
+        int index;
+    };
+    // Objects taken from the wheel by the current RunProcess
+    static const int IN_PROCESS = -1;
+    std::unordered_map<quint32, Position> positions_;
+
+    // The tick of the last RunProcess. It is not saved: worlds are created
+    // and saved between the ticks, so the current tick is processed then
+    qint32 processed_tick_;
+
+    // Reschedules the object, returns nullptr if it should not be processed
+    Object* TakeDueObject(quint32 id, qint32 current_game_tick);
+
+    void Schedule(quint32 object, qint32 due_tick);
+    void Unschedule(quint32 object);
+
+    void LoadPositions();
+    KV_ON_LOAD_CALL(LoadPositions);
 };
 END_DECLARE(ObjectProcessor);
 
 }
-
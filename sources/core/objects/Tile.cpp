@@ -170,28 +170,6 @@ bool CubeTile::CanTouch(IdPtr<MapObject> item, Dir first_dir, Dir second_dir) co
     return false;
 }
 
-void CubeTile::MoveToDir(Dir dir, Position* position) const
-{
-    position->x += DirToVDir(dir).x;
-    if (position->x >= GetGame().GetMap().GetWidth() ||
-        position->x <= -1)
-    {
-        position->x -= DirToVDir(dir).x;
-    }
-    position->y += DirToVDir(dir).y;
-    if (position->y >= GetGame().GetMap().GetHeight() ||
-        position->y <= -1)
-    {
-        position->y -= DirToVDir(dir).y;
-    }
-    position->z += DirToVDir(dir).z;
-    if (position->z >= GetGame().GetMap().GetDepth() ||
-        position->z <= -1)
-    {
-        position->z -= DirToVDir(dir).z;
-    }
-}
-
 bool CubeTile::Contains(IdPtr<MapObject> item) const
 {
     for (auto& object : content_)
@@ -298,6 +276,7 @@ bool CubeTile::AddObject(IdPtr<MapObject> item_raw)
     sum_passable_right_ = std::min(sum_passable_right_, item->GetPassable(Dir::EAST));
 
     UpdateAtmosPassable();
+    UpdateOpacity();
     return true;
 }
 bool CubeTile::RemoveObject(IdPtr<MapObject> item_raw)
@@ -337,9 +316,7 @@ IdPtr<MapObject> CubeTile::GetNeighbour(Dir direct) const
 
 IdPtr<CubeTile> CubeTile::GetNeighbourImpl(Dir direct) const
 {
-    Position new_position = GetPosition();
-    MoveToDir(direct, &new_position);
-    return GetGame().GetMap().At(new_position.x, new_position.y, new_position.z);
+    return GetGame().GetMap().GetNeighbour(position_, direct);
 }
 
 PassableLevel CubeTile::GetPassable(Dir direct) const
@@ -356,6 +333,16 @@ PassableLevel CubeTile::GetPassable(Dir direct) const
         return sum_passable_right_;
     case Dir::ALL:
         return sum_passable_all_;
+    case Dir::UP:
+        // The ceiling is the floor of the upper tile
+        return sum_passable_all_;
+    case Dir::DOWN:
+        // Only space has no floor
+        if (turf_.IsValid() && turf_->GetAtmosState() != atmos::SPACE)
+        {
+            return passable::EMPTY;
+        }
+        return sum_passable_all_;
     }
     return passable::FULL;
 }
@@ -386,6 +373,7 @@ void CubeTile::UpdatePassable()
     }
 
     UpdateAtmosPassable();
+    UpdateOpacity();
 }
 
 void CubeTile::ApplyFire(int intensity)
@@ -444,21 +432,26 @@ void CubeTile::ForEach(std::function<void(IdPtr<MapObject>)> callback)
 
 void CubeTile::UpdateAtmosPassable()
 {
-    const Dir dirs[5]
+    const int DIRS_AMOUNT = 7;
+    const Dir dirs[DIRS_AMOUNT]
         = { Dir::ALL,
             Dir::NORTH,
             Dir::SOUTH,
             Dir::WEST,
-            Dir::EAST };
-    const AtmosInterface::Flags bit_dirs[5]
+            Dir::EAST,
+            Dir::UP,
+            Dir::DOWN };
+    const AtmosInterface::Flags bit_dirs[DIRS_AMOUNT]
         = { atmos::CENTER_BLOCK,
             atmos::UP_BLOCK,
             atmos::DOWN_BLOCK,
             atmos::LEFT_BLOCK,
-            atmos::RIGHT_BLOCK };
+            atmos::RIGHT_BLOCK,
+            atmos::ZUP_BLOCK,
+            atmos::ZDOWN_BLOCK };
 
     AtmosInterface::Flags flags = atmos::CLEAR;
-    for (int i = 0; i < 5; ++i)
+    for (int i = 0; i < DIRS_AMOUNT; ++i)
     {
         if (!CanPass(GetPassable(dirs[i]), passable::AIR))
         {
@@ -477,3 +470,8 @@ void CubeTile::UpdateAtmosPassable()
 
     GetGame().GetAtmosphere().SetFlags(position_.x, position_.y, position_.z, flags);
 }
+
+void CubeTile::UpdateOpacity()
+{
+    GetGame().GetMap().UpdateOpacity(position_.x, position_.y, position_.z);
+}
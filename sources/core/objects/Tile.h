@@ -54,6 +54,7 @@ public:
     }
     virtual void UpdatePassable() override;
     virtual atmos::AtmosHolder* GetAtmosHolder() override { return &atmos_holder_; }
+    const atmos::AtmosHolder* GetAtmosHolder() const { return &atmos_holder_; }
 
     virtual void ApplyFire(int intensity) override;
 
@@ -62,14 +63,13 @@ public:
     const ContentType& GetContent() const { return content_; }
 
     void UpdateAtmosPassable();
+    void UpdateOpacity();
 protected:
     virtual quint32 GetItemImpl(int type_index) override;
 private:
     bool CanTouch(IdPtr<MapObject> item, Dir dir) const;
     bool CanTouch(IdPtr<MapObject> item, Dir first_dir, Dir second_dir) const;
 
-    void MoveToDir(Dir dir, Position* position) const;
-
     IdPtr<Turf> KV_SAVEABLE(turf_);
 
     atmos::AtmosHolder KV_SAVEABLE(atmos_holder_);
@@ -32,9 +32,9 @@ void Ghost::AfterWorldCreation()
     SetFreq(10);
 }
 
-void Ghost::Represent(GrowingFrame* frame, IdPtr<Mob> mob) const
+void Ghost::Represent(GrowingFrame* frame, const IdPtr<Mob>& mob) const
 {
-    if (IdPtr<Ghost> ghost = mob)
+    if (const IdPtr<Ghost> ghost = mob)
     {
         Mob::Represent(frame, mob);
     }
@@ -70,7 +70,7 @@ void Ghost::ProcessMessage(const Message& message)
     Mob::ProcessMessage(message);
 }
 
-void Ghost::GenerateInterfaceForFrame(GrowingFrame* frame)
+void Ghost::GenerateInterfaceForFrame(GrowingFrame* frame) const
 {
     const QString text = QString("Until respawn: %1").arg(seconds_until_respawn_);
     frame->Append(FrameData::TextEntry{"Main", text});
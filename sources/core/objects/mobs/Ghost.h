@@ -12,11 +12,11 @@ public:
     REGISTER_CLASS_AS(Ghost);
     Ghost();
     virtual void AfterWorldCreation() override;
-    virtual void Represent(GrowingFrame* frame, IdPtr<kv::Mob> mob) const override;
+    virtual void Represent(GrowingFrame* frame, const IdPtr<kv::Mob>& mob) const override;
     virtual void CalculateVisible(VisiblePoints* visible_list) const override;
     virtual void ProcessMessage(const Message& message) override;
 
-    virtual void GenerateInterfaceForFrame(GrowingFrame* frame) override;
+    virtual void GenerateInterfaceForFrame(GrowingFrame* frame) const override;
 
     virtual void MindEnter() override;
     virtual void MindExit() override;
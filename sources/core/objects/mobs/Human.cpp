@@ -95,7 +95,7 @@ void Human::MindExit()
     // Nothing
 }
 
-void Human::GenerateInterfaceForFrame(GrowingFrame* representation)
+void Human::GenerateInterfaceForFrame(GrowingFrame* representation) const
 {
     Mob::GenerateInterfaceForFrame(representation);
     interface_->Represent(representation);
@@ -558,7 +558,7 @@ void Human::AttackBy(IdPtr<Item> item)
     }
 }
 
-void Human::Represent(GrowingFrame* frame, IdPtr<kv::Mob> mob) const
+void Human::Represent(GrowingFrame* frame, const IdPtr<kv::Mob>& mob) const
 {
     FrameData::Entity ent;
     ent.id = GetId();
@@ -30,7 +30,7 @@ public:
 
     virtual void MindExit() override;
     virtual void MindEnter() override;
-    virtual void GenerateInterfaceForFrame(GrowingFrame* representation) override;
+    virtual void GenerateInterfaceForFrame(GrowingFrame* representation) const override;
     virtual void ProcessMessage(const Message& message) override;
     virtual void Process() override;
     virtual void Live();
@@ -54,7 +54,7 @@ public:
 
     virtual void AttackBy(IdPtr<Item> item) override;
 
-    virtual void Represent(GrowingFrame* frame, IdPtr<Mob> mob) const override;
+    virtual void Represent(GrowingFrame* frame, const IdPtr<Mob>& mob) const override;
 
     virtual bool TryMove(Dir direct) override;
 
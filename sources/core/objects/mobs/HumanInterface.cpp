@@ -325,7 +325,7 @@ bool kv::HumanInterface::InsertItem(Slot* slot, IdPtr<Item> item)
     return true;
 }
 
-void kv::HumanInterface::Represent(GrowingFrame* frame)
+void kv::HumanInterface::Represent(GrowingFrame* frame) const
 {
     for (const Button& button : buttons_)
     {
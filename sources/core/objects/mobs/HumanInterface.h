@@ -50,7 +50,7 @@ public:
     void RemoveItem(const QString& slot_name);
     bool InsertItem(const QString& slot_name, IdPtr<Item> item);
 
-    void Represent(GrowingFrame* frame);
+    void Represent(GrowingFrame* frame) const;
 
     bool RemoveItem(IdPtr<Item> item);
 
@@ -44,7 +44,7 @@ void LoginMob::MindEnter()
     PlayMusic("lobby.ogg", 10);
 }
 
-void LoginMob::GenerateInterfaceForFrame(GrowingFrame* frame)
+void LoginMob::GenerateInterfaceForFrame(GrowingFrame* frame) const
 {
     FrameData::InterfaceUnit unit;
     unit.name = LOGIN_CLICK;
@@ -54,7 +54,8 @@ void LoginMob::GenerateInterfaceForFrame(GrowingFrame* frame)
     frame->Append(unit);
 
     QString text;
-    const int seconds_until_start = GetGame().GetGlobals()->lobby->GetSecondUntilStart();
+    const IdPtr<GlobalObjectsHolder> globals = GetGame().GetGlobals();
+    const int seconds_until_start = globals->lobby->GetSecondUntilStart();
     if (seconds_until_start < 0)
     {
         text = "Round is in process, click on the screen";
@@ -17,7 +17,7 @@ public:
 
     virtual void MindExit() override;
     virtual void MindEnter() override;
-    virtual void GenerateInterfaceForFrame(GrowingFrame* representation) override;
+    virtual void GenerateInterfaceForFrame(GrowingFrame* representation) const override;
     virtual void ProcessMessage(const Message& message) override;
 
     virtual Position GetPosition() const override
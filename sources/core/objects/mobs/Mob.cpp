@@ -16,7 +16,7 @@ void Mob::AfterWorldCreation()
     SetFreq(1);
 }
 
-void Mob::GenerateInterfaceForFrame(GrowingFrame* representation)
+void Mob::GenerateInterfaceForFrame(GrowingFrame* representation) const
 {
 }
 
@@ -18,7 +18,7 @@ public:
 
     virtual void MindEnter() { }
     virtual void MindExit() { }
-    virtual void GenerateInterfaceForFrame(GrowingFrame* representation);
+    virtual void GenerateInterfaceForFrame(GrowingFrame* representation) const;
     virtual void ProcessMessage(const Message& message);
 
     void MoveMindTo(IdPtr<Mob> other);
@@ -116,6 +116,15 @@ void Pipe::Process()
     ProcessHelper(tail_, tail);
 }
 
+void Pipe::ProcessBatch(const QVector<Object*>& pipes)
+{
+    // Objects in the batch are exactly pipes, so the calls are not virtual
+    for (Object* pipe : pipes)
+    {
+        static_cast<Pipe*>(pipe)->Pipe::Process();
+    }
+}
+
 void Pipe::GetTailAndHead(Dir dir, Dir* head, Dir* tail)
 {
     static Dir DIRS_DATA[10][2]
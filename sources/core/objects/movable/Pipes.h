@@ -37,6 +37,9 @@ public:
     virtual void AfterWorldCreation() override;
     virtual bool CanTransferGas(Dir /*dir*/) const override { return true; }
     virtual void Process() override;
+
+    static void ProcessBatch(const QVector<Object*>& pipes);
+    KV_PROCESS_BATCH(ProcessBatch);
 protected:
     static void GetTailAndHead(Dir dir, Dir* head, Dir* tail);
     IdPtr<PipeBase> KV_SAVEABLE(head_);
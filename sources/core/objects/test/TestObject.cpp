@@ -47,7 +47,34 @@ void TestObject::SetDestructorCallback(std::function<void ()> callback)
     destructor_callback_ = callback;
 }
 
+namespace
+{
+
+std::function<void(const QVector<Object*>&)> batch_callback = [](const QVector<Object*>&){};
+
+}
+
+TestBatchObject::TestBatchObject()
+{
+    // Nothing
+}
+
+void TestBatchObject::ProcessBatch(const QVector<Object*>& objects)
+{
+    batch_callback(objects);
+    for (Object* object : objects)
+    {
+        static_cast<TestBatchObject*>(object)->Process();
+    }
+}
+
+void TestBatchObject::SetBatchCallback(std::function<void(const QVector<Object*>&)> callback)
+{
+    batch_callback = callback;
+}
+
 TestHearer::TestHearer()
+    : heard_(0)
 {
     // Nothing
 }
@@ -64,6 +91,7 @@ QVector<Position> TestHearer::GetHeardPoints() const
 
 void TestHearer::Hear(const Phrase& phrase)
 {
+    ++heard_;
     GetGame().GetChatFrameInfo().PostPersonal(
         QString("%1:%2").arg(phrase.from).arg(phrase.text), 42);
 }
@@ -34,6 +34,22 @@ private:
 };
 END_DECLARE(TestObject);
 
+class TestBatchObject : public TestObject
+{
+public:
+    DECLARE_SAVEABLE(TestBatchObject, TestObject);
+    REGISTER_CLASS_AS(TestBatchObject);
+
+    TestBatchObject();
+
+    // Calls the batch callback and then Process() of each object
+    static void ProcessBatch(const QVector<Object*>& objects);
+    KV_PROCESS_BATCH(ProcessBatch);
+
+    static void SetBatchCallback(std::function<void(const QVector<Object*>&)> callback);
+};
+END_DECLARE(TestBatchObject);
+
 class TestHearer : public Object, public Hearer
 {
 public:
@@ -47,6 +63,8 @@ public:
 
     virtual QVector<Position> GetHeardPoints() const override;
     virtual void Hear(const Phrase& phrase) override;
+
+    int KV_SAVEABLE(heard_);
 };
 END_DECLARE(TestHearer);
 
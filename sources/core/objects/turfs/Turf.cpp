@@ -16,11 +16,11 @@ void Turf::Delete()
     MaterialObject::Delete();
 }
 
-void Turf::Represent(GrowingFrame* frame, IdPtr<Mob> mob) const
+void Turf::Represent(GrowingFrame* frame, const IdPtr<Mob>& mob) const
 {
-    if (IdPtr<CubeTile> tile = GetOwner())
+    if (const IdPtr<CubeTile> tile = GetOwner())
     {
-        atmos::AtmosHolder* holder = tile->GetAtmosHolder();
+        const atmos::AtmosHolder* holder = tile->GetAtmosHolder();
         const int plasma = holder->GetGase(atmos::PLASMA);
         const int oxygen = holder->GetGase(atmos::OXYGEN);
         const int VISIBILITY_THRESHOLD = 5;
@@ -0,0 +1,275 @@
+#include <gtest/gtest.h>
+
+#include "atmos/AtmosGrid.h"
+#include "WorkerPool.h"
+
+using namespace atmos;
+
+namespace
+{
+
+const int WIDTH = 4 * CELL_GROUP_SIZE;
+const int HEIGHT = 3 * CELL_GROUP_SIZE;
+
+void FillGrid(AtmosGrid* grid)
+{
+    quint32 state = 42;
+    auto generate = [&state]()
+    {
+        state = state * 1664525u + 1013904223u;
+        return state >> 16;
+    };
+
+    for (int x = 0; x < WIDTH; ++x)
+    {
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            const int index = grid->GetIndex(x, y);
+            AtmosData data = grid->Load(index);
+            for (int i = 0; i < GASES_NUM; ++i)
+            {
+                data.gases[i] = generate() % 1000;
+            }
+            data.energy = generate() % 10000;
+            data.fire = (generate() % 50) == 0;
+            grid->Store(index, data);
+
+            const quint32 kind = generate() % 20;
+            if (kind == 0)
+            {
+                grid->SetFlags(index, CENTER_BLOCK);
+            }
+            else if (kind == 1)
+            {
+                grid->SetFlags(index, DIRS[generate() % DIRS_SIZE]);
+            }
+            else if (kind == 2)
+            {
+                grid->SetFlags(index, SPACE_TILE);
+            }
+        }
+    }
+}
+
+void ExpectEqualGrids(AtmosGrid* expected, AtmosGrid* actual)
+{
+    for (int x = 0; x < WIDTH; ++x)
+    {
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            const int index = expected->GetIndex(x, y);
+            const AtmosData expected_data = expected->Load(index);
+            const AtmosData actual_data = actual->Load(index);
+            for (int i = 0; i < GASES_NUM; ++i)
+            {
+                ASSERT_EQ(expected_data.gases[i], actual_data.gases[i]);
+            }
+            for (int dir = 0; dir < DIRS_SIZE; ++dir)
+            {
+                ASSERT_EQ(expected->Flow(index, dir), actual->Flow(index, dir));
+            }
+            ASSERT_EQ(expected_data.energy, actual_data.energy);
+            ASSERT_EQ(expected_data.pressure, actual_data.pressure);
+            ASSERT_EQ(expected_data.temperature, actual_data.temperature);
+            ASSERT_EQ(expected_data.fire, actual_data.fire);
+        }
+    }
+}
+
+}
+
+TEST(AtmosGrid, ParallelProcessingSameAsSerial)
+{
+    AtmosGrid serial(WIDTH, HEIGHT);
+    FillGrid(&serial);
+
+    kv::WorkerPool workers(4);
+    AtmosGrid parallel(WIDTH, HEIGHT);
+    parallel.SetWorkerPool(&workers);
+    FillGrid(&parallel);
+
+    for (int tick = 0; tick < 20; ++tick)
+    {
+        serial.Process(tick);
+        parallel.Process(tick);
+    }
+    ExpectEqualGrids(&serial, &parallel);
+}
+
+TEST(AtmosGrid, SimdKernelsSameAsScalar)
+{
+    AtmosGrid scalar(WIDTH, HEIGHT);
+    scalar.SetSimdLevel(SimdLevel::SCALAR);
+    FillGrid(&scalar);
+    for (int tick = 0; tick < 20; ++tick)
+    {
+        scalar.Process(tick);
+    }
+
+    const int supported = static_cast<int>(GetSupportedSimdLevel());
+    for (int level = static_cast<int>(SimdLevel::SSE4); level <= supported; ++level)
+    {
+        AtmosGrid simd(WIDTH, HEIGHT);
+        simd.SetSimdLevel(static_cast<SimdLevel>(level));
+        FillGrid(&simd);
+        for (int tick = 0; tick < 20; ++tick)
+        {
+            simd.Process(tick);
+        }
+        ExpectEqualGrids(&scalar, &simd);
+    }
+}
+
+TEST(AtmosGrid, SleepingSameAsAlwaysProcessing)
+{
+    AtmosGrid sleeping(WIDTH, HEIGHT);
+    FillGrid(&sleeping);
+    AtmosGrid always(WIDTH, HEIGHT);
+    always.SetSleepingEnabled(false);
+    FillGrid(&always);
+
+    for (int tick = 0; tick < 300; ++tick)
+    {
+        if (tick == 150)
+        {
+            for (AtmosGrid* grid : {&sleeping, &always})
+            {
+                const int index = grid->GetIndex(WIDTH / 2, HEIGHT / 2);
+                grid->SetFlags(index, CLEAR);
+                AtmosData data = grid->Load(index);
+                data.gases[OXYGEN] += 5000;
+                grid->Store(index, data);
+            }
+        }
+        sleeping.Process(tick);
+        always.Process(tick);
+        // Cached hashes of the sleeping groups should be up to date
+        ASSERT_EQ(sleeping.Hash(), always.Hash());
+    }
+    ExpectEqualGrids(&always, &sleeping);
+}
+
+TEST(AtmosGrid, GroupsFallAsleep)
+{
+    AtmosGrid grid(WIDTH, HEIGHT);
+    const int GROUPS_AMOUNT = (WIDTH / CELL_GROUP_SIZE) * (HEIGHT / CELL_GROUP_SIZE);
+    EXPECT_EQ(grid.GetActiveGroupsAmount(), GROUPS_AMOUNT);
+
+    for (int tick = 0; tick < IDLE_TICKS_TO_SLEEP; ++tick)
+    {
+        grid.Process(tick);
+    }
+    EXPECT_EQ(grid.GetActiveGroupsAmount(), 0);
+    EXPECT_TRUE(grid.IsIdle(0));
+
+    const int index = grid.GetIndex(CELL_GROUP_SIZE + 5, 5);
+    const int group = grid.GetGroupIndex(index);
+
+    // The same data does not wake up the group
+    AtmosData data = grid.Load(index);
+    grid.Store(index, data);
+    grid.SetFlags(index, CLEAR);
+    EXPECT_EQ(grid.GetActiveGroupsAmount(), 0);
+
+    // Pressure can push something through a blocked side there
+    grid.SetFlags(index, LEFT_BLOCK);
+    EXPECT_EQ(grid.GetActiveGroupsAmount(), 1);
+    EXPECT_FALSE(grid.IsSleeping(group));
+    for (int tick = 0; tick < IDLE_TICKS_TO_SLEEP; ++tick)
+    {
+        grid.Process(tick);
+    }
+    EXPECT_TRUE(grid.IsSleeping(group));
+    EXPECT_FALSE(grid.IsIdle(group));
+
+    data.gases[OXYGEN] = 100;
+    grid.Store(index, data);
+    EXPECT_FALSE(grid.IsSleeping(group));
+}
+
+TEST(AtmosGrid, ProcessVertical)
+{
+    AtmosGrid lower(CELL_GROUP_SIZE, CELL_GROUP_SIZE);
+    AtmosGrid upper(CELL_GROUP_SIZE, CELL_GROUP_SIZE);
+
+    const int open = lower.GetIndex(3, 4);
+    const int closed = lower.GetIndex(4, 3);
+    for (int index : {open, closed})
+    {
+        AtmosData data = lower.Load(index);
+        data.gases[OXYGEN] = 101;
+        data.energy = 1000;
+        lower.Store(index, data);
+    }
+    upper.SetFlags(closed, ZDOWN_BLOCK);
+
+    for (int tick = 0; tick < IDLE_TICKS_TO_SLEEP; ++tick)
+    {
+        upper.Process(tick);
+    }
+    EXPECT_EQ(upper.GetActiveGroupsAmount(), 0);
+
+    lower.ProcessVertical(&upper);
+
+    EXPECT_EQ(lower.Load(open).gases[OXYGEN], 51);
+    EXPECT_EQ(upper.Load(open).gases[OXYGEN], 50);
+    EXPECT_EQ(lower.Load(open).energy, 500);
+    EXPECT_EQ(upper.Load(open).energy, 500);
+    EXPECT_GT(upper.GetPressure(open), 0);
+    EXPECT_EQ(upper.GetActiveGroupsAmount(), 1);
+
+    EXPECT_EQ(lower.Load(closed).gases[OXYGEN], 101);
+    EXPECT_EQ(upper.Load(closed).gases[OXYGEN], 0);
+}
+
+TEST(AtmosGrid, LoadStore)
+{
+    AtmosGrid grid(CELL_GROUP_SIZE, CELL_GROUP_SIZE);
+    const int index = grid.GetIndex(3, 5);
+
+    AtmosData data = grid.Load(index);
+    EXPECT_EQ(data.volume, 1);
+    EXPECT_EQ(data.energy, 0);
+    EXPECT_FALSE(data.fire);
+
+    data.gases[OXYGEN] = 100;
+    data.energy = 42;
+    data.fire = true;
+    grid.Store(index, data);
+
+    const AtmosData loaded = grid.Load(index);
+    EXPECT_EQ(loaded.gases[OXYGEN], 100);
+    EXPECT_EQ(loaded.energy, 42);
+    EXPECT_TRUE(loaded.fire);
+    EXPECT_TRUE(grid.IsBurning(index));
+    EXPECT_FALSE(grid.IsBurning(grid.GetIndex(5, 3)));
+}
+
+TEST(WorkerPool, ParallelFor)
+{
+    kv::WorkerPool workers(3);
+    EXPECT_EQ(workers.GetThreadsAmount(), 3);
+
+    std::vector<int> values(1000, 0);
+    workers.ParallelFor(static_cast<int>(values.size()), [&values](int index)
+    {
+        values[index] += index;
+    });
+    for (int i = 0; i < static_cast<int>(values.size()); ++i)
+    {
+        EXPECT_EQ(values[i], i);
+    }
+
+    workers.ParallelFor(0, [](int)
+    {
+        FAIL();
+    });
+}
+
+TEST(WorkerPoolDeathTest, InvalidThreadsAmount)
+{
+    ASSERT_DEATH(
+    {
+        kv::WorkerPool workers(0);
+    }, "Invalid amount of worker threads: 0");
+}
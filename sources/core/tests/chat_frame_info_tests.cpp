@@ -137,13 +137,15 @@ public:
     TestHearer(ChatFrameInfo* info, quint32 net_id, const QVector<Position>& heard_points)
         : info_(info),
           net_id_(net_id),
-          heard_points_(heard_points)
+          heard_points_(heard_points),
+          heard_points_calls_(0)
     {
         // Nothing
     }
 
     virtual QVector<Position> GetHeardPoints() const override
     {
+        ++heard_points_calls_;
         return heard_points_;
     }
     virtual void Hear(const Phrase &phrase) override
@@ -154,6 +156,8 @@ private:
     ChatFrameInfo* info_;
     quint32 net_id_;
     QVector<Position> heard_points_;
+public:
+    mutable int heard_points_calls_;
 };
 
 }
@@ -213,3 +217,23 @@ TEST(ChatFrameInfo, PostHear)
     info.Reset();
     CheckInfoEmpty(info);
 }
+
+TEST(ChatFrameInfo, ApplyHearWithoutPhrases)
+{
+    ChatFrameInfo info;
+
+    TestHearer hearer(&info, 10, {{1, 1, 0}});
+    info.ApplyHear(&hearer);
+    EXPECT_EQ(hearer.heard_points_calls_, 0);
+    EXPECT_EQ(info.GetPersonalTexts(10).size(), 0);
+
+    Phrase phrase;
+    phrase.from = "human1";
+    phrase.text = "text1";
+    phrase.expression = "express1";
+    info.PostHear(phrase, {1, 1, 0});
+
+    info.ApplyHear(&hearer);
+    EXPECT_EQ(hearer.heard_points_calls_, 1);
+    EXPECT_EQ(info.GetPersonalTexts(10).size(), 1);
+}
@@ -4,6 +4,8 @@
 
 #include <QFile>
 
+#include <limits>
+
 using namespace kv;
 
 TEST(FastSerializer, Constructor)
@@ -233,6 +235,29 @@ TEST(FastSerializer, WriteType)
     }
 }
 
+TEST(FastSerializer, WriteTypeIndex)
+{
+    FastSerializer serializer;
+
+    serializer.WriteTypeIndex(0);
+    ASSERT_EQ(serializer.GetIndex(), 2);
+    EXPECT_EQ(serializer.GetData()[0], '\x08');
+    EXPECT_EQ(serializer.GetData()[1], '\x00');
+
+    serializer.WriteTypeIndex(300);
+    ASSERT_EQ(serializer.GetIndex(), 5);
+    EXPECT_EQ(serializer.GetData()[2], '\x08');
+    EXPECT_EQ(serializer.GetData()[3], '\xAC');
+    EXPECT_EQ(serializer.GetData()[4], '\x02');
+
+    serializer.WriteTypeIndex(std::numeric_limits<quint32>::max());
+    ASSERT_EQ(serializer.GetIndex(), 11);
+    EXPECT_EQ(serializer.GetData()[5], '\x08');
+    EXPECT_EQ(serializer.GetData()[6], '\xFF');
+    EXPECT_EQ(serializer.GetData()[9], '\xFF');
+    EXPECT_EQ(serializer.GetData()[10], '\x0F');
+}
+
 TEST(FastSerializer, WriteInt64)
 {
     FastSerializer serializer;
@@ -305,6 +330,31 @@ TEST(FastSerializer, ResetIndex)
     ASSERT_EQ(serializer.GetIndex(), 0);
 }
 
+TEST(FastSerializer, Sink)
+{
+    QByteArray sink("head");
+    {
+        FastSerializer serializer(&sink);
+        ASSERT_EQ(serializer.GetIndex(), 4);
+
+        serializer << 42;
+        serializer << QString("Hello world!");
+        ASSERT_EQ(serializer.GetIndex(), 39);
+        EXPECT_EQ(serializer.GetData(), sink.data());
+    }
+    ASSERT_EQ(sink.size(), 39);
+    EXPECT_TRUE(sink.startsWith("head\x02\x2A"));
+
+    FastDeserializer deserializer(sink.data() + 4, sink.size() - 4);
+    int number;
+    deserializer >> number;
+    EXPECT_EQ(number, 42);
+    QString string;
+    deserializer >> string;
+    EXPECT_EQ(string, "Hello world!");
+    EXPECT_TRUE(deserializer.IsEnd());
+}
+
 TEST(FastSerializer, BigData)
 {
     FastSerializer serializer;
@@ -466,7 +516,7 @@ TEST(FastDeserializer, ReadInt32)
 
     ASSERT_FALSE(deserializer.IsEnd());
     deserializer >> value;
-    EXPECT_EQ(value, 0);
+    EXPECT_EQ(value, 0u);
 
     ASSERT_FALSE(deserializer.IsEnd());
     deserializer >> value;
@@ -507,7 +557,7 @@ TEST(FastDeserializer, ReadUint32)
 
     ASSERT_FALSE(deserializer.IsEnd());
     deserializer >> value;
-    EXPECT_EQ(value, 0);
+    EXPECT_EQ(value, 0u);
 
     ASSERT_FALSE(deserializer.IsEnd());
     deserializer >> value;
@@ -588,6 +638,40 @@ TEST(FastDeserializer, ReadType)
     ASSERT_TRUE(deserializer.IsEnd());
 }
 
+TEST(FastDeserializer, ReadTypeIndex)
+{
+    const char* const DATA =
+        "\x08\x00"
+        "\x08\x7F"
+        "\x08\xAC\x02"
+        "\x08\xFF\xFF\xFF\xFF\x0F";
+    const int DATA_SIZE = 13;
+
+    FastDeserializer deserializer(DATA, DATA_SIZE);
+    quint32 value;
+
+    deserializer.ReadTypeIndex(&value);
+    EXPECT_EQ(value, 0u);
+    deserializer.ReadTypeIndex(&value);
+    EXPECT_EQ(value, 127u);
+    deserializer.ReadTypeIndex(&value);
+    EXPECT_EQ(value, 300u);
+    deserializer.ReadTypeIndex(&value);
+    EXPECT_EQ(value, std::numeric_limits<quint32>::max());
+
+    ASSERT_TRUE(deserializer.IsEnd());
+}
+
+TEST(FastDeserializerDeathTest, ReadTypeIndexTooLong)
+{
+    FastDeserializer deserializer("\x08\xFF\xFF\xFF\xFF\xFF\x01", 7);
+    ASSERT_DEATH(
+    {
+        quint32 value;
+        deserializer.ReadTypeIndex(&value);
+    }, "FastDeserializer: varint is out of range!");
+}
+
 TEST(FastDeserializer, ReadByteArray)
 {
     const char* const DATA = "\x05\x02\x0A\x00\x00\x00\x1F\x04\x20\x00\x20\x00\x3C\x04\x20\x00";
@@ -624,7 +708,7 @@ TEST(FastDeserializer, ReadInt64)
 
     ASSERT_FALSE(deserializer.IsEnd());
     deserializer >> value;
-    EXPECT_EQ(value, 0);
+    EXPECT_EQ(value, 0u);
 
     ASSERT_FALSE(deserializer.IsEnd());
     deserializer >> value;
@@ -702,6 +786,90 @@ TEST(FastSerializeDeserialize, VariousValues)
     }
 }
 
+TEST(FastSerializer, WriteCompact)
+{
+    FastSerializer serializer;
+    serializer.SetMode(FastSerializer::Mode::COMPACT);
+
+    serializer << true;
+    serializer << 42;
+    serializer << -1;
+    serializer << 300u;
+    serializer << QString("ab");
+    serializer << QString("ab");
+    serializer << QByteArray("\xFF", 1);
+    serializer.WriteTypeIndex(5);
+
+    const QByteArray expected("\x01\x54\x01\xAC\x02\x00\x02\x61\x62\x01\x01\xFF\x05", 13);
+    EXPECT_EQ(QByteArray(serializer.GetData(), static_cast<int>(serializer.GetIndex())), expected);
+}
+
+TEST(FastSerializeDeserialize, VariousValuesCompact)
+{
+    FastSerializer serializer;
+    serializer.SetMode(FastSerializer::Mode::COMPACT);
+    serializer << false;
+    serializer << std::numeric_limits<qint32>::min();
+    serializer << std::numeric_limits<qint32>::max();
+    serializer << std::numeric_limits<quint32>::max();
+    serializer << std::numeric_limits<qint64>::min();
+    serializer << QString("Ехал грека через реку");
+    serializer << QString();
+    serializer.WriteType("Ехал грека через реку");
+    serializer << QByteArray("woof");
+    serializer.WriteTypeIndex(1000);
+
+    FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+    deserializer.SetMode(FastSerializer::Mode::COMPACT);
+
+    bool bool_value;
+    deserializer >> bool_value;
+    EXPECT_FALSE(bool_value);
+
+    qint32 int_value;
+    deserializer >> int_value;
+    EXPECT_EQ(int_value, std::numeric_limits<qint32>::min());
+    deserializer >> int_value;
+    EXPECT_EQ(int_value, std::numeric_limits<qint32>::max());
+
+    quint32 uint_value;
+    deserializer >> uint_value;
+    EXPECT_EQ(uint_value, std::numeric_limits<quint32>::max());
+
+    qint64 int64_value;
+    deserializer >> int64_value;
+    EXPECT_EQ(int64_value, std::numeric_limits<qint64>::min());
+
+    QString string_value;
+    deserializer >> string_value;
+    EXPECT_EQ(string_value, "Ехал грека через реку");
+    deserializer >> string_value;
+    EXPECT_EQ(string_value, "");
+    deserializer.ReadType(&string_value);
+    EXPECT_EQ(string_value, "Ехал грека через реку");
+
+    QByteArray bytearray_value;
+    deserializer >> bytearray_value;
+    EXPECT_EQ(bytearray_value, QByteArray("woof"));
+
+    quint32 type_index;
+    deserializer.ReadTypeIndex(&type_index);
+    EXPECT_EQ(type_index, 1000u);
+
+    ASSERT_TRUE(deserializer.IsEnd());
+}
+
+TEST(FastDeserializerDeathTest, CompactUnknownString)
+{
+    FastDeserializer deserializer("\x02", 1);
+    deserializer.SetMode(FastSerializer::Mode::COMPACT);
+    ASSERT_DEATH(
+    {
+        QString value;
+        deserializer >> value;
+    }, "FastDeserializer: unknown string id: 2");
+}
+
 TEST(FastDeserializerDeathTest, HumanizeUnknownType)
 {
     FastDeserializer deserializer("\x80", 1);
@@ -721,6 +889,8 @@ TEST(FastDeserializer, Humanize)
     serializer << true;
     serializer.WriteType("Meow");
     serializer << QString("smart kitty has some $$$!");
+    serializer.WriteTypeIndex(17);
+    serializer << 1u;
     serializer.WriteType(END_TYPE);
     serializer << QString("stupid kitty");
 
@@ -728,6 +898,6 @@ TEST(FastDeserializer, Humanize)
 
     QString value = Humanize(&deserializer);
 
-    EXPECT_EQ(value, "woof 123 42 776f6f66 1 \r\nMeow smart$kitty$has$some$\\$\\$\\$! ");
-    EXPECT_EQ(deserializer.GetIndex(), 118);
+    EXPECT_EQ(value, "woof 123 42 776f6f66 1 \r\nMeow smart$kitty$has$some$\\$\\$\\$! \r\n#17 1 ");
+    EXPECT_EQ(deserializer.GetIndex(), 125);
 }
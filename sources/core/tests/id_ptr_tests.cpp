@@ -144,8 +144,70 @@ TEST_F(IdPtrTest, Validating)
     ASSERT_TRUE(ptr.IsValid());
     ASSERT_TRUE(ptr);
 
+    // Deletion changes the generation of the entry
     (*id_ptr_id_table)[42].object = nullptr;
+    ++(*id_ptr_id_table)[42].generation;
     ASSERT_FALSE(ptr.IsValid());
+    ASSERT_FALSE(ptr);
+}
+
+TEST_F(IdPtrTest, Generation)
+{
+    kv::Object object;
+    kv::Object other_object;
+    (*id_ptr_id_table)[42].object = &object;
+
+    IdPtr<kv::Object> ptr = 42;
+    ASSERT_EQ(qAsConst(ptr).operator->(), &object);
+
+    // The pointer is cached while the generation is the same
+    (*id_ptr_id_table)[42].object = &other_object;
+    EXPECT_EQ(qAsConst(ptr).operator->(), &object);
+    IdPtr<kv::Object> copy = ptr;
+    EXPECT_EQ(qAsConst(copy).operator->(), &object);
+
+    // The index is reused by a new object
+    ++(*id_ptr_id_table)[42].generation;
+    EXPECT_FALSE(ptr.IsValid());
+    EXPECT_FALSE(copy.IsValid());
+
+    IdPtr<kv::Object> new_ptr = kv::MakeId(42, 1);
+    EXPECT_EQ(new_ptr.Id(), (1u << kv::ID_INDEX_BITS) + 42);
+    EXPECT_EQ(qAsConst(new_ptr).operator->(), &other_object);
+    EXPECT_NE(new_ptr, ptr);
+}
+
+TEST_F(IdPtrTest, ReadOnly)
+{
+    kv::Object object;
+    kv::Object other_object;
+    (*id_ptr_id_table)[42].object = &object;
+
+    IdPtr<kv::Object> ptr = 42;
+    id_ptr_read_only = true;
+    EXPECT_TRUE(ptr.IsValid());
+    EXPECT_EQ(qAsConst(ptr).operator->(), &object);
+    id_ptr_read_only = false;
+
+    // Nothing has been cached in the read only mode
+    (*id_ptr_id_table)[42].object = &other_object;
+    EXPECT_EQ(qAsConst(ptr).operator->(), &other_object);
+    EXPECT_FALSE((*id_ptr_id_table)[42].changed);
+}
+
+TEST(IdPtrDeathTest, ReadOnly)
+{
+    TempTable table;
+
+    kv::Object object;
+    (*id_ptr_id_table)[42].object = &object;
+
+    ASSERT_DEATH(
+    {
+        IdPtr<kv::Object> ptr = 42;
+        id_ptr_read_only = true;
+        ptr.operator*();
+    }, "Non-const access to IdPtr in the read only mode");
 }
 
 TEST_F(IdPtrTest, SaveAndLoad)
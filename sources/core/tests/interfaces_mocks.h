@@ -19,6 +19,8 @@ public:
 
     MOCK_METHOD4(SetFlags, void(quint32 x, quint32 y, quint32 z, Flags flags));
     MOCK_METHOD1(LoadGrid, void(MapInterface*));
+
+    MOCK_METHOD0(Hash, quint32());
 };
 
 class MockIMap : public MapInterface
@@ -28,13 +30,18 @@ public:
     MOCK_CONST_METHOD0(GetHeight, int());
     MOCK_CONST_METHOD0(GetDepth, int());
     MOCK_CONST_METHOD3(
-        Represent, void(kv::GrowingFrame* representation, const VisiblePoints& points, IdPtr<kv::Mob> mob));
+        Represent, void(kv::GrowingFrame* representation, const VisiblePoints& points, const IdPtr<kv::Mob>& mob));
     MOCK_METHOD3(Resize, void(int new_map_x, int new_map_y, int new_map_z));
     MOCK_CONST_METHOD3(At, const SqType&(int x, int y, int z));
     MOCK_METHOD3(At, SqType&(int x, int y, int z));
+    MOCK_CONST_METHOD2(GetNeighbour, const SqType&(const kv::Position& position, Dir dir));
     MOCK_METHOD0(FillTilesAtmosHolders, void());
     MOCK_CONST_METHOD4(CalculateLos, void(VisiblePoints*, int, int, int));
+    MOCK_METHOD0(RemoveUnusedLos, void());
+    MOCK_METHOD1(SetLosEngine, void(kv::LosEngine));
     MOCK_CONST_METHOD3(Istransparent, bool(int, int, int));
+    MOCK_METHOD3(UpdateOpacity, void(int, int, int));
+    MOCK_METHOD0(LoadOpacity, void());
 };
 
 class MockIObjectFactory : public ObjectFactoryInterface
@@ -42,24 +49,31 @@ class MockIObjectFactory : public ObjectFactoryInterface
 public:
     MOCK_METHOD0(GetIdTable, std::vector<ObjectInfo>&());
     MOCK_CONST_METHOD0(GetIdTable, const std::vector<ObjectInfo>&());
-    MOCK_CONST_METHOD0(Hash, quint32());
+    MOCK_METHOD0(Hash, quint32());
+    MOCK_CONST_METHOD2(HashIdsRange, quint32(quint32 begin, quint32 end));
+    MOCK_CONST_METHOD0(HashTypes, QMap<QString, quint32>());
+    MOCK_CONST_METHOD0(HashFull, quint32());
+    MOCK_METHOD0(MarkAllObjectsChanged, void());
     MOCK_METHOD0(BeginWorldCreation, void());
     MOCK_METHOD0(FinishWorldCreation, void());
     MOCK_METHOD0(MarkWorldAsCreated, void());
     MOCK_METHOD2(CreateImpl, quint32(const QString&, quint32));
-    MOCK_METHOD2(CreateVoid, kv::Object*(const QString& hash, quint32 id_new));
+    MOCK_METHOD2(CreateVoid, kv::Object*(int type_index, quint32 id_new));
     MOCK_METHOD2(CreateAssetImpl, quint32(const kv::Asset& asset, quint32));
     MOCK_METHOD1(DeleteLater, void(quint32 id));
     MOCK_METHOD0(ProcessDeletion, void());
     MOCK_METHOD0(Clear, void());
     MOCK_CONST_METHOD0(GetId, int());
     MOCK_METHOD1(SetId, void(int id));
+    MOCK_CONST_METHOD0(GetFreeIds, const QVector<quint32>&());
+    MOCK_METHOD1(SetFreeIds, void(const QVector<quint32>& ids));
 };
 
 class MockObjectProcessor : public ObjectProcessorInterface
 {
 public:
     MOCK_METHOD1(Add, void(quint32 id));
+    MOCK_METHOD1(Remove, void(quint32 id));
     MOCK_METHOD0(RunProcess, void());
 };
 
@@ -0,0 +1,41 @@
+#include <gtest/gtest.h>
+
+#include "LosCalculator.h"
+
+using namespace kv;
+
+TEST(LosCalculator, Wall)
+{
+    const int WIDTH = 10;
+    const int HEIGHT = 10;
+    QBitArray opacity(WIDTH * HEIGHT);
+    for (int y = 0; y < HEIGHT; ++y)
+    {
+        opacity.setBit(5 + y * WIDTH);
+    }
+
+    VisiblePoints points;
+    LosCalculator(WIDTH, HEIGHT, opacity).Calculate(&points, 2, 5, 0);
+
+    EXPECT_EQ(points.size(), 6 * HEIGHT);
+    for (const Position& point : points)
+    {
+        EXPECT_LE(point.x, 5);
+        EXPECT_EQ(point.z, 0);
+    }
+    EXPECT_TRUE(points.contains({5, 0, 0}));
+    EXPECT_FALSE(points.contains({6, 5, 0}));
+}
+
+TEST(LosCalculator, Empty)
+{
+    const int WIDTH = 30;
+    const int HEIGHT = 30;
+    QBitArray opacity(WIDTH * HEIGHT);
+
+    VisiblePoints points;
+    LosCalculator(WIDTH, HEIGHT, opacity).Calculate(&points, 15, 15, 0);
+
+    // The whole viewport
+    EXPECT_EQ(points.size(), 24 * 24);
+}
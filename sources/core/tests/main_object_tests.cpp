@@ -3,6 +3,7 @@
 #include "interfaces_mocks.h"
 
 #include "objects/Object.h"
+#include "AutogenMetadata.h"
 
 using ::testing::ReturnRef;
 using ::testing::Return;
@@ -53,13 +54,13 @@ TEST(MainObject, Save)
         object.Save(save);
 
         const char* const DATA =
-            "\x06\x02\x04\x00\x00\x00\x6d\x00\x61\x00"
-            "\x69\x00\x6E\x00\x03\x2A\x00\x00\x00"
+            "\x08\x00"
+            "\x03\x2A\x00\x00\x00"
             "\x02\x00\x00\x00\x00";
 
         EXPECT_EQ(
             QByteArray(save.GetData(), save.GetIndex()),
-            QByteArray(DATA, 24));
+            QByteArray(DATA, 12));
     }
     {
         MockIGame game;
@@ -78,6 +79,23 @@ TEST(MainObject, Save)
     }
 }
 
+TEST(MainObject, FlatSerializer)
+{
+    Object object;
+    kv::internal::GetObjectId(&object) = 42;
+
+    const ObjectSerializer& serializer = OBJECT_SERIALIZERS[Object::GetTypeIndexStatic()];
+    EXPECT_EQ(serializer.hash(&object), object.HashMembers());
+
+    FastSerializer virtual_save(1);
+    object.Save(virtual_save);
+    FastSerializer flat_save(1);
+    serializer.save(&object, flat_save);
+    EXPECT_EQ(
+        QByteArray(flat_save.GetData(), flat_save.GetIndex()),
+        QByteArray(virtual_save.GetData(), virtual_save.GetIndex()));
+}
+
 TEST(MainObjectDeathTest, Deaths)
 {
     {
@@ -0,0 +1,100 @@
+#include <gtest/gtest.h>
+
+#include "core_headers/MapChunks.h"
+
+namespace
+{
+
+QByteArray MakeData(int size)
+{
+    QByteArray retval;
+    for (int i = 0; i < size; ++i)
+    {
+        retval.append(static_cast<char>((i * 7) % 13 + (i / 100) % 5));
+    }
+    return retval;
+}
+
+}
+
+TEST(MapChunks, RoundTrip)
+{
+    for (int size : {0, 1, 99, 100, 101, 1000})
+    {
+        const QByteArray data = MakeData(size);
+        const QByteArray compressed = MapChunks::Compress(data, 100);
+        EXPECT_EQ(MapChunks::Uncompress(compressed), data);
+
+        MapChunks::Uncompressor uncompressor;
+        EXPECT_TRUE(uncompressor.Append(compressed));
+        EXPECT_TRUE(uncompressor.IsFinished());
+        EXPECT_EQ(uncompressor.TakeResult(), data);
+        EXPECT_TRUE(uncompressor.TakeResult().isEmpty());
+    }
+}
+
+TEST(MapChunks, SplitBuffer)
+{
+    const QByteArray data = MakeData(1000);
+    const QByteArray compressed = MapChunks::Compress(data, 128);
+
+    for (int step : {1, 3, 64, 1000})
+    {
+        MapChunks::Uncompressor uncompressor;
+        QByteArray result;
+        for (int position = 0; position < compressed.size(); position += step)
+        {
+            EXPECT_FALSE(uncompressor.IsFinished());
+            ASSERT_TRUE(uncompressor.Append(compressed.mid(position, step)));
+            // Chunks are available as soon as they are received
+            result.append(uncompressor.TakeResult());
+        }
+        EXPECT_TRUE(uncompressor.IsFinished());
+        EXPECT_EQ(result, data);
+    }
+}
+
+TEST(MapChunks, Truncated)
+{
+    const QByteArray compressed = MapChunks::Compress(MakeData(1000), 100);
+
+    for (int size : {0, 2, 4, 10, compressed.size() - 4, compressed.size() - 1})
+    {
+        MapChunks::Uncompressor uncompressor;
+        EXPECT_TRUE(uncompressor.Append(compressed.left(size)));
+        EXPECT_FALSE(uncompressor.IsFinished());
+        EXPECT_TRUE(MapChunks::Uncompress(compressed.left(size)).isEmpty());
+    }
+}
+
+TEST(MapChunks, TrailingGarbage)
+{
+    const QByteArray data = MakeData(500);
+    const QByteArray compressed = MapChunks::Compress(data, 100);
+    {
+        MapChunks::Uncompressor uncompressor;
+        EXPECT_FALSE(uncompressor.Append(compressed + "garbage"));
+        EXPECT_FALSE(uncompressor.IsFinished());
+        EXPECT_FALSE(uncompressor.Append(QByteArray("more")));
+    }
+    {
+        MapChunks::Uncompressor uncompressor;
+        EXPECT_TRUE(uncompressor.Append(compressed));
+        EXPECT_TRUE(uncompressor.IsFinished());
+        EXPECT_FALSE(uncompressor.Append(QByteArray("x")));
+        EXPECT_FALSE(uncompressor.IsFinished());
+    }
+    EXPECT_TRUE(MapChunks::Uncompress(compressed + compressed).isEmpty());
+}
+
+TEST(MapChunks, CorruptedChunk)
+{
+    QByteArray compressed = MapChunks::Compress(MakeData(500), 100);
+    // Inside the zlib stream of the first chunk
+    compressed[12] = static_cast<char>(compressed[12] ^ 0x5a);
+    compressed[13] = static_cast<char>(compressed[13] ^ 0x5a);
+
+    MapChunks::Uncompressor uncompressor;
+    EXPECT_FALSE(uncompressor.Append(compressed));
+    EXPECT_FALSE(uncompressor.IsFinished());
+}
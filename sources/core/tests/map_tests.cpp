@@ -56,3 +56,84 @@ TEST(Map, Resize)
     }
 }
 
+
+TEST(Map, Opacity)
+{
+    Map map;
+    map.Resize(3, 4, 2);
+
+    for (int z = 0; z < 2; ++z)
+    {
+        ASSERT_EQ(map.GetOpacity(z).size(), 3 * 4);
+        for (int x = 0; x < 3; ++x)
+        {
+            for (int y = 0; y < 4; ++y)
+            {
+                EXPECT_TRUE(map.Istransparent(x, y, z));
+            }
+        }
+    }
+
+    // There are no tiles, so nothing is opaque
+    map.UpdateOpacity(1, 1, 1);
+    EXPECT_TRUE(map.Istransparent(1, 1, 1));
+    // Positions outside of the map are ignored
+    map.UpdateOpacity(-1, 0, 0);
+    map.UpdateOpacity(0, 4, 0);
+    map.UpdateOpacity(0, 0, 2);
+
+    map.LoadOpacity();
+    EXPECT_EQ(map.GetOpacity(1).count(true), 0);
+}
+
+TEST(Map, CalculateLos)
+{
+    Map map;
+    map.Resize(30, 30, 1);
+
+    VisiblePoints points;
+    map.CalculateLos(&points, 15, 15, 0);
+    EXPECT_EQ(points.size(), 24 * 24);
+
+    // The cached result
+    VisiblePoints cached;
+    map.CalculateLos(&cached, 15, 15, 0);
+    EXPECT_EQ(cached, points);
+
+    map.RemoveUnusedLos();
+    map.RemoveUnusedLos();
+    map.CalculateLos(&cached, 15, 15, 0);
+    EXPECT_EQ(cached, points);
+
+    VisiblePoints nothing;
+    map.CalculateLos(&nothing, 15, 15, 1);
+    EXPECT_TRUE(nothing.isEmpty());
+}
+
+TEST(Map, SetLosEngine)
+{
+    Map map;
+    map.Resize(30, 30, 1);
+
+    // Ray tracing is the default
+    VisiblePoints ray_tracing;
+    map.CalculateLos(&ray_tracing, 3, 15, 0);
+    VisiblePoints expected;
+    LosCalculator(30, 30, map.GetOpacity(0)).Calculate(&expected, 3, 15, 0);
+    EXPECT_EQ(ray_tracing, expected);
+
+    map.SetLosEngine(LosEngine::SHADOW_CASTING);
+    VisiblePoints shadow_casting;
+    map.CalculateLos(&shadow_casting, 3, 15, 0);
+    expected.clear();
+    ShadowCaster(30, 30, map.GetOpacity(0)).Calculate(&expected, 3, 15, 0);
+    EXPECT_EQ(shadow_casting, expected);
+    // The engines list the points in different orders,
+    // so the cached result of the other engine would be noticed
+    EXPECT_NE(shadow_casting, ray_tracing);
+
+    map.SetLosEngine(LosEngine::RAY_TRACING);
+    VisiblePoints again;
+    map.CalculateLos(&again, 3, 15, 0);
+    EXPECT_EQ(again, ray_tracing);
+}
@@ -14,6 +14,7 @@
 #include "objects/test/TestObject.h"
 #include "objects/test/UnsyncGenerator.h"
 #include "objects/GlobalObjectsHolder.h"
+#include "atmos/AtmosGrid.h"
 
 using ::testing::ReturnRef;
 using ::testing::Return;
@@ -37,9 +38,6 @@ TEST(ObjectFactoryDeathTest, CreateImplFailAdd)
     MockIGame game;
     ObjectFactory factory(&game);
 
-    // TODO: proper cast table initialization
-    InitCastTable();
-
     ASSERT_DEATH(
     {
         quint32 id = factory.CreateImpl(MapObject::GetTypeStatic());
@@ -62,6 +60,7 @@ TEST(ObjectFactory, CreateImpl)
 {
     MockIGame game;
     MockIAtmosphere atmos;
+    MockIMap map;
     ObjectFactory factory(&game);
     {
         quint32 id = factory.CreateImpl(kv::Object::GetTypeStatic());
@@ -95,6 +94,9 @@ TEST(ObjectFactory, CreateImpl)
         EXPECT_CALL(game, GetAtmosphere())
             .WillOnce(ReturnRef(atmos));
         EXPECT_CALL(atmos, SetFlags(0, 0, 0, '\0'));
+        EXPECT_CALL(game, GetMap())
+            .WillOnce(ReturnRef(map));
+        EXPECT_CALL(map, UpdateOpacity(0, 0, 0));
         quint32 id2 = factory.CreateImpl(MaterialObject::GetTypeStatic(), id);
         EXPECT_EQ(id2, 4);
         {
@@ -108,7 +110,11 @@ TEST(ObjectFactory, CreateImpl)
 
         EXPECT_CALL(game, GetAtmosphere())
             .WillOnce(ReturnRef(atmos));
-        EXPECT_CALL(atmos, SetFlags(0, 0, 0, '\0'));
+        // The turf is the floor of the tile
+        EXPECT_CALL(atmos, SetFlags(0, 0, 0, atmos::ZDOWN_BLOCK));
+        EXPECT_CALL(game, GetMap())
+            .WillOnce(ReturnRef(map));
+        EXPECT_CALL(map, UpdateOpacity(0, 0, 0));
         quint32 id3 = factory.CreateImpl(Turf::GetTypeStatic(), id);
         EXPECT_EQ(id3, 5);
         {
@@ -259,6 +265,67 @@ TEST(ObjectFactory, DeleteLater)
     }
 }
 
+TEST(ObjectFactory, RecycleIds)
+{
+    MockIGame game;
+    ObjectFactory factory(&game);
+    factory.FinishWorldCreation();
+
+    IdPtr<TestObject> first = factory.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> second = factory.CreateImpl(TestObject::GetTypeStatic());
+    ASSERT_EQ(first.Id(), 1);
+    ASSERT_EQ(second.Id(), 2);
+
+    factory.DeleteLater(first.Id());
+    // Ids are not reused until the objects are actually deleted
+    EXPECT_TRUE(factory.GetFreeIds().isEmpty());
+    factory.ProcessDeletion();
+    EXPECT_EQ(factory.GetFreeIds(), QVector<quint32>({kv::MakeId(1, 1)}));
+
+    IdPtr<TestObject> third = factory.CreateImpl(TestObject::GetTypeStatic());
+    EXPECT_EQ(third.Id(), kv::MakeId(1, 1));
+    EXPECT_EQ(kv::IdIndex(third.Id()), 1);
+    EXPECT_TRUE(factory.GetFreeIds().isEmpty());
+    EXPECT_EQ(factory.GetId(), 3);
+
+    // The old id does not resolve to the new object
+    IdPtr<TestObject> stale = first.Id();
+    EXPECT_FALSE(stale.IsValid());
+    EXPECT_TRUE(third.IsValid());
+    EXPECT_EQ(factory.GetIdTable()[1].object, third.operator->());
+
+    // Deletion by the old id does nothing
+    factory.DeleteLater(first.Id());
+    factory.ProcessDeletion();
+    EXPECT_TRUE(third.IsValid());
+
+    factory.DeleteLater(third.Id());
+    factory.ProcessDeletion();
+    EXPECT_EQ(factory.GetFreeIds(), QVector<quint32>({kv::MakeId(1, 2)}));
+}
+
+TEST(ObjectFactory, CachedPointersAfterClear)
+{
+    MockIGame game;
+    ObjectFactory factory(&game);
+    factory.FinishWorldCreation();
+
+    IdPtr<TestObject> old_object = factory.CreateImpl(TestObject::GetTypeStatic());
+    ASSERT_EQ(old_object.Id(), 1);
+    // The pointer is cached now
+    ASSERT_TRUE(old_object.IsValid());
+
+    factory.Clear();
+    EXPECT_FALSE(old_object.IsValid());
+
+    // The same id with the same generation is given to the new object
+    IdPtr<TestObject> new_object = factory.CreateImpl(TestObject::GetTypeStatic());
+    ASSERT_EQ(new_object.Id(), old_object.Id());
+    ASSERT_TRUE(old_object.IsValid());
+    EXPECT_EQ(old_object.operator->(), factory.GetIdTable()[1].object);
+    EXPECT_EQ(old_object.operator->(), new_object.operator->());
+}
+
 TEST(ObjectFactory, Hash)
 {
     MockIGame game;
@@ -289,6 +356,45 @@ TEST(ObjectFactory, Hash)
     EXPECT_EQ(factory.Hash(), 2);
 }
 
+TEST(ObjectFactory, HashOnlyChangedObjects)
+{
+    MockIGame game;
+    ObjectFactory factory(&game);
+
+    IdPtr<TestObject> first = factory.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> second = factory.CreateImpl(TestObject::GetTypeStatic());
+    const quint32 hash = factory.Hash();
+    EXPECT_EQ(hash, 3);
+
+    // Changes without IdPtr are not noticed until the object is marked
+    TestObject* raw_second = static_cast<TestObject*>(factory.GetIdTable()[2].object);
+    raw_second->process_ = 10;
+    EXPECT_EQ(factory.Hash(), hash);
+    EXPECT_EQ(factory.HashFull(), hash + 10);
+    MarkObjectChanged(&factory.GetIdTable(), second.Id());
+    EXPECT_EQ(factory.Hash(), hash + 10);
+
+    raw_second->process_ = 20;
+    factory.MarkAllObjectsChanged();
+    EXPECT_EQ(factory.Hash(), hash + 20);
+    raw_second->process_ = 10;
+    factory.MarkAllObjectsChanged();
+    EXPECT_EQ(factory.Hash(), hash + 10);
+
+    first->process_ = 5;
+    EXPECT_EQ(factory.Hash(), hash + 15);
+
+    // Only const access
+    const IdPtr<TestObject>& const_first = first;
+    EXPECT_EQ(const_first->process_, 5);
+    EXPECT_FALSE(factory.GetIdTable()[first.Id()].changed);
+    EXPECT_EQ(factory.GetIdTable()[0].next_changed, 0);
+
+    factory.DeleteLater(first.Id());
+    EXPECT_EQ(factory.Hash(), hash + 15 - 1 - 5);
+    factory.ProcessDeletion();
+}
+
 TEST(ObjectFactory, Hearer)
 {
     MockIGame game;
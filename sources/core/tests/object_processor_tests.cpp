@@ -2,6 +2,8 @@
 
 #include "objects/ObjectProcessor.h"
 
+#include "AutogenMetadata.h"
+
 #include "ObjectFactory.h"
 #include "objects/test/TestObject.h"
 #include "objects/GlobalObjectsHolder.h"
@@ -10,6 +12,8 @@
 
 #include <QDebug>
 
+#include <algorithm>
+
 using namespace kv;
 
 using ::testing::Return;
@@ -21,9 +25,6 @@ public:
     ObjectProcessorTest()
         : factory_(&game_)
     {
-        // TODO: proper cast table initialization
-        InitCastTable();
-
         factory_.FinishWorldCreation();
 
         globals_ = factory_.CreateImpl(GlobalObjectsHolder::GetTypeStatic());
@@ -36,6 +37,11 @@ public:
             .WillRepeatedly(ReturnRef(factory_));
     }
 protected:
+    void NextTick()
+    {
+        globals_->game_tick += 1;
+    }
+
     MockIGame game_;
     ObjectFactory factory_;
     IdPtr<GlobalObjectsHolder> globals_;
@@ -58,35 +64,237 @@ TEST_F(ObjectProcessorTest, SimpleProcess)
     IdPtr<TestObject> object = factory_.CreateImpl(TestObject::GetTypeStatic());
     int value1 = 0;
     object->SetProcessCallback([&value1]() { ++value1; });
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 0);
 
-    // TODO (?): remove all Add cause SetFreq will call them anyway
+    // Objects without frequency are not scheduled
     processor->Add(object.Id());
-    EXPECT_EQ(processor->HashMembers(), 5);
-    processor->Add(object.Id());
-    EXPECT_EQ(processor->HashMembers(), 5);
+    EXPECT_EQ(processor->HashMembers(), 2);
 
+    // Due on the next tick
     object->SetFreq(1);
+    EXPECT_EQ(processor->HashMembers(), 2 + (3 + 1) * (3 + 3));
+    processor->Add(object.Id());
+    EXPECT_EQ(processor->HashMembers(), 2 + (3 + 1) * (3 + 3));
+
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 1);
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 2);
-    EXPECT_EQ(processor->HashMembers(), 5);
+    EXPECT_EQ(processor->HashMembers(), 2 + (5 + 1) * (3 + 5));
 
     object->SetFreq(0);
+    EXPECT_EQ(processor->HashMembers(), 2);
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 2);
-    EXPECT_EQ(processor->HashMembers(), 2);
 
     object->SetFreq(1);
     processor->Add(object.Id());
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 3);
 
     factory_.DeleteLater(object.Id());
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 3);
+    EXPECT_EQ(processor->HashMembers(), 2);
+}
+
+TEST_F(ObjectProcessorTest, ProcessOnlyDueObjects)
+{
+    IdPtr<ObjectProcessor> processor = factory_.CreateImpl(ObjectProcessor::GetTypeStatic());
+
+    EXPECT_CALL(game_, GetProcessor())
+        .WillRepeatedly(ReturnRef(*processor));
+
+    IdPtr<TestObject> object1 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> object2 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    QVector<qint32> ticks1;
+    QVector<qint32> ticks2;
+    object1->SetProcessCallback([&]() { ticks1.append(globals_->game_tick); });
+    object2->SetProcessCallback([&]() { ticks2.append(globals_->game_tick); });
+
+    object1->SetFreq(10);
+    // Longer than the wheel, so it waits for its round
+    object2->SetFreq(ObjectProcessor::WHEEL_SIZE + 36);
+
+    while (globals_->game_tick < 300)
+    {
+        NextTick();
+        processor->RunProcess();
+    }
+
+    QVector<qint32> expected1;
+    for (qint32 tick = 10; tick <= 300; tick += 10)
+    {
+        expected1.append(tick);
+    }
+    EXPECT_EQ(ticks1, expected1);
+    EXPECT_EQ(ticks2, QVector<qint32>({100, 200, 300}));
+}
+
+TEST_F(ObjectProcessorTest, FirstDueTickAfterAdd)
+{
+    IdPtr<ObjectProcessor> processor = factory_.CreateImpl(ObjectProcessor::GetTypeStatic());
+
+    EXPECT_CALL(game_, GetProcessor())
+        .WillRepeatedly(ReturnRef(*processor));
+
+    IdPtr<TestObject> aligned = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> aligned_processed = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> unaligned = factory_.CreateImpl(TestObject::GetTypeStatic());
+    QVector<qint32> ticks1;
+    QVector<qint32> ticks2;
+    QVector<qint32> ticks3;
+    aligned->SetProcessCallback([&]() { ticks1.append(globals_->game_tick); });
+    aligned_processed->SetProcessCallback([&]() { ticks2.append(globals_->game_tick); });
+    unaligned->SetProcessCallback([&]() { ticks3.append(globals_->game_tick); });
+
+    NextTick();
+    processor->RunProcess();
+
+    // The tick 3 is not processed yet, so it is the first due tick
+    NextTick();
+    aligned->SetFreq(3);
+    processor->RunProcess();
+    // And after the processing it is not anymore
+    aligned_processed->SetFreq(3);
+
+    NextTick();
+    unaligned->SetFreq(3);
+    processor->RunProcess();
+
+    while (globals_->game_tick < 9)
+    {
+        NextTick();
+        processor->RunProcess();
+    }
+
+    EXPECT_EQ(ticks1, QVector<qint32>({3, 6, 9}));
+    EXPECT_EQ(ticks2, QVector<qint32>({6, 9}));
+    EXPECT_EQ(ticks3, QVector<qint32>({6, 9}));
+}
+
+TEST_F(ObjectProcessorTest, ProcessSortedById)
+{
+    IdPtr<ObjectProcessor> processor = factory_.CreateImpl(ObjectProcessor::GetTypeStatic());
+
+    EXPECT_CALL(game_, GetProcessor())
+        .WillRepeatedly(ReturnRef(*processor));
+
+    IdPtr<TestObject> object1 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> object2 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestObject> object3 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    QVector<quint32> order;
+    object1->SetProcessCallback([&]() { order.append(object1.Id()); });
+    object2->SetProcessCallback([&]() { order.append(object2.Id()); });
+    object3->SetProcessCallback([&]() { order.append(object3.Id()); });
+
+    object3->SetFreq(1);
+    object1->SetFreq(1);
+    object2->SetFreq(1);
+
+    NextTick();
+    processor->RunProcess();
+    EXPECT_EQ(order, QVector<quint32>({object1.Id(), object2.Id(), object3.Id()}));
+}
+
+TEST(ObjectProcessor, LanesOrderedByTypeNames)
+{
+    // Lanes are sorted by this order instead of the type indexes,
+    // which depend on the order of the generated metadata
+    const std::vector<VoidItemCreatorInfo>& creators = *GetVoidItemsCreators();
+    const std::vector<int>& order = GetTypesNameOrder();
+    ASSERT_EQ(order.size(), creators.size());
+
+    QVector<QString> names_by_order(static_cast<int>(creators.size()));
+    for (int type_index = 0; type_index < static_cast<int>(creators.size()); ++type_index)
+    {
+        ASSERT_GE(order[type_index], 0);
+        ASSERT_LT(order[type_index], names_by_order.size());
+        ASSERT_TRUE(names_by_order[order[type_index]].isEmpty());
+        names_by_order[order[type_index]] = creators[type_index].type;
+    }
+    EXPECT_TRUE(std::is_sorted(names_by_order.begin(), names_by_order.end()));
+    EXPECT_LT(
+        order[TestHearer::GetTypeIndexStatic()],
+        order[TestObject::GetTypeIndexStatic()]);
+}
+
+TEST_F(ObjectProcessorTest, BatchLane)
+{
+    IdPtr<ObjectProcessor> processor = factory_.CreateImpl(ObjectProcessor::GetTypeStatic());
+
+    EXPECT_CALL(game_, GetProcessor())
+        .WillRepeatedly(ReturnRef(*processor));
+
+    // Ids are interleaved, but the objects are processed by lanes
+    IdPtr<TestObject> object1 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestBatchObject> batch1 = factory_.CreateImpl(TestBatchObject::GetTypeStatic());
+    IdPtr<TestObject> object2 = factory_.CreateImpl(TestObject::GetTypeStatic());
+    IdPtr<TestBatchObject> batch2 = factory_.CreateImpl(TestBatchObject::GetTypeStatic());
+    IdPtr<TestBatchObject> batch3 = factory_.CreateImpl(TestBatchObject::GetTypeStatic());
+    EXPECT_LT(
+        GetTypesNameOrder()[TestBatchObject::GetTypeIndexStatic()],
+        GetTypesNameOrder()[TestObject::GetTypeIndexStatic()]);
+
+    QVector<quint32> order;
+    QVector<QVector<quint32>> batches;
+    TestBatchObject::SetBatchCallback([&](const QVector<Object*>& objects)
+    {
+        QVector<quint32> batch;
+        for (Object* object : objects)
+        {
+            batch.append(object->GetId());
+        }
+        batches.append(batch);
+    });
+    object1->SetProcessCallback([&]() { order.append(object1.Id()); });
+    object2->SetProcessCallback([&]() { order.append(object2.Id()); });
+    // Removes the object from the later lane during the same tick
+    batch1->SetProcessCallback(
+    [&]()
+    {
+        order.append(batch1.Id());
+        processor->Remove(object1.Id());
+    });
+    batch2->SetProcessCallback([&]() { order.append(batch2.Id()); });
+    batch3->SetProcessCallback([&]() { order.append(batch3.Id()); });
+
+    object2->SetFreq(1);
+    object1->SetFreq(1);
+    batch3->SetFreq(1);
+    batch1->SetFreq(1);
+    batch2->SetFreq(1);
+
+    NextTick();
+    processor->RunProcess();
+    EXPECT_EQ(order, QVector<quint32>({batch1.Id(), batch2.Id(), batch3.Id(), object2.Id()}));
+    EXPECT_EQ(
+        batches,
+        QVector<QVector<quint32>>({QVector<quint32>({batch1.Id(), batch2.Id(), batch3.Id()})}));
+    EXPECT_EQ(object1->process_, 0);
+    EXPECT_EQ(object2->process_, 1);
+    EXPECT_EQ(batch1->process_, 1);
+    EXPECT_EQ(batch2->process_, 1);
+    EXPECT_EQ(batch3->process_, 1);
+
+    order.clear();
+    batches.clear();
+    NextTick();
+    processor->RunProcess();
+    EXPECT_EQ(order, QVector<quint32>({batch1.Id(), batch2.Id(), batch3.Id(), object2.Id()}));
+    EXPECT_EQ(batches.size(), 1);
+    EXPECT_EQ(object1->process_, 0);
+    EXPECT_EQ(object2->process_, 2);
+    EXPECT_EQ(batch3->process_, 2);
+
+    TestBatchObject::SetBatchCallback([](const QVector<Object*>&){});
 }
 
 TEST_F(ObjectProcessorTest, AddAndRemoveDuringProcess)
@@ -122,16 +330,19 @@ TEST_F(ObjectProcessorTest, AddAndRemoveDuringProcess)
         ++value3;
     });
 
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 1);
     EXPECT_EQ(value2, 0);
     EXPECT_EQ(value3, 0);
 
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 2);
     EXPECT_EQ(value2, 1);
     EXPECT_EQ(value3, 0);
 
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 3);
     EXPECT_EQ(value2, 2);
@@ -140,6 +351,7 @@ TEST_F(ObjectProcessorTest, AddAndRemoveDuringProcess)
     object3->SetFreq(1);
     processor->Add(object3.Id());
 
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 4);
     EXPECT_EQ(value2, 3);
@@ -154,11 +366,13 @@ TEST_F(ObjectProcessorTest, AddAndRemoveDuringProcess)
         object3->SetFreq(0);
     });
 
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 5);
     EXPECT_EQ(value2, 4);
     EXPECT_EQ(value3, 1);
 
+    NextTick();
     processor->RunProcess();
     EXPECT_EQ(value1, 5);
     EXPECT_EQ(value2, 4);
@@ -168,13 +382,22 @@ TEST_F(ObjectProcessorTest, AddAndRemoveDuringProcess)
 namespace
 {
 
-const QByteArray SAVED_DATA
-    = QByteArray(
-        "\x06\x02\x0F\x00\x00\x00\x4F\x00\x62\x00\x6A\x00\x65\x00\x63"
-        "\x00\x74\x00\x50\x00\x72\x00\x6F\x00\x63\x00\x65\x00\x73\x00"
-        "\x73\x00\x6F\x00\x72\x00\x03\x02\x00\x00\x00\x02\x00\x00\x00"
-        "\x00\x02\x03\x00\x00\x00\x03\x03\x00\x00\x00\x03\x04\x00\x00"
-        "\x00\x03\x05\x00\x00\x00", 66);
+// Processor with id 2 and objects 3, 4, 5 due on the tick 2
+QByteArray MakeSavedData()
+{
+    kv::FastSerializer serializer(1);
+    serializer.WriteTypeIndex(ObjectProcessor::GetTypeIndexStatic());
+    serializer << 2u;
+    serializer << 0;
+
+    QVector<QVector<QPair<quint32, qint32>>> wheel(ObjectProcessor::WHEEL_SIZE);
+    wheel[2] = {{3, 2}, {4, 2}, {5, 2}};
+    serializer << wheel;
+
+    return QByteArray(serializer.GetData(), static_cast<int>(serializer.GetIndex()));
+}
+
+const unsigned int SAVED_HASH = 2 + (2 + 1) * ((3 + 2) + 2 * (4 + 2) + 3 * (5 + 2));
 
 }
 
@@ -182,49 +405,67 @@ TEST_F(ObjectProcessorTest, Save)
 {
     IdPtr<ObjectProcessor> processor = factory_.CreateImpl(ObjectProcessor::GetTypeStatic());
 
+    EXPECT_CALL(game_, GetProcessor())
+        .WillRepeatedly(ReturnRef(*processor));
+
     IdPtr<TestObject> object1 = factory_.CreateImpl(TestObject::GetTypeStatic());
     IdPtr<TestObject> object2 = factory_.CreateImpl(TestObject::GetTypeStatic());
     IdPtr<TestObject> object3 = factory_.CreateImpl(TestObject::GetTypeStatic());
 
-    processor->Add(object1.Id());
-    processor->Add(object2.Id());
-    processor->Add(object3.Id());
+    object1->SetFreq(1);
+    object2->SetFreq(1);
+    object3->SetFreq(1);
 
-    EXPECT_EQ(processor->HashMembers(), 28);
+    EXPECT_EQ(processor->HashMembers(), SAVED_HASH);
 
     kv::FastSerializer serializer(1);
     processor->Save(serializer);
 
     EXPECT_EQ(
         QByteArray(serializer.GetData(), static_cast<int>(serializer.GetIndex())),
-        SAVED_DATA);
+        MakeSavedData());
 }
 
 TEST_F(ObjectProcessorTest, Load)
 {
+    const QByteArray saved_data = MakeSavedData();
+
     kv::FastDeserializer deserializer(
-        SAVED_DATA.data(), static_cast<quint32>(SAVED_DATA.size()));
+        saved_data.data(), static_cast<quint32>(saved_data.size()));
 
-    QString type;
-    deserializer.ReadType(&type);
-    ASSERT_EQ(type, ObjectProcessor::GetTypeStatic());
+    quint32 type_index;
+    deserializer.ReadTypeIndex(&type_index);
+    ASSERT_EQ(type_index, static_cast<quint32>(ObjectProcessor::GetTypeIndexStatic()));
     quint32 id_loc;
     deserializer >> id_loc;
 
-    factory_.CreateVoid(ObjectProcessor::GetTypeStatic(), id_loc);
+    factory_.CreateVoid(ObjectProcessor::GetTypeIndexStatic(), id_loc);
     IdPtr<ObjectProcessor> processor = id_loc;
 
+    EXPECT_CALL(game_, GetProcessor())
+        .WillRepeatedly(ReturnRef(*processor));
+
     IdPtr<TestObject> object1 = factory_.CreateImpl(TestObject::GetTypeStatic());
     IdPtr<TestObject> object2 = factory_.CreateImpl(TestObject::GetTypeStatic());
     IdPtr<TestObject> object3 = factory_.CreateImpl(TestObject::GetTypeStatic());
 
     processor->Load(deserializer);
 
-    EXPECT_EQ(processor->HashMembers(), 28);
+    EXPECT_EQ(processor->HashMembers(), SAVED_HASH);
 
-    processor->Add(object1.Id());
-    processor->Add(object2.Id());
-    processor->Add(object3.Id());
+    // The loaded objects schedule themselves again
+    object1->SetFreq(1);
+    object2->SetFreq(1);
+    object3->SetFreq(1);
+
+    EXPECT_EQ(processor->HashMembers(), SAVED_HASH);
 
-    EXPECT_EQ(processor->HashMembers(), 28);
+    int processed = 0;
+    for (auto object : {object1, object2, object3})
+    {
+        object->SetProcessCallback([&processed]() { ++processed; });
+    }
+    NextTick();
+    processor->RunProcess();
+    EXPECT_EQ(processed, 3);
 }
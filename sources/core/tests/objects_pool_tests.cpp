@@ -0,0 +1,46 @@
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <cstring>
+
+#include "ObjectsPool.h"
+
+using namespace kv::internal;
+
+TEST(ObjectsPool, AllocateAndDeallocate)
+{
+    const std::size_t SIZE = 40;
+
+    char* first = static_cast<char*>(AllocateObject(SIZE));
+    char* second = static_cast<char*>(AllocateObject(SIZE));
+    ASSERT_NE(first, nullptr);
+    ASSERT_NE(second, nullptr);
+    EXPECT_NE(first, second);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(first) % alignof(std::max_align_t), 0u);
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(second) % alignof(std::max_align_t), 0u);
+
+    DeallocateObject(second, SIZE);
+    // The last freed chunk is reused first
+    char* third = static_cast<char*>(AllocateObject(SIZE));
+    EXPECT_EQ(third, second);
+
+    DeallocateObject(first, SIZE);
+    DeallocateObject(third, SIZE);
+    DeallocateObject(nullptr, SIZE);
+    ReleaseObjectsPools();
+}
+
+TEST(ObjectsPool, DifferentSizes)
+{
+    void* small = AllocateObject(8);
+    void* big = AllocateObject(1000);
+    EXPECT_NE(small, big);
+
+    // Pool with an alive object is not released
+    DeallocateObject(small, 8);
+    ReleaseObjectsPools();
+    std::memset(big, 0, 1000);
+
+    DeallocateObject(big, 1000);
+    ReleaseObjectsPools();
+}
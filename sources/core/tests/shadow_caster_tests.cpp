@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+
+#include <QElapsedTimer>
+#include <QSet>
+
+#include <iostream>
+
+#include "LosCalculator.h"
+#include "ShadowCaster.h"
+
+using namespace kv;
+
+namespace
+{
+
+const int WIDTH = 40;
+const int HEIGHT = 40;
+
+class Layout
+{
+public:
+    Layout()
+    {
+        opacity_.resize(WIDTH * HEIGHT);
+    }
+    void SetOpaque(int x, int y, bool opaque = true)
+    {
+        opacity_.setBit(x + y * WIDTH, opaque);
+    }
+    const QBitArray& GetOpacity() const
+    {
+        return opacity_;
+    }
+    QSet<Position> ShadowCast(int x, int y) const
+    {
+        VisiblePoints points;
+        ShadowCaster(WIDTH, HEIGHT, opacity_).Calculate(&points, x, y);
+        return ToSet(points);
+    }
+    QSet<Position> RayTrace(int x, int y) const
+    {
+        VisiblePoints points;
+        LosCalculator(WIDTH, HEIGHT, opacity_).Calculate(&points, x, y);
+        return ToSet(points);
+    }
+private:
+    static QSet<Position> ToSet(const VisiblePoints& points)
+    {
+        QSet<Position> retval;
+        for (const Position& point : points)
+        {
+            retval.insert(point);
+        }
+        // No duplicates
+        EXPECT_EQ(retval.size(), points.size());
+        return retval;
+    }
+    QBitArray opacity_;
+};
+
+Layout MakeRoom()
+{
+    Layout layout;
+    for (int x = 16; x <= 24; ++x)
+    {
+        layout.SetOpaque(x, 17);
+        layout.SetOpaque(x, 23);
+    }
+    for (int y = 17; y <= 23; ++y)
+    {
+        layout.SetOpaque(16, y);
+        layout.SetOpaque(24, y);
+    }
+    return layout;
+}
+
+}
+
+TEST(ShadowCaster, Empty)
+{
+    Layout layout;
+    EXPECT_EQ(layout.ShadowCast(20, 20), layout.RayTrace(20, 20));
+    EXPECT_EQ(layout.ShadowCast(20, 20).size(), 24 * 24);
+
+    EXPECT_EQ(layout.ShadowCast(0, 0), layout.RayTrace(0, 0));
+    EXPECT_EQ(layout.ShadowCast(0, 0).size(), 12 * 12);
+}
+
+TEST(ShadowCaster, Walls)
+{
+    {
+        Layout layout;
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            layout.SetOpaque(23, y);
+        }
+        EXPECT_EQ(layout.ShadowCast(20, 20), layout.RayTrace(20, 20));
+        EXPECT_TRUE(layout.ShadowCast(20, 20).contains({23, 30, 0}));
+        EXPECT_FALSE(layout.ShadowCast(20, 20).contains({24, 20, 0}));
+    }
+    {
+        Layout layout;
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            layout.SetOpaque(x, 16);
+        }
+        EXPECT_EQ(layout.ShadowCast(20, 20), layout.RayTrace(20, 20));
+    }
+    {
+        Layout layout;
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            layout.SetOpaque(x, 19);
+            layout.SetOpaque(x, 21);
+        }
+        EXPECT_EQ(layout.ShadowCast(20, 20), layout.RayTrace(20, 20));
+        EXPECT_EQ(layout.ShadowCast(20, 20).size(), 3 * 24);
+    }
+}
+
+TEST(ShadowCaster, Room)
+{
+    const Layout layout = MakeRoom();
+    EXPECT_EQ(layout.ShadowCast(20, 20), layout.RayTrace(20, 20));
+    EXPECT_EQ(layout.ShadowCast(18, 21), layout.RayTrace(18, 21));
+    // The room with its walls
+    EXPECT_EQ(layout.ShadowCast(20, 20).size(), 9 * 7);
+}
+
+TEST(ShadowCaster, Symmetry)
+{
+    Layout layout = MakeRoom();
+    layout.SetOpaque(24, 20, false);
+    layout.SetOpaque(28, 18);
+    layout.SetOpaque(27, 24);
+
+    const Position viewer(20, 20, 0);
+    const QSet<Position> visible = layout.ShadowCast(viewer.x, viewer.y);
+    for (const Position& point : visible)
+    {
+        if (layout.GetOpacity().testBit(point.x + point.y * WIDTH))
+        {
+            continue;
+        }
+        EXPECT_TRUE(layout.ShadowCast(point.x, point.y).contains(viewer))
+            << point.x << " " << point.y;
+    }
+}
+
+TEST(ShadowCaster, OutsideOfMap)
+{
+    Layout layout;
+    VisiblePoints points;
+    ShadowCaster(WIDTH, HEIGHT, layout.GetOpacity()).Calculate(&points, -1, 5);
+    EXPECT_TRUE(points.isEmpty());
+    ShadowCaster(WIDTH, HEIGHT, layout.GetOpacity()).Calculate(&points, 5, HEIGHT);
+    EXPECT_TRUE(points.isEmpty());
+}
+
+// Ray tracing is the default engine of the map and shadowcasting is chosen
+// through Map::SetLosEngine. Both engines agree next to the viewer,
+// but differ behind the corners of the walls
+TEST(ShadowCaster, DiffersFromRayTracingBehindCorners)
+{
+    {
+        Layout layout;
+        layout.SetOpaque(22, 20);
+        const QSet<Position> shadow_casting = layout.ShadowCast(20, 20);
+        const QSet<Position> ray_tracing = layout.RayTrace(20, 20);
+
+        // The shadow of a pillar is wider with ray tracing
+        EXPECT_EQ(
+            shadow_casting - ray_tracing,
+            QSet<Position>({{24, 19, 0}, {26, 18, 0}, {27, 18, 0}, {28, 18, 0},
+                            {28, 17, 0}, {29, 17, 0}, {30, 17, 0}, {31, 17, 0},
+                            {30, 16, 0}, {31, 16, 0},
+                            {24, 21, 0}, {26, 22, 0}, {27, 22, 0}, {28, 22, 0},
+                            {28, 23, 0}, {29, 23, 0}, {30, 23, 0}, {31, 23, 0},
+                            {30, 24, 0}, {31, 24, 0}}));
+        EXPECT_TRUE((ray_tracing - shadow_casting).isEmpty());
+        EXPECT_FALSE(shadow_casting.contains({23, 20, 0}));
+    }
+    {
+        Layout layout;
+        layout.SetOpaque(22, 21);
+        const QSet<Position> shadow_casting = layout.ShadowCast(20, 20);
+        const QSet<Position> ray_tracing = layout.RayTrace(20, 20);
+
+        // Ray tracing is not symmetric, so it sees a part of the tiles
+        // right behind the corner and hides a line further
+        EXPECT_EQ(
+            ray_tracing - shadow_casting,
+            QSet<Position>({{23, 21, 0}, {23, 22, 0}, {26, 22, 0}, {27, 22, 0},
+                            {30, 23, 0}, {31, 23, 0}}));
+        EXPECT_EQ(
+            shadow_casting - ray_tracing,
+            QSet<Position>({{28, 26, 0}, {29, 27, 0}, {30, 28, 0}, {31, 29, 0}}));
+    }
+}
+
+TEST(ShadowCaster, RandomLayoutsComparedToRayTracing)
+{
+    qsrand(4242);
+
+    const int LAYOUTS = 200;
+    for (int i = 0; i < LAYOUTS; ++i)
+    {
+        Layout layout;
+        for (int x = 0; x < WIDTH; ++x)
+        {
+            for (int y = 0; y < HEIGHT; ++y)
+            {
+                layout.SetOpaque(x, y, qrand() % 10 == 0);
+            }
+        }
+        const Position viewer(qrand() % WIDTH, qrand() % HEIGHT, 0);
+        layout.SetOpaque(viewer.x, viewer.y, false);
+
+        const QSet<Position> shadow_casting = layout.ShadowCast(viewer.x, viewer.y);
+        const QSet<Position> ray_tracing = layout.RayTrace(viewer.x, viewer.y);
+        ASSERT_TRUE(shadow_casting.contains(viewer));
+        ASSERT_TRUE(ray_tracing.contains(viewer));
+
+        QSet<Position> all = shadow_casting;
+        all.unite(ray_tracing);
+        for (const Position& point : all)
+        {
+            if (shadow_casting.contains(point) == ray_tracing.contains(point))
+            {
+                continue;
+            }
+            EXPECT_TRUE(qAbs(point.x - viewer.x) > 1 || qAbs(point.y - viewer.y) > 1)
+                << point.x << " " << point.y << " from " << viewer.x << " " << viewer.y;
+        }
+    }
+}
+
+// Run with --gtest_also_run_disabled_tests
+TEST(ShadowCaster, DISABLED_Benchmark)
+{
+    Layout layout;
+    qsrand(42);
+    for (int x = 0; x < WIDTH; ++x)
+    {
+        for (int y = 0; y < HEIGHT; ++y)
+        {
+            layout.SetOpaque(x, y, qrand() % 10 == 0);
+        }
+    }
+
+    const int ITERATIONS = 10000;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        VisiblePoints points;
+        LosCalculator(WIDTH, HEIGHT, layout.GetOpacity()).Calculate(&points, 20, 20);
+    }
+    const qint64 ray_tracing_ns = timer.nsecsElapsed();
+
+    timer.start();
+    for (int i = 0; i < ITERATIONS; ++i)
+    {
+        VisiblePoints points;
+        ShadowCaster(WIDTH, HEIGHT, layout.GetOpacity()).Calculate(&points, 20, 20);
+    }
+    const qint64 shadow_casting_ns = timer.nsecsElapsed();
+
+    std::cout << WIDTH << "x" << HEIGHT << " map, 10% walls" << std::endl;
+    std::cout << "Ray tracing: " << ray_tracing_ns / ITERATIONS << " ns per viewer" << std::endl;
+    std::cout << "Shadowcasting: " << shadow_casting_ns / ITERATIONS << " ns per viewer" << std::endl;
+}
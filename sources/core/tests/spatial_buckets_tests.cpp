@@ -0,0 +1,64 @@
+#include "SpatialBuckets.h"
+
+#include <gtest/gtest.h>
+
+#include <QString>
+
+using namespace kv;
+
+namespace
+{
+    QString Collect(const SpatialBuckets<QString>& buckets, const QVector<Position>& points)
+    {
+        QString retval;
+        buckets.ForEachOn(points, [&retval](const QString& value)
+        {
+            retval += value;
+        });
+        return retval;
+    }
+}
+
+TEST(SpatialBuckets, Empty)
+{
+    SpatialBuckets<QString> buckets;
+    EXPECT_TRUE(buckets.IsEmpty());
+    EXPECT_EQ(Collect(buckets, {{0, 0, 0}, {1, 1, 0}}), "");
+
+    buckets.Add({1, 1, 0}, "a");
+    EXPECT_FALSE(buckets.IsEmpty());
+    EXPECT_EQ(Collect(buckets, {}), "");
+
+    buckets.Clear();
+    EXPECT_TRUE(buckets.IsEmpty());
+    EXPECT_EQ(Collect(buckets, {{1, 1, 0}}), "");
+}
+
+TEST(SpatialBuckets, ForEachOn)
+{
+    SpatialBuckets<QString> buckets;
+    buckets.Add({20, 20, 0}, "a");
+    buckets.Add({1, 1, 0}, "b");
+    buckets.Add({20, 20, 0}, "c");
+    buckets.Add({-3, 5, 0}, "d");
+    buckets.Add({100, 100, 0}, "e");
+    buckets.Add({1, 1, 1}, "f");
+
+    QVector<Position> window;
+    for (int x = -5; x < 25; ++x)
+    {
+        for (int y = 0; y < 25; ++y)
+        {
+            window.append({x, y, 0});
+        }
+    }
+    EXPECT_EQ(Collect(buckets, window), "acbd");
+
+    // Points spread over the map
+    EXPECT_EQ(Collect(buckets, {{1000, 1000, 0}, {100, 100, 0}, {1, 1, 0}}), "be");
+    EXPECT_EQ(Collect(buckets, {{1, 1, 1}}), "f");
+    EXPECT_EQ(Collect(buckets, {{2, 1, 0}}), "");
+
+    EXPECT_EQ(buckets.GetValues().size(), 5);
+    EXPECT_EQ(buckets.GetValues()[Position(20, 20, 0)].size(), 2);
+}
@@ -0,0 +1,166 @@
+#include <gtest/gtest.h>
+
+#include "TileGrid.h"
+#include "SaveableOperators.h"
+
+using namespace kv;
+
+namespace
+{
+    using NestedTiles = QVector<QVector<QVector<TileGrid::Tile>>>;
+
+    NestedTiles MakeNestedTiles(int width, int height, int depth)
+    {
+        NestedTiles retval(width);
+        for (int x = 0; x < width; ++x)
+        {
+            retval[x].resize(height);
+            for (int y = 0; y < height; ++y)
+            {
+                for (int z = 0; z < depth; ++z)
+                {
+                    retval[x][y].append(1 + x + y * 10 + z * 100);
+                }
+            }
+        }
+        return retval;
+    }
+}
+
+TEST(TileGrid, Resize)
+{
+    TileGrid grid;
+    EXPECT_EQ(grid.GetWidth(), 0);
+    EXPECT_EQ(grid.GetHeight(), 0);
+    EXPECT_EQ(grid.GetDepth(), 0);
+
+    grid.Resize(3, 4, 2);
+    ASSERT_EQ(grid.GetTiles().size(), 3 * 4 * 2);
+    EXPECT_EQ(grid.GetIndex(2, 1, 1), 2 + 1 * 3 + 1 * 3 * 4);
+
+    grid.At(2, 1, 1) = 42;
+    grid.At(0, 3, 0) = 43;
+    EXPECT_EQ(grid.GetTiles()[grid.GetIndex(2, 1, 1)].Id(), 42);
+
+    grid.Resize(5, 2, 3);
+    EXPECT_EQ(grid.GetWidth(), 5);
+    EXPECT_EQ(grid.GetHeight(), 2);
+    EXPECT_EQ(grid.GetDepth(), 3);
+    EXPECT_EQ(grid.At(2, 1, 1).Id(), 42);
+    int valid = 0;
+    for (const TileGrid::Tile& tile : grid.GetTiles())
+    {
+        valid += tile.Id() != 0 ? 1 : 0;
+    }
+    EXPECT_EQ(valid, 1);
+}
+
+TEST(TileGrid, GetNeighbour)
+{
+    TileGrid grid;
+    grid.Resize(3, 3, 2);
+    for (int z = 0; z < 2; ++z)
+    {
+        for (int y = 0; y < 3; ++y)
+        {
+            for (int x = 0; x < 3; ++x)
+            {
+                grid.At(x, y, z) = 1 + x + y * 10 + z * 100;
+            }
+        }
+    }
+
+    EXPECT_EQ(grid.GetNeighbour({1, 1, 0}, Dir::WEST).Id(), 1 + 0 + 10);
+    EXPECT_EQ(grid.GetNeighbour({1, 1, 0}, Dir::EAST).Id(), 1 + 2 + 10);
+    EXPECT_EQ(grid.GetNeighbour({1, 1, 0}, Dir::NORTH).Id(), 1 + 1 + 0);
+    EXPECT_EQ(grid.GetNeighbour({1, 1, 0}, Dir::SOUTH).Id(), 1 + 1 + 20);
+    EXPECT_EQ(grid.GetNeighbour({1, 1, 0}, Dir::UP).Id(), 1 + 1 + 10 + 100);
+    EXPECT_EQ(grid.GetNeighbour({1, 1, 1}, Dir::DOWN).Id(), 1 + 1 + 10);
+
+    // Borders of the map
+    EXPECT_EQ(grid.GetNeighbour({0, 0, 0}, Dir::WEST).Id(), 1);
+    EXPECT_EQ(grid.GetNeighbour({0, 0, 0}, Dir::NORTH).Id(), 1);
+    EXPECT_EQ(grid.GetNeighbour({0, 0, 0}, Dir::DOWN).Id(), 1);
+    EXPECT_EQ(grid.GetNeighbour({2, 2, 1}, Dir::EAST).Id(), 1 + 2 + 20 + 100);
+    EXPECT_EQ(grid.GetNeighbour({2, 2, 1}, Dir::SOUTH).Id(), 1 + 2 + 20 + 100);
+    EXPECT_EQ(grid.GetNeighbour({2, 2, 1}, Dir::UP).Id(), 1 + 2 + 20 + 100);
+}
+
+TEST(TileGrid, NestedFormat)
+{
+    const NestedTiles nested = MakeNestedTiles(4, 3, 2);
+
+    FastSerializer serializer(1);
+    serializer << nested;
+
+    FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+    TileGrid grid;
+    deserializer >> grid;
+    EXPECT_TRUE(deserializer.IsEnd());
+
+    ASSERT_EQ(grid.GetWidth(), 4);
+    ASSERT_EQ(grid.GetHeight(), 3);
+    ASSERT_EQ(grid.GetDepth(), 2);
+    for (int x = 0; x < 4; ++x)
+    {
+        for (int y = 0; y < 3; ++y)
+        {
+            for (int z = 0; z < 2; ++z)
+            {
+                EXPECT_EQ(grid.At(x, y, z).Id(), nested[x][y][z].Id());
+            }
+        }
+    }
+    EXPECT_EQ(Hash(grid), Hash(nested));
+
+    FastSerializer grid_serializer(1);
+    grid_serializer << grid;
+    ASSERT_EQ(grid_serializer.GetIndex(), serializer.GetIndex());
+    EXPECT_EQ(
+        QByteArray(grid_serializer.GetData(), grid_serializer.GetIndex()),
+        QByteArray(serializer.GetData(), serializer.GetIndex()));
+}
+
+TEST(TileGrid, EmptyNestedFormat)
+{
+    FastSerializer serializer(1);
+    serializer << NestedTiles();
+
+    FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+    TileGrid grid;
+    grid.Resize(2, 2, 2);
+    deserializer >> grid;
+
+    EXPECT_EQ(grid.GetWidth(), 0);
+    EXPECT_TRUE(grid.GetTiles().isEmpty());
+    EXPECT_EQ(Hash(grid), 0);
+}
+
+TEST(TileGridDeathTest, NotRectangular)
+{
+    NestedTiles nested = MakeNestedTiles(3, 3, 2);
+    nested[1].resize(2);
+
+    FastSerializer serializer(1);
+    serializer << nested;
+
+    EXPECT_DEATH(
+    {
+        FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+        TileGrid grid;
+        deserializer >> grid;
+    }, "Map column 1 has height 2 instead of 3");
+
+    nested = MakeNestedTiles(3, 3, 2);
+    nested[2][1].resize(1);
+
+    serializer.ResetIndex();
+    serializer << nested;
+
+    EXPECT_DEATH(
+    {
+        FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+        TileGrid grid;
+        deserializer >> grid;
+    }, "Map column \\(2, 1\\) has depth 1 instead of 2");
+}
@@ -0,0 +1,82 @@
+#include "VisibilityCache.h"
+
+#include <gtest/gtest.h>
+
+using namespace kv;
+
+namespace
+{
+    const int VIEW_RADIUS = 12;
+
+    bool Has(VisibilityCache* cache, const Position& position)
+    {
+        QVector<Position> points;
+        return cache->Find(position, &points);
+    }
+}
+
+TEST(VisibilityCache, FindAndInsert)
+{
+    VisibilityCache cache(VIEW_RADIUS);
+    cache.Reset(64, 64, 2);
+
+    QVector<Position> points;
+    EXPECT_FALSE(cache.Find({10, 10, 0}, &points));
+
+    cache.Insert({10, 10, 0}, {{10, 10, 0}, {11, 10, 0}});
+    ASSERT_TRUE(cache.Find({10, 10, 0}, &points));
+    EXPECT_EQ(points, QVector<Position>({{10, 10, 0}, {11, 10, 0}}));
+
+    EXPECT_FALSE(Has(&cache, {10, 10, 1}));
+    EXPECT_FALSE(Has(&cache, {11, 10, 0}));
+
+    cache.Reset(64, 64, 2);
+    EXPECT_FALSE(Has(&cache, {10, 10, 0}));
+}
+
+TEST(VisibilityCache, Invalidate)
+{
+    VisibilityCache cache(VIEW_RADIUS);
+    cache.Reset(64, 64, 2);
+
+    cache.Insert({10, 10, 0}, {{10, 10, 0}});
+
+    // Outside of the view
+    cache.Invalidate({40, 40, 0});
+    cache.Invalidate({24, 10, 0});
+    cache.Invalidate({10, 10, 1});
+    EXPECT_TRUE(Has(&cache, {10, 10, 0}));
+
+    // The farthest visible tile
+    cache.Invalidate({21, 21, 0});
+    EXPECT_FALSE(Has(&cache, {10, 10, 0}));
+
+    cache.Insert({10, 10, 0}, {{10, 10, 0}});
+    EXPECT_TRUE(Has(&cache, {10, 10, 0}));
+    cache.Invalidate({0, 0, 0});
+    EXPECT_FALSE(Has(&cache, {10, 10, 0}));
+
+    // Viewers near the borders of the map
+    cache.Insert({63, 63, 1}, {});
+    cache.Insert({0, 0, 1}, {});
+    cache.Invalidate({63, 0, 1});
+    EXPECT_TRUE(Has(&cache, {63, 63, 1}));
+    EXPECT_TRUE(Has(&cache, {0, 0, 1}));
+}
+
+TEST(VisibilityCache, RemoveUnused)
+{
+    VisibilityCache cache(VIEW_RADIUS);
+    cache.Reset(64, 64, 1);
+
+    cache.Insert({10, 10, 0}, {});
+    cache.Insert({30, 30, 0}, {});
+    cache.RemoveUnused();
+
+    // Both were used during the previous tick
+    EXPECT_TRUE(Has(&cache, {10, 10, 0}));
+    cache.RemoveUnused();
+
+    EXPECT_TRUE(Has(&cache, {10, 10, 0}));
+    EXPECT_FALSE(Has(&cache, {30, 30, 0}));
+}
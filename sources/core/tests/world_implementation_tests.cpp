@@ -1,8 +1,79 @@
 #include <gtest/gtest.h>
 
+#include <functional>
+
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <Mapgen.h>
+
 #include "CoreImplementation.h"
+#include "FastSerializer.h"
 #include "ObjectFactory.h"
 #include "objects/GlobalObjectsHolder.h"
+#include "atmos/AtmosHolder.h"
+#include "objects/Tile.h"
+#include "objects/mobs/Human.h"
+#include "objects/turfs/Floor.h"
+#include "objects/test/TestObject.h"
+
+namespace
+{
+
+const quint32 LOGIN_NET_ID = 1;
+
+// Real world with a single turf type everywhere and a LoginMob for LOGIN_NET_ID
+std::shared_ptr<kv::WorldImplementation> CreateTestWorld(
+    int width, int height, int depth, const QString& turf_type)
+{
+    QJsonArray tiles;
+    for (int x = 0; x < width; ++x)
+    {
+        for (int y = 0; y < height; ++y)
+        {
+            for (int z = 0; z < depth; ++z)
+            {
+                QJsonObject turf;
+                turf.insert(mapgen::key::TYPE, turf_type);
+
+                QJsonObject tile;
+                tile.insert(mapgen::key::X, x);
+                tile.insert(mapgen::key::Y, y);
+                tile.insert(mapgen::key::Z, z);
+                tile.insert(mapgen::key::TURF, turf);
+                tiles.append(tile);
+            }
+        }
+    }
+
+    QJsonObject data;
+    data.insert(mapgen::key::WIDTH, width);
+    data.insert(mapgen::key::HEIGHT, height);
+    data.insert(mapgen::key::DEPTH, depth);
+    data.insert(mapgen::key::TILES, tiles);
+
+    kv::CoreInterface::Config config;
+    config.unsync_generation = false;
+
+    return std::static_pointer_cast<kv::WorldImplementation>(
+        kv::GetCoreInstance().CreateWorldFromJson(data, LOGIN_NET_ID, config));
+}
+
+int GetPlasma(const std::shared_ptr<kv::WorldImplementation>& world, int x, int y, int z)
+{
+    return world->GetMap().At(x, y, z)->GetAtmosHolder()->GetGase(atmos::PLASMA);
+}
+
+void RunTicks(const std::shared_ptr<kv::WorldImplementation>& world, int amount)
+{
+    for (int i = 0; i < amount; ++i)
+    {
+        world->StartTick();
+        world->FinishTick();
+    }
+}
+
+}
 
 TEST(WorldImplementation, PlayersIds)
 {
@@ -32,3 +103,248 @@ TEST(WorldImplementation, PlayersIds)
     EXPECT_EQ(game.GetNetId(10000000), 543);
     EXPECT_EQ(game.GetPlayerId(543), 10000000);
 }
+
+TEST(WorldImplementation, TickPerformance)
+{
+    kv::WorldImplementation game;
+
+    const kv::WorldInterface::TickPerformance performance = game.GetTickPerformance();
+    EXPECT_EQ(performance.objects_ns, 0);
+    EXPECT_EQ(performance.atmos_ns, 0);
+    EXPECT_EQ(performance.physics_ns, 0);
+    EXPECT_EQ(performance.deletion_ns, 0);
+}
+
+TEST(WorldImplementation, TickPerformanceAfterTick)
+{
+    auto world = CreateTestWorld(32, 32, 1, kv::Floor::GetTypeStatic());
+
+    IdPtr<kv::Human> human = world->GetFactory().CreateImpl(kv::Human::GetTypeStatic());
+    world->GetMap().At(2, 3, 0)->AddObject(human);
+    world->GetMap().At(10, 10, 0)->GetAtmosHolder()->AddGase(atmos::PLASMA, 1000);
+
+    world->StartTick();
+    // So the deletion has some work
+    IdPtr<kv::TestObject> object = world->GetFactory().CreateImpl(kv::TestObject::GetTypeStatic());
+    object->Delete();
+    world->FinishTick();
+
+    const kv::WorldInterface::TickPerformance performance = world->GetTickPerformance();
+    EXPECT_GT(performance.objects_ns, 0);
+    EXPECT_GT(performance.atmos_ns, 0);
+    EXPECT_GT(performance.physics_ns, 0);
+    EXPECT_GT(performance.deletion_ns, 0);
+}
+
+TEST(WorldImplementation, HashTreePinpointsChangedObject)
+{
+    kv::WorldImplementation game;
+
+    QVector<IdPtr<kv::TestObject>> objects;
+    for (int i = 0; i < 300; ++i)
+    {
+        objects.append(game.GetFactory().CreateImpl(kv::TestObject::GetTypeStatic()));
+    }
+
+    auto get_children = [&game](const QJsonObject& node)
+    {
+        return game.GetHashTreeNode(node)["children"].toArray();
+    };
+
+    const QJsonArray root = get_children(QJsonObject());
+    ASSERT_EQ(root.size(), 3);
+    EXPECT_EQ(root[0].toObject()["hash"].toDouble(), game.Hash());
+    // The types node has its own hash
+    EXPECT_EQ(root[1].toObject()["hash"].toDouble(), Hash(game.GetFactory().HashTypes()));
+    EXPECT_NE(root[1].toObject()["hash"].toDouble(), game.Hash());
+
+    const QJsonArray types = get_children(root[1].toObject()["node"].toObject());
+    ASSERT_EQ(types.size(), 1);
+    EXPECT_EQ(types[0].toObject()["node"].toObject()["type"].toString(), kv::TestObject::GetTypeStatic());
+
+    // Snapshot of the whole objects subtree
+    std::function<QMap<QString, double>(const QJsonObject&)> collect;
+    collect = [&get_children, &collect](const QJsonObject& node)
+    {
+        QMap<QString, double> retval;
+        for (const QJsonValue& value : get_children(node))
+        {
+            const QJsonObject child = value.toObject();
+            const QJsonObject child_node = child["node"].toObject();
+            retval[QJsonDocument(child_node).toJson(QJsonDocument::Compact)] = child["hash"].toDouble();
+            if (!child["leaf"].toBool())
+            {
+                const QMap<QString, double> nested = collect(child_node);
+                for (auto it = nested.begin(); it != nested.end(); ++it)
+                {
+                    retval[it.key()] = it.value();
+                }
+            }
+        }
+        return retval;
+    };
+    const QJsonObject objects_node = root[0].toObject()["node"].toObject();
+    const QMap<QString, double> before = collect(objects_node);
+
+    objects[123]->process_ = 42;
+
+    QJsonObject node = objects_node;
+    int requests = 0;
+    while (true)
+    {
+        ++requests;
+        QJsonObject mismatched;
+        for (const QJsonValue& value : get_children(node))
+        {
+            const QJsonObject child = value.toObject();
+            const QString key
+                = QJsonDocument(child["node"].toObject()).toJson(QJsonDocument::Compact);
+            if (before[key] != child["hash"].toDouble())
+            {
+                ASSERT_TRUE(mismatched.isEmpty());
+                mismatched = child;
+            }
+        }
+        ASSERT_FALSE(mismatched.isEmpty());
+        node = mismatched["node"].toObject();
+        if (mismatched["leaf"].toBool())
+        {
+            break;
+        }
+    }
+    EXPECT_EQ(node["kind"].toString(), QString("object"));
+    EXPECT_EQ(node["id"].toDouble(), objects[123].Id());
+    EXPECT_LE(requests, 4);
+}
+
+TEST(WorldImplementation, RepresentHumanAndLoginMob)
+{
+    auto world = CreateTestWorld(32, 32, 1, kv::Floor::GetTypeStatic());
+
+    const quint32 HUMAN_NET_ID = 2;
+    IdPtr<kv::Human> human = world->GetFactory().CreateImpl(kv::Human::GetTypeStatic());
+    world->GetMap().At(2, 3, 0)->AddObject(human);
+    world->SetPlayerId(HUMAN_NET_ID, human.Id());
+
+    kv::FrameData login_data;
+    kv::GrowingFrame login_frame(&login_data);
+    kv::FrameData human_data;
+    kv::GrowingFrame human_frame(&human_data);
+
+    world->Represent({{LOGIN_NET_ID, &login_frame}, {HUMAN_NET_ID, &human_frame}});
+    EXPECT_FALSE(id_ptr_read_only);
+
+    ASSERT_FALSE(login_data.texts.isEmpty());
+    EXPECT_EQ(login_data.texts[0].text, QString("Game tick: 0"));
+    EXPECT_EQ(login_data.music.name, QString("lobby.ogg"));
+
+    ASSERT_FALSE(human_data.texts.isEmpty());
+    EXPECT_EQ(human_data.texts[0].text, QString("Game tick: 0"));
+    EXPECT_FALSE(human_data.entities.isEmpty());
+    EXPECT_FALSE(human_data.units.isEmpty());
+    EXPECT_EQ(human_data.camera_pos_x, 2);
+    EXPECT_EQ(human_data.camera_pos_y, 3);
+}
+
+TEST(WorldImplementation, HumanizeCompactSave)
+{
+    auto world = CreateTestWorld(32, 32, 1, kv::Floor::GetTypeStatic());
+
+    QByteArray compact;
+    world->SaveWorld(&compact);
+
+    // The compact save is converted to the tagged one through the engine
+    auto loaded = kv::GetCoreInstance().CreateWorldFromSave(compact);
+    EXPECT_EQ(loaded->Hash(), world->Hash());
+
+    QByteArray tagged;
+    loaded->SaveWorldTagged(&tagged);
+    EXPECT_GT(tagged.size(), compact.size());
+
+    kv::FastDeserializer deserializer(tagged.data(), tagged.size());
+    const QString humanized = kv::Humanize(&deserializer);
+    EXPECT_TRUE(deserializer.IsEnd());
+    EXPECT_TRUE(humanized.contains(kv::Floor::GetTypeStatic()));
+
+    auto reloaded = kv::GetCoreInstance().CreateWorldFromSave(tagged);
+    EXPECT_EQ(reloaded->Hash(), world->Hash());
+}
+
+TEST(WorldImplementation, GasCrossesLevelsOnlyWithoutFloor)
+{
+    // Enough gas to stay above zero after spreading over the whole level
+    const int TICKS = 20;
+    {
+        auto world = CreateTestWorld(32, 32, 2, kv::Floor::GetTypeStatic());
+        world->GetMap().At(5, 5, 0)->GetAtmosHolder()->AddGase(atmos::PLASMA, 100000);
+
+        RunTicks(world, TICKS);
+        EXPECT_GT(GetPlasma(world, 5, 5, 0), 0);
+        EXPECT_EQ(GetPlasma(world, 5, 5, 1), 0);
+    }
+    {
+        auto world = CreateTestWorld(32, 32, 2, kv::Floor::GetTypeStatic());
+        // Hole in the floor of the upper level
+        world->GetMap().At(5, 5, 1)->GetTurf()->Delete();
+        world->GetMap().At(5, 5, 0)->GetAtmosHolder()->AddGase(atmos::PLASMA, 100000);
+
+        RunTicks(world, TICKS);
+        EXPECT_GT(GetPlasma(world, 5, 5, 0), 0);
+        EXPECT_GT(GetPlasma(world, 5, 5, 1), 0);
+        // And spreads on the upper level further
+        EXPECT_GT(GetPlasma(world, 6, 5, 1), 0);
+    }
+}
+
+TEST(WorldImplementation, IncrementalHashMatchesFullOne)
+{
+    auto world = CreateTestWorld(32, 32, 1, kv::Floor::GetTypeStatic());
+    ObjectFactoryInterface& factory = world->GetFactory();
+
+    IdPtr<kv::Human> human = factory.CreateImpl(kv::Human::GetTypeStatic());
+    world->GetMap().At(2, 3, 0)->AddObject(human);
+    world->GetMap().At(10, 10, 0)->GetAtmosHolder()->AddGase(atmos::PLASMA, 1000);
+
+    const quint32 initial_hash = factory.Hash();
+    EXPECT_EQ(initial_hash, factory.HashFull());
+
+    IdPtr<kv::TestObject> temporary;
+    for (int tick = 0; tick < 30; ++tick)
+    {
+        if (tick == 10)
+        {
+            temporary = factory.CreateImpl(kv::TestObject::GetTypeStatic());
+        }
+        if (tick == 20)
+        {
+            temporary->Delete();
+        }
+        RunTicks(world, 1);
+        ASSERT_EQ(factory.Hash(), factory.HashFull()) << "Tick: " << tick;
+    }
+    EXPECT_NE(factory.Hash(), initial_hash);
+}
+
+TEST(WorldImplementation, IncrementalHashAfterRawPointersChanges)
+{
+    auto world = CreateTestWorld(32, 32, 1, kv::Floor::GetTypeStatic());
+    ObjectFactoryInterface& factory = world->GetFactory();
+
+    // Changed through the Hearer pointer
+    const IdPtr<kv::TestHearer> hearer = factory.CreateImpl(kv::TestHearer::GetTypeStatic());
+    // Changed through the raw pointers of the batch
+    IdPtr<kv::TestBatchObject> batch_object
+        = factory.CreateImpl(kv::TestBatchObject::GetTypeStatic());
+    batch_object->SetFreq(1);
+    ASSERT_EQ(factory.Hash(), factory.HashFull());
+
+    world->StartTick();
+    world->GetChatFrameInfo().PostHear(kv::Phrase{"text", "somebody", ""}, {10, 10, 0});
+    world->FinishTick();
+
+    // Only the const access, it does not mark the objects
+    EXPECT_EQ(hearer->heard_, 1);
+    const IdPtr<kv::TestBatchObject>& const_batch_object = batch_object;
+    EXPECT_EQ(const_batch_object->process_, 1);
+    EXPECT_EQ(factory.Hash(), factory.HashFull());
+}
@@ -8,6 +8,8 @@
 #include "objects/test/TestObject.h"
 #include "objects/GlobalObjectsHolder.h"
 
+#include "AutogenMetadata.h"
+
 #include "interfaces_mocks.h"
 
 using ::testing::ReturnRef;
@@ -52,6 +54,8 @@ TEST(WorldLoaderSaver, SaveAndLoadNoObjects)
             .WillRepeatedly(ReturnRef(atmos));
         EXPECT_CALL(atmos, LoadGrid(&map))
             .Times(1);
+        EXPECT_CALL(map, LoadOpacity())
+            .Times(1);
 
         EXPECT_CALL(game, GetFactory())
             .WillRepeatedly(ReturnRef(factory));
@@ -64,9 +68,13 @@ TEST(WorldLoaderSaver, SaveAndLoadNoObjects)
     }
 }
 
-TEST(WorldLoaderSaver, SaveAndLoadWithObjects)
+namespace
+{
+
+void SaveAndLoadWithObjects(FastSerializer::Mode mode)
 {
     FastSerializer serializer;
+    serializer.SetMode(mode);
     quint32 hash = 0;
     quint32 globals_id = 0;
     {
@@ -112,6 +120,8 @@ TEST(WorldLoaderSaver, SaveAndLoadWithObjects)
             .WillRepeatedly(ReturnRef(atmos));
         EXPECT_CALL(atmos, LoadGrid(&map))
             .Times(1);
+        EXPECT_CALL(map, LoadOpacity())
+            .Times(1);
 
         world::Load(&game, deserializer);
 
@@ -133,9 +143,22 @@ TEST(WorldLoaderSaver, SaveAndLoadWithObjects)
         }
 
         EXPECT_EQ(factory.Hash(), hash);
+        EXPECT_TRUE(deserializer.IsEnd());
     }
 }
 
+} // namespace
+
+TEST(WorldLoaderSaver, SaveAndLoadWithObjects)
+{
+    SaveAndLoadWithObjects(FastSerializer::Mode::TAGGED);
+}
+
+TEST(WorldLoaderSaver, SaveAndLoadWithObjectsCompact)
+{
+    SaveAndLoadWithObjects(FastSerializer::Mode::COMPACT);
+}
+
 TEST(WorldLoaderSaver, ConvertJsonToSerialized)
 {
     // Unknown
@@ -197,3 +220,40 @@ TEST(WorldLoaderSaver, ConvertJsonToSerialized)
         QJsonObject{{mapgen::key::type::TYPE, "type"}}),
         QByteArray("\x06\x02\x04\x00\x00\x00\x74\x00\x79\x00\x70\x00\x65\x00", 14));
 }
+
+TEST(WorldLoaderSaverDeathTest, UnsupportedFormatVersion)
+{
+    // The old format begins with the factory id
+    FastSerializer serializer;
+    serializer << 42;
+
+    MockIGame game;
+    ObjectFactory factory(&game);
+    EXPECT_CALL(game, GetFactory())
+        .WillRepeatedly(ReturnRef(factory));
+
+    FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+    ASSERT_DEATH(
+    {
+        world::Load(&game, deserializer);
+    }, "Unsupported save format version: 0");
+}
+
+TEST(WorldLoaderSaverDeathTest, SchemaMismatch)
+{
+    FastSerializer serializer;
+    serializer << 4u;
+    serializer << true;
+    serializer << (GetSchemaHash() + 1);
+
+    MockIGame game;
+    ObjectFactory factory(&game);
+    EXPECT_CALL(game, GetFactory())
+        .WillRepeatedly(ReturnRef(factory));
+
+    FastDeserializer deserializer(serializer.GetData(), serializer.GetIndex());
+    ASSERT_DEATH(
+    {
+        world::Load(&game, deserializer);
+    }, "Save schema mismatch");
+}
@@ -153,13 +153,23 @@ private:
     FrameData* frame_data_;
 };
 
+// Line of sight affects only the representation,
+// so clients may use different engines. Ray tracing is the default one
+enum class LosEngine
+{
+    SHADOW_CASTING,
+    RAY_TRACING
+};
+
 class WorldInterface
 {
 public:
     virtual ~WorldInterface() { }
 
-    // TODO: FastSerializer should be able to serialize right into QByteArray
-    virtual QByteArray SaveWorld() const = 0;
+    // Appends the save to the data
+    virtual void SaveWorld(QByteArray* data) const = 0;
+    // Same, but each value is prefixed by its type, so the save can be humanized
+    virtual void SaveWorldTagged(QByteArray* data) const = 0;
 
     // TODO: Look into #360 properly
     virtual void StartTick() = 0;
@@ -170,9 +180,35 @@ public:
     virtual void Represent(const QVector<PlayerAndFrame>& frames) const = 0;
     virtual qint32 GetGameTick() const = 0;
     virtual quint32 Hash() const = 0;
+    // Each node of the hash tree returns the hashes of its children:
+    // {"node": node, "children": [{"node": child, "hash": hash, "leaf": is_leaf, "info": {...}}]}
+    // The empty node is the root, so a desync can be narrowed down to the objects
+    // by descending into the mismatching children
+    virtual QJsonObject GetHashTreeNode(const QJsonObject& node) const = 0;
 
     virtual void PerformUnsync() = 0;
 
+    virtual void SetLosEngine(LosEngine engine) = 0;
+
+    // Durations of the phases of the last processed tick
+    struct TickPerformance
+    {
+        TickPerformance()
+            : objects_ns(0),
+              atmos_ns(0),
+              physics_ns(0),
+              deletion_ns(0)
+        {
+            // Nothing
+        }
+
+        qint64 objects_ns;
+        qint64 atmos_ns;
+        qint64 physics_ns;
+        qint64 deletion_ns;
+    };
+    virtual TickPerformance GetTickPerformance() const = 0;
+
 };
 
 class CoreInterface
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QByteArray>
+
+// The map is compressed by independent chunks, so the downloading side
+// uncompresses the received chunks while the rest is still in flight.
+// Format: ([quint32 big endian size][qCompress data])*, [quint32 0]
+namespace MapChunks
+{
+    const char* const CONTENT_TYPE = "application/x-kv-map-chunks";
+    // Dumps of such maps are stored with it, plain qCompress dumps are ".qz"
+    const char* const FILE_SUFFIX = ".chunks";
+    const int CHUNK_SIZE = 1024 * 1024;
+
+    QByteArray Compress(const QByteArray& data, int chunk_size = CHUNK_SIZE);
+    // Returns an empty array if the data is malformed or incomplete
+    QByteArray Uncompress(const QByteArray& data);
+
+    class Uncompressor
+    {
+    public:
+        Uncompressor();
+
+        // Returns false if the data is malformed
+        bool Append(const QByteArray& data);
+        bool IsFinished() const;
+        QByteArray TakeResult();
+    private:
+        bool is_finished_;
+        bool is_failed_;
+        QByteArray pending_;
+        QByteArray result_;
+    };
+}
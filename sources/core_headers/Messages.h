@@ -20,6 +20,7 @@ const int EXIT_CLIENT = 2;
 const int HASH_MESSAGE = 3;
 const int RESTART_ROUND = 4;
 const int NEXT_TICK = 5;
+const int HASH_TREE_MESSAGE = 6;
 
 // MESSAGES TO CLIENT FROM SERVER:
 
@@ -41,6 +42,7 @@ const int NEW_TICK = 203;
 const int NEW_CLIENT = 204;
 const int CURRENT_CONNECTIONS = 205;
 const int REQUEST_HASH = 206;
+const int REQUEST_HASH_TREE = 207;
 
 // GAME MESSAGES
 const int ORDINARY = 1001;
@@ -1,4 +1,5 @@
 import json
+import zlib
 from typing import Union, List, Dict
 
 
@@ -26,6 +27,44 @@ def get_header_list(metadata: dict) -> List:
     return header_list
 
 
+def sort_in_hierarchy_order(metadata: dict) -> List[int]:
+    # Descendants of a class go right after it, so type checks are range checks.
+    # Returns the amount of descendants for each type index.
+    children = {}
+    for class_data in metadata["classes"]:
+        children.setdefault(class_data["base_class"], []).append(class_data)
+    for siblings in children.values():
+        siblings.sort(key=lambda class_data: class_data["class"])
+
+    ordered = []
+    descendants_amounts = [0]
+
+    def visit(class_name: str) -> int:
+        amount = 0
+        for child in children.get(class_name, []):
+            ordered.append(child)
+            descendants_amounts.append(0)
+            child_position = len(descendants_amounts) - 1
+            child_amount = visit(child["class"])
+            descendants_amounts[child_position] = child_amount
+            amount += child_amount + 1
+        return amount
+
+    descendants_amounts[0] = visit("Object")
+    if len(ordered) != len(metadata["classes"]):
+        raise Exception("Some classes are not derived from 'Object'")
+    metadata["classes"] = ordered
+    return descendants_amounts
+
+
+def get_schema_hash(metadata: dict) -> int:
+    # Everything which affects the order of the saved fields,
+    # type indexes are remapped by the types dictionary of the save
+    schema = sorted([class_data["class"], class_data["base_class"], class_data["variables"]]
+                    for class_data in metadata["classes"])
+    return zlib.crc32(json.dumps(schema).encode("utf-8"))
+
+
 def write_to_file(content: str, file: str) -> None:
     with open(file, "w") as output_file:
         output_file.write(content)
@@ -65,6 +104,10 @@ const QString& {data_class}::GetTypeStatic()
     return type;
 }}\n""".format(data_class=class_data["class"])
 
+    file_content += """
+const int TYPES_DESCENDANTS_AMOUNT[] = {{{}}};
+""".format(", ".join(str(amount) for amount in descendants_amounts))
+
     file_content += """
 void InitRealTypes()
 {
@@ -75,19 +118,28 @@ void InitRealTypes()
         index = str(metadata["classes"].index(class_data) + 1)
         file_content += "    {class_data}::TYPE_INDEX = {index};\n".format(class_data=class_data["class"], index=index)
 
-    file_content += """}
+    file_content += """}}
 
 void InitCreators()
-{
+{{
+    GetVoidItemsCreators()->resize({types_amount});
+    GetBatchProcessors()->resize({types_amount}, nullptr);
+
     (*GetItemsCreators())[Object::GetTypeStatic()] = &Object::_Z_KV_Creator;
-    (*GetVoidItemsCreators())[Object::GetTypeStatic()] = &Object::_Z_KV_VoidCreator;"""
+    (*GetVoidItemsCreators())[Object::TYPE_INDEX]
+        = {{Object::GetTypeStatic(), &Object::_Z_KV_VoidCreator}};""".format(types_amount=len(metadata["classes"]) + 1)
 
     for class_data in metadata["classes"]:
         class_name = class_data["class"]
         file_content += """
     (*GetItemsCreators())[{class_name}::GetTypeStatic()] = &{class_name}::_Z_KV_Creator;
-    (*GetVoidItemsCreators())[{class_name}::GetTypeStatic()] = &{class_name}::_Z_KV_VoidCreator;""".\
+    (*GetVoidItemsCreators())[{class_name}::TYPE_INDEX]
+        = {{{class_name}::GetTypeStatic(), &{class_name}::_Z_KV_VoidCreator}};""".\
             format(class_name=class_name)
+        if class_data.get("process_batch"):
+            file_content += """
+    (*GetBatchProcessors())[{class_name}::TYPE_INDEX] = &{class_name}::{function};""".\
+                format(class_name=class_name, function=class_data["process_batch"])
 
     file_content += """
 }
@@ -114,57 +166,152 @@ void InitSettersForTypes()
             class_data_loc = get_class_data(metadata, class_data_loc["base_class"])
     file_content += "}\n"
 
+    file_content += """
+quint32 GetSchemaHash()
+{{
+    return {:#010x}u;
+}}
+""".format(get_schema_hash(metadata))
+
     return file_content
 
 
+def get_class_chain(metadata: dict, class_data: dict) -> List[str]:
+    # From the class right after Object to the class itself
+    chain = []
+    class_data_loc = class_data
+    while class_data_loc:
+        chain.insert(0, class_data_loc["class"])
+        class_data_loc = get_class_data(metadata, class_data_loc["base_class"])
+    return chain
+
+
 def generate_autogen_serializer() -> str:
-    file_content = ""
+    file_content = "#include \"AutogenMetadata.h\"\n\n"
     for header in header_list:
         file_content += '#include \"{}\"\n'.format(header)
 
-    file_content += "\nusing namespace kv;\n\n"
+    file_content += "\nusing namespace kv;\n"
 
     for class_data in metadata["classes"]:
         file_content += """
-void {}::Save(FastSerializer& file)
+void {}::_Z_KV_SaveOwn(FastSerializer& file)
 {{
-    {}::Save(file);
-""".format(class_data["class"], class_data["base_class"])
-
-        if len(class_data["variables"]):
-            file_content += "\n"
+""".format(class_data["class"])
 
         for variable in class_data["variables"]:
             file_content += "    file << {};\n".format(variable)
 
         file_content += """}}
 
-void {}::Load(FastDeserializer& file)
+void {}::_Z_KV_LoadOwn(FastDeserializer& file)
 {{
-    {}::Load(file);
-""".format(class_data["class"], class_data["base_class"])
-
-        if len(class_data["variables"]):
-            file_content += "\n"
+""".format(class_data["class"])
 
         for variable in class_data["variables"]:
             file_content += "    file >> {};\n".format(variable)
 
-        if len(class_data["on_load_calls"]):
+        if len(class_data["variables"]) and len(class_data["on_load_calls"]):
             file_content += "\n"
 
         for function in class_data["on_load_calls"]:
             file_content += "    {}();\n".format(function)
         file_content += """}}
 
-unsigned int {}::HashMembers() 
+unsigned int {}::_Z_KV_HashOwn()
 {{
     unsigned int retval = 0;
-    retval += {}::HashMembers();\n""".format(class_data["class"], class_data["base_class"])
+""".format(class_data["class"])
 
         for variable in class_data["variables"]:
             file_content += "    retval += Hash({});\n".format(variable)
         file_content += "    return retval;\n}\n"
+
+    file_content += """
+namespace
+{
+
+void FlatSaveObject(Object* object, FastSerializer& file)
+{
+    file.WriteTypeIndex(Object::TYPE_INDEX);
+    object->_Z_KV_SaveOwn(file);
+}
+
+void FlatLoadObject(Object* object, FastDeserializer& file)
+{
+    object->_Z_KV_LoadOwn(file);
+}
+
+unsigned int FlatHashObject(Object* object)
+{
+    return object->_Z_KV_HashOwn();
+}
+"""
+
+    for class_data in metadata["classes"]:
+        class_name = class_data["class"]
+        chain = get_class_chain(metadata, class_data)
+
+        file_content += """
+void FlatSave{class_name}(Object* object, FastSerializer& file)
+{{
+    {class_name}* casted = static_cast<{class_name}*>(object);
+    file.WriteTypeIndex({class_name}::TYPE_INDEX);
+    casted->Object::_Z_KV_SaveOwn(file);
+""".format(class_name=class_name)
+        for level in chain:
+            file_content += "    casted->{}::_Z_KV_SaveOwn(file);\n".format(level)
+
+        file_content += """}}
+
+void FlatLoad{class_name}(Object* object, FastDeserializer& file)
+{{
+    {class_name}* casted = static_cast<{class_name}*>(object);
+    casted->Object::_Z_KV_LoadOwn(file);
+""".format(class_name=class_name)
+        for level in chain:
+            file_content += "    casted->{}::_Z_KV_LoadOwn(file);\n".format(level)
+
+        file_content += """}}
+
+unsigned int FlatHash{class_name}(Object* object)
+{{
+    {class_name}* casted = static_cast<{class_name}*>(object);
+    unsigned int retval = casted->Object::_Z_KV_HashOwn();
+""".format(class_name=class_name)
+        for level in chain:
+            file_content += "    retval += casted->{}::_Z_KV_HashOwn();\n".format(level)
+        file_content += "    return retval;\n}\n"
+
+    file_content += "\n}\n"
+
+    for class_data in metadata["classes"]:
+        file_content += """
+void {class_name}::Save(FastSerializer& file)
+{{
+    FlatSave{class_name}(this, file);
+}}
+
+void {class_name}::Load(FastDeserializer& file)
+{{
+    FlatLoad{class_name}(this, file);
+}}
+
+unsigned int {class_name}::HashMembers()
+{{
+    return FlatHash{class_name}(this);
+}}
+""".format(class_name=class_data["class"])
+
+    file_content += """
+const ObjectSerializer OBJECT_SERIALIZERS[] =
+{
+    {&FlatSaveObject, &FlatLoadObject, &FlatHashObject},
+"""
+    for class_data in metadata["classes"]:
+        file_content += "    {{&FlatSave{0}, &FlatLoad{0}, &FlatHash{0}}},\n".format(class_data["class"])
+    file_content += "};\n"
+
     return file_content
 
 
@@ -175,6 +322,7 @@ autogen_metadata_file = "AutogenMetadata.cpp"
 autogen_serialization_file = "AutogenSerialization.cpp"
 
 metadata = import_metadata(metadata_file)
+descendants_amounts = sort_in_hierarchy_order(metadata)
 header_list = get_header_list(metadata)
 
 write_to_file(generate_autogen_metadata(), autogen_metadata_file)
@@ -0,0 +1,359 @@
+#include <QCoreApplication>
+
+#include <CoreInterface.h>
+#include <MapChunks.h>
+#include <Messages.h>
+#include <NetworkMessages.h>
+
+#include <QCommandLineOption>
+#include <QCommandLineParser>
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+// Bench players get net ids far away from the ones which a real server
+// gives out, so they do not clash with players stored in a saved world
+const int NET_ID_BASE = 100000;
+
+// The lobby refuses logins until its countdown is over, so the login
+// click is repeated for a while
+const int LOGIN_TICKS = 100;
+
+const char* const LOGIN_CLICK = "login_click";
+
+const char* const MOVES[] =
+    {Input::MOVE_UP, Input::MOVE_DOWN, Input::MOVE_LEFT, Input::MOVE_RIGHT};
+const int MOVES_AMOUNT = sizeof(MOVES) / sizeof(MOVES[0]);
+
+namespace key
+{
+
+const QString ID("id");
+const QString KEY("key");
+
+} // namespace key
+
+class ScriptedInput
+{
+public:
+    ScriptedInput(quint32 seed)
+        : state_(seed)
+    {
+        // Nothing
+    }
+    kv::Message Next(int net_id, int tick)
+    {
+        kv::Message message;
+        message.type = kv::message_type::ORDINARY;
+        if (tick < LOGIN_TICKS)
+        {
+            message.data = {{key::ID, net_id}, {key::KEY, LOGIN_CLICK}};
+            return message;
+        }
+        const char* const move = MOVES[Generate() % MOVES_AMOUNT];
+        message.data = {{key::ID, net_id}, {key::KEY, move}};
+        return message;
+    }
+private:
+    quint32 Generate()
+    {
+        // Numerical Recipes LCG, the bench should not depend on qrand()
+        state_ = state_ * 1664525u + 1013904223u;
+        return state_ >> 16;
+    }
+    quint32 state_;
+};
+
+class PhaseSamples
+{
+public:
+    PhaseSamples(int reserve)
+    {
+        samples_.reserve(reserve);
+    }
+    void Add(qint64 ns)
+    {
+        samples_.push_back(ns);
+    }
+    QJsonObject ToJson() const
+    {
+        QJsonObject retval;
+        if (samples_.empty())
+        {
+            return retval;
+        }
+
+        std::vector<qint64> sorted = samples_;
+        std::sort(sorted.begin(), sorted.end());
+
+        auto to_ms = [](qint64 ns) { return (ns * 1.0) / 1000000.0; };
+        auto percentile = [&sorted](int percent)
+        {
+            const int size = static_cast<int>(sorted.size());
+            const int index = std::min(size - 1, (size * percent) / 100);
+            return sorted[index];
+        };
+
+        qint64 sum = 0;
+        for (qint64 sample : sorted)
+        {
+            sum += sample;
+        }
+
+        retval.insert("mean_ms", to_ms(sum) / sorted.size());
+        retval.insert("p50_ms", to_ms(percentile(50)));
+        retval.insert("p90_ms", to_ms(percentile(90)));
+        retval.insert("p99_ms", to_ms(percentile(99)));
+        retval.insert("max_ms", to_ms(sorted.back()));
+        return retval;
+    }
+private:
+    std::vector<qint64> samples_;
+};
+
+bool ReadFile(const QString& name, QByteArray* data)
+{
+    QFile file(name);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        qDebug() << "Unable to open file:" << name;
+        return false;
+    }
+    *data = file.readAll();
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+
+    QCommandLineOption mapgen_option
+        ({"m", "mapgen"}, "Mapgen json file which the world will be created from", "mapgen");
+    QCommandLineOption save_option
+        ({"s", "save"}, "Saved world which will be loaded", "save");
+    QCommandLineOption compressed_option
+        ({"z", "compressed"},
+         QString("Saved world is compressed as it is sent over network: by chunks if the file name "
+                 "ends with '%1', by qCompress otherwise").arg(MapChunks::FILE_SUFFIX));
+    QCommandLineOption players_option
+        ({"p", "players"}, "Amount of scripted players", "players", "8");
+    QCommandLineOption ticks_option
+        ({"t", "ticks"}, "Amount of ticks to process", "ticks", "2000");
+    QCommandLineOption seed_option
+        ("seed", "Seed for the scripted players input", "seed", "1");
+    QCommandLineOption los_option
+        ("los", "Line of sight engine: 'raytracing' or 'shadowcasting'", "los", "raytracing");
+    QCommandLineOption output_option
+        ({"o", "output"}, "File for the json report, stdout is used by default", "output");
+
+    QCommandLineParser parser;
+    parser.addOption(mapgen_option);
+    parser.addOption(save_option);
+    parser.addOption(compressed_option);
+    parser.addOption(players_option);
+    parser.addOption(ticks_option);
+    parser.addOption(seed_option);
+    parser.addOption(los_option);
+    parser.addOption(output_option);
+    parser.addHelpOption();
+
+    if (!parser.parse(app.arguments()))
+    {
+        qDebug() << "Unable to parse params:" << parser.errorText();
+        return -1;
+    }
+
+    if (parser.isSet(mapgen_option) == parser.isSet(save_option))
+    {
+        qDebug() << "Exactly one of mapgen and save options should be set, try '--help'!";
+        return -2;
+    }
+
+    const int players = parser.value(players_option).toInt();
+    const int ticks = parser.value(ticks_option).toInt();
+    if (players < 1 || ticks < 1)
+    {
+        qDebug() << "Amount of players and ticks should be positive!";
+        return -2;
+    }
+
+    const QString los = parser.value(los_option);
+    if (los != "raytracing" && los != "shadowcasting")
+    {
+        qDebug() << "Unknown line of sight engine:" << los;
+        return -2;
+    }
+
+    QElapsedTimer load_timer;
+    load_timer.start();
+
+    kv::CoreInterface& core = kv::GetCoreInstance();
+    kv::CoreInterface::WorldPtr world;
+    QString map_name;
+    int first_new_player = 0;
+    if (parser.isSet(mapgen_option))
+    {
+        map_name = parser.value(mapgen_option);
+        QByteArray data;
+        if (!ReadFile(map_name, &data))
+        {
+            return -3;
+        }
+        const QJsonDocument document = QJsonDocument::fromJson(data);
+        kv::CoreInterface::Config config;
+        config.unsync_generation = false;
+        world = core.CreateWorldFromJson(document.object(), NET_ID_BASE, config);
+        // The world creates the login mob for the first player itself
+        first_new_player = 1;
+    }
+    else
+    {
+        map_name = parser.value(save_option);
+        QByteArray data;
+        if (!ReadFile(map_name, &data))
+        {
+            return -3;
+        }
+        if (parser.isSet(compressed_option))
+        {
+            data = map_name.endsWith(MapChunks::FILE_SUFFIX)
+                ? MapChunks::Uncompress(data)
+                : qUncompress(data);
+        }
+        world = core.CreateWorldFromSave(data);
+    }
+
+    const qint64 load_ns = load_timer.nsecsElapsed();
+
+    world->SetLosEngine(
+        los == "shadowcasting" ? kv::LosEngine::SHADOW_CASTING : kv::LosEngine::RAY_TRACING);
+
+    for (int player = first_new_player; player < players; ++player)
+    {
+        kv::Message message;
+        message.type = kv::message_type::NEW_CLIENT;
+        message.data = {{key::ID, NET_ID_BASE + player}};
+        world->StartTick();
+        world->ProcessMessage(message);
+        world->FinishTick();
+    }
+
+    PhaseSamples objects(ticks);
+    PhaseSamples atmos(ticks);
+    PhaseSamples physics(ticks);
+    PhaseSamples deletion(ticks);
+    PhaseSamples messages(ticks);
+    PhaseSamples start_tick(ticks);
+    PhaseSamples finish_tick(ticks);
+    PhaseSamples frame_generation(ticks);
+    PhaseSamples tick_total(ticks);
+
+    ScriptedInput input(parser.value(seed_option).toUInt());
+
+    std::vector<kv::FrameData> frames_data(players);
+    QVector<kv::GrowingFrame> frames;
+    QVector<kv::WorldInterface::PlayerAndFrame> players_and_frames;
+    for (int player = 0; player < players; ++player)
+    {
+        frames.append(kv::GrowingFrame(&frames_data[player]));
+    }
+    for (int player = 0; player < players; ++player)
+    {
+        players_and_frames.append({NET_ID_BASE + player, &frames[player]});
+    }
+
+    QElapsedTimer run_timer;
+    run_timer.start();
+
+    for (int tick = 0; tick < ticks; ++tick)
+    {
+        QElapsedTimer tick_timer;
+        tick_timer.start();
+
+        QElapsedTimer timer;
+
+        timer.start();
+        world->StartTick();
+        start_tick.Add(timer.nsecsElapsed());
+
+        timer.start();
+        for (int player = 0; player < players; ++player)
+        {
+            world->ProcessMessage(input.Next(NET_ID_BASE + player, tick));
+        }
+        messages.Add(timer.nsecsElapsed());
+
+        timer.start();
+        world->FinishTick();
+        finish_tick.Add(timer.nsecsElapsed());
+
+        for (kv::FrameData& frame_data : frames_data)
+        {
+            frame_data = kv::FrameData();
+        }
+        timer.start();
+        world->Represent(players_and_frames);
+        frame_generation.Add(timer.nsecsElapsed());
+
+        tick_total.Add(tick_timer.nsecsElapsed());
+
+        const kv::WorldInterface::TickPerformance performance = world->GetTickPerformance();
+        objects.Add(performance.objects_ns);
+        atmos.Add(performance.atmos_ns);
+        physics.Add(performance.physics_ns);
+        deletion.Add(performance.deletion_ns);
+    }
+
+    const qint64 run_ns = run_timer.nsecsElapsed();
+
+    QJsonObject phases;
+    phases.insert("objects", objects.ToJson());
+    phases.insert("atmos", atmos.ToJson());
+    phases.insert("physics", physics.ToJson());
+    phases.insert("deletion", deletion.ToJson());
+    phases.insert("messages", messages.ToJson());
+    phases.insert("start_tick", start_tick.ToJson());
+    phases.insert("finish_tick", finish_tick.ToJson());
+    phases.insert("frame_generation", frame_generation.ToJson());
+    phases.insert("tick", tick_total.ToJson());
+
+    QJsonObject report;
+    report.insert("game_version", core.GetGameVersion());
+    report.insert("build_info", core.GetBuildInfo());
+    report.insert("map", map_name);
+    report.insert("players", players);
+    report.insert("ticks", ticks);
+    report.insert("los", los);
+    report.insert("load_ms", (load_ns * 1.0) / 1000000.0);
+    report.insert("run_ms", (run_ns * 1.0) / 1000000.0);
+    report.insert("phases", phases);
+
+    const QByteArray json = QJsonDocument(report).toJson(QJsonDocument::Indented);
+
+    if (parser.isSet(output_option))
+    {
+        QFile file(parser.value(output_option));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        {
+            qDebug() << "Unable to open file:" << file.fileName();
+            return -4;
+        }
+        file.write(json);
+        return 0;
+    }
+
+    QTextStream out(stdout);
+    out << json;
+    return 0;
+}
@@ -40,6 +40,7 @@ def parse_declare_saved_begin(file: io.TextIOWrapper, class_and_base: str, filen
 
     variables = []
     on_load_calls = []
+    process_batch = None
 
     while True:
         line = file.readline()
@@ -51,6 +52,12 @@ def parse_declare_saved_begin(file: io.TextIOWrapper, class_and_base: str, filen
         if result:
             on_load_calls.append(result.strip())
             continue
+        result = extract_macros_params(line, "KV_PROCESS_BATCH")
+        if result:
+            if process_batch:
+                raise Exception("Too many 'KV_PROCESS_BATCH' macros in {}".format(class_name))
+            process_batch = result.strip()
+            continue
         result = extract_macros_params(line, "END_DECLARE")
         if result:
             if result.strip() != class_name:
@@ -67,7 +74,8 @@ def parse_declare_saved_begin(file: io.TextIOWrapper, class_and_base: str, filen
         "base_class": base_class_name,
         "type": class_type,
         "variables": variables,
-        "on_load_calls": on_load_calls
+        "on_load_calls": on_load_calls,
+        "process_batch": process_batch
     }
 
     return class_entry
@@ -85,7 +93,9 @@ def metadata_to_json(metadata: Dict[str, List]) -> str:
 def generate_metadata(directory: str) -> List[dict]:
     result = []
     for directory, directory_names, filenames in os.walk(directory):
-        for filename in [f for f in filenames if f.endswith(".h")]:
+        # The walk order depends on the file system, but the metadata order should not
+        directory_names.sort()
+        for filename in sorted(f for f in filenames if f.endswith(".h")):
             full_path = os.path.join(directory, filename)
             if "KvMacros.h" not in full_path:
                 parsed_data = parse_file(full_path)
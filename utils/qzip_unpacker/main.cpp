@@ -4,6 +4,9 @@
 #include <QTextStream>
 #include <QFile>
 
+#include <CoreInterface.h>
+#include <MapChunks.h>
+
 #include "core/FastSerializer.h"
 
 inline QTextStream& qStdout()
@@ -12,6 +15,25 @@ inline QTextStream& qStdout()
     return r;
 }
 
+// Saves start with the tagged version and the compact flag
+bool IsCompactSave(const QByteArray& data)
+{
+    kv::FastDeserializer deserializer(data.data(), data.size());
+    if (!deserializer.IsNextType(kv::FastSerializer::UINT32_TYPE))
+    {
+        return false;
+    }
+    quint32 version;
+    deserializer >> version;
+    if (!deserializer.IsNextType(kv::FastSerializer::BOOL_TYPE))
+    {
+        return false;
+    }
+    bool is_compact;
+    deserializer >> is_compact;
+    return is_compact;
+}
+
 int main(int argc, char* argv[])
 {
     QCoreApplication app(argc, argv);
@@ -37,7 +59,22 @@ int main(int argc, char* argv[])
         return -1;
     }
     QByteArray compressed = input.readAll();
-    QByteArray uncompressed = qUncompress(compressed);
+    QByteArray uncompressed = input_file_name.endsWith(MapChunks::FILE_SUFFIX)
+        ? MapChunks::Uncompress(compressed)
+        : qUncompress(compressed);
+    if (uncompressed.isEmpty())
+    {
+        qStdout() << "Unable to uncompress the data";
+        return -1;
+    }
+
+    // The compact body has no types, so it can be read only by the engine
+    if (IsCompactSave(uncompressed))
+    {
+        auto world = kv::GetCoreInstance().CreateWorldFromSave(uncompressed);
+        uncompressed.clear();
+        world->SaveWorldTagged(&uncompressed);
+    }
 
     kv::FastDeserializer deserializer(uncompressed.data(), uncompressed.size());
 